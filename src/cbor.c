@@ -547,3 +547,311 @@ int cbor_size(uint8_t *data)
 
     return 0;   // float16, arrays, maps, tagged types, etc. curently not supported
 }
+
+/*
+ * Fast paths
+ *
+ * The functions below are drop-in replacements for the functions above with identical results.
+ * The width of integers is determined from the bit length of the value and the bytes are copied
+ * with a single (unaligned) load or store plus a byte swap instead of shifting byte by byte.
+ */
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define _cbor_be16(x) __builtin_bswap16(x)
+#define _cbor_be32(x) __builtin_bswap32(x)
+#define _cbor_be64(x) __builtin_bswap64(x)
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define _cbor_be16(x) (x)
+#define _cbor_be32(x) (x)
+#define _cbor_be64(x) (x)
+#else
+static inline uint16_t _cbor_be16(uint16_t x)
+{
+    uint8_t b[2] = { (uint8_t)(x >> 8), (uint8_t)x };
+    memcpy(&x, b, 2);
+    return x;
+}
+
+static inline uint32_t _cbor_be32(uint32_t x)
+{
+    uint8_t b[4] = { (uint8_t)(x >> 24), (uint8_t)(x >> 16), (uint8_t)(x >> 8), (uint8_t)x };
+    memcpy(&x, b, 4);
+    return x;
+}
+
+static inline uint64_t _cbor_be64(uint64_t x)
+{
+    uint8_t b[8];
+    for (int i = 0; i < 8; i++) {
+        b[i] = (uint8_t)(x >> (56 - 8 * i));
+    }
+    memcpy(&x, b, 8);
+    return x;
+}
+#endif
+
+/*
+ * Returns 0, 1, 2 or 3 for 1, 2, 4 or 8 bytes needed to store the value (compiled without
+ * branches, as opposed to the if-else chain in cbor_serialize_uint)
+ */
+#ifdef TS_64BIT_TYPES_SUPPORT
+static inline int _cbor_uint_width(uint64_t value)
+#else
+static inline int _cbor_uint_width(uint32_t value)
+#endif
+{
+    return (value > 0xFF) + (value > 0xFFFF) + ((uint64_t)value > 0xFFFFFFFF);
+}
+
+#ifdef TS_64BIT_TYPES_SUPPORT
+int cbor_serialize_uint_fast(uint8_t *data, uint64_t value, size_t max_len)
+#else
+int cbor_serialize_uint_fast(uint8_t *data, uint32_t value, size_t max_len)
+#endif
+{
+    if (value < 24) {
+        if (max_len < 1) {
+            return 0;
+        }
+        data[0] = CBOR_UINT | (uint8_t)value;
+        return 1;
+    }
+
+    int width = _cbor_uint_width(value);
+    size_t len = 1 + (1U << width);
+
+    if (len > max_len) {
+        return 0;
+    }
+
+    data[0] = CBOR_UINT | (CBOR_UINT8_FOLLOWS + width);
+    switch (width) {
+    case 0:
+        data[1] = (uint8_t)value;
+        break;
+    case 1: {
+        uint16_t be = _cbor_be16((uint16_t)value);
+        memcpy(&data[1], &be, 2);
+        break;
+    }
+    case 2: {
+        uint32_t be = _cbor_be32((uint32_t)value);
+        memcpy(&data[1], &be, 4);
+        break;
+    }
+#ifdef TS_64BIT_TYPES_SUPPORT
+    default: {
+        uint64_t be = _cbor_be64(value);
+        memcpy(&data[1], &be, 8);
+        break;
+    }
+#endif
+    }
+    return len;
+}
+
+#ifdef TS_64BIT_TYPES_SUPPORT
+int cbor_serialize_int_fast(uint8_t *data, int64_t value, size_t max_len)
+{
+    // all bits set for negative values: -1 - value == ~value
+    uint64_t sign = (uint64_t)(value >> 63);
+    int size = cbor_serialize_uint_fast(data, (uint64_t)value ^ sign, max_len);
+#else
+int cbor_serialize_int_fast(uint8_t *data, int32_t value, size_t max_len)
+{
+    uint32_t sign = (uint32_t)(value >> 31);
+    int size = cbor_serialize_uint_fast(data, (uint32_t)value ^ sign, max_len);
+#endif
+    if (size > 0) {
+        data[0] |= sign & CBOR_NEGINT;
+    }
+    return size;
+}
+
+int cbor_serialize_float_fast(uint8_t *data, float value, size_t max_len)
+{
+    if (max_len < 5)
+        return 0;
+
+    uint32_t be;
+    memcpy(&be, &value, 4);
+    be = _cbor_be32(be);
+
+    data[0] = CBOR_FLOAT32;
+    memcpy(&data[1], &be, 4);
+    return 5;
+}
+
+#ifdef TS_64BIT_TYPES_SUPPORT
+int _cbor_uint_data_fast(uint8_t *data, uint64_t *bytes)
+#else
+int _cbor_uint_data_fast(uint8_t *data, uint32_t *bytes)
+#endif
+{
+    uint8_t info = data[0] & CBOR_INFO_MASK;
+
+    if (info < 24) {
+        *bytes = info;
+        return 1;
+    }
+
+    switch (info) {
+    case CBOR_UINT8_FOLLOWS:
+        *bytes = data[1];
+        return 2;
+    case CBOR_UINT16_FOLLOWS: {
+        uint16_t be;
+        memcpy(&be, &data[1], 2);
+        *bytes = _cbor_be16(be);
+        return 3;
+    }
+    case CBOR_UINT32_FOLLOWS: {
+        uint32_t be;
+        memcpy(&be, &data[1], 4);
+        *bytes = _cbor_be32(be);
+        return 5;
+    }
+#ifdef TS_64BIT_TYPES_SUPPORT
+    case CBOR_UINT64_FOLLOWS: {
+        uint64_t be;
+        memcpy(&be, &data[1], 8);
+        *bytes = _cbor_be64(be);
+        return 9;
+    }
+#endif
+    default:
+        return 0;
+    }
+}
+
+#ifdef TS_64BIT_TYPES_SUPPORT
+int cbor_deserialize_uint64_fast(uint8_t *data, uint64_t *value)
+{
+    uint64_t tmp;
+
+    if (!value || (data[0] & CBOR_TYPE_MASK) != CBOR_UINT)
+        return 0;
+
+    int size = _cbor_uint_data_fast(data, &tmp);
+    if (size > 0) {
+        *value = tmp;
+    }
+    return size;
+}
+
+int cbor_deserialize_int64_fast(uint8_t *data, int64_t *value)
+{
+    uint64_t tmp;
+    uint8_t type = data[0] & CBOR_TYPE_MASK;
+
+    if (!value || type > CBOR_NEGINT)
+        return 0;
+
+    int size = _cbor_uint_data_fast(data, &tmp);
+    if (size > 0 && tmp <= INT64_MAX) {
+        // major type 1 stores -1 - value, which is the same as inverting all bits
+        *value = (int64_t)(tmp ^ (0 - (uint64_t)(type >> 5)));
+        return size;
+    }
+    return 0;
+}
+#endif
+
+int cbor_deserialize_uint32_fast(uint8_t *data, uint32_t *value)
+{
+#ifdef TS_64BIT_TYPES_SUPPORT
+    uint64_t tmp;
+#else
+    uint32_t tmp;
+#endif
+
+    if (!value || (data[0] & CBOR_TYPE_MASK) != CBOR_UINT)
+        return 0;
+
+    int size = _cbor_uint_data_fast(data, &tmp);
+    if (size > 0 && tmp <= INT32_MAX) {
+        *value = (uint32_t)tmp;
+        return size;
+    }
+    return 0;
+}
+
+int cbor_deserialize_int32_fast(uint8_t *data, int32_t *value)
+{
+#ifdef TS_64BIT_TYPES_SUPPORT
+    uint64_t tmp;
+#else
+    uint32_t tmp;
+#endif
+    uint8_t type = data[0] & CBOR_TYPE_MASK;
+
+    if (!value || type > CBOR_NEGINT)
+        return 0;
+
+    int size = _cbor_uint_data_fast(data, &tmp);
+    if (size > 0 && tmp <= INT32_MAX) {
+        *value = (int32_t)((uint32_t)tmp ^ (0 - (uint32_t)(type >> 5)));
+        return size;
+    }
+    return 0;
+}
+
+int cbor_deserialize_uint16_fast(uint8_t *data, uint16_t *value)
+{
+    uint32_t tmp;
+    int size = cbor_deserialize_uint32_fast(data, &tmp); // also checks value for null-pointer
+
+    if (size > 0 && tmp <= UINT16_MAX) {
+        *value = tmp;
+        return size;
+    }
+    return 0;
+}
+
+int cbor_deserialize_int16_fast(uint8_t *data, int16_t *value)
+{
+    int32_t tmp;
+    int size = cbor_deserialize_int32_fast(data, &tmp); // also checks value for null-pointer
+
+    if (size > 0 && tmp <= INT16_MAX && tmp >= INT16_MIN) {
+        *value = tmp;
+        return size;
+    }
+    return 0;
+}
+
+int cbor_deserialize_float_fast(uint8_t *data, float *value)
+{
+    if (!value) {
+        return 0;
+    }
+
+    if (data[0] == CBOR_FLOAT32) {
+        uint32_t be;
+        memcpy(&be, &data[1], 4);
+        be = _cbor_be32(be);
+        memcpy(value, &be, 4);
+        return 5;
+    }
+
+#ifdef TS_64BIT_TYPES_SUPPORT
+    int64_t tmp;
+    int len = cbor_deserialize_int64_fast(data, &tmp);
+    if (len == 0 && (data[0] & CBOR_TYPE_MASK) == CBOR_UINT) {
+        // values above INT64_MAX
+        uint64_t utmp;
+        len = cbor_deserialize_uint64_fast(data, &utmp);
+        if (len > 0) {
+            *value = (float)utmp;
+        }
+        return len;
+    }
+#else
+    int32_t tmp;
+    int len = cbor_deserialize_int32_fast(data, &tmp);
+#endif
+    if (len > 0) {
+        *value = (float)tmp;
+    }
+    return len;
+}
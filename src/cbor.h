@@ -288,6 +288,60 @@ int cbor_num_elements(uint8_t *data, uint16_t *num_elements);
  */
 int cbor_size(uint8_t *data);
 
+/**
+ * Decode the argument of a CBOR data item (value of integers, length of strings, arrays, etc.)
+ *
+ * @param data Buffer containing CBOR data
+ * @param bytes Pointer to the variable where the argument should be stored
+ *
+ * @returns Number of bytes read from buffer or 0 in case of error
+ */
+#ifdef TS_64BIT_TYPES_SUPPORT
+int _cbor_uint_data(uint8_t *data, uint64_t *bytes);
+#else
+int _cbor_uint_data(uint8_t *data, uint32_t *bytes);
+#endif
+
+/**
+ * Fast paths
+ *
+ * Same parameters and results as the functions without _fast suffix, but the integer width is
+ * determined from the bit length of the value and byte swaps use compiler builtins instead of
+ * byte-by-byte shifts. The functions without suffix are kept as reference implementation.
+ *
+ * Run the microbenchmarks in main_bench.cpp to compare both versions on the target. The binary
+ * mode of ThingSet uses the fast paths for decoding and for floats. Integer encoding still uses
+ * the reference implementation, as the fast paths were not faster on x86-64.
+ */
+
+#ifdef TS_64BIT_TYPES_SUPPORT
+int cbor_serialize_uint_fast(uint8_t *data, uint64_t value, size_t max_len);
+int cbor_serialize_int_fast(uint8_t *data, int64_t value, size_t max_len);
+#else
+int cbor_serialize_uint_fast(uint8_t *data, uint32_t value, size_t max_len);
+int cbor_serialize_int_fast(uint8_t *data, int32_t value, size_t max_len);
+#endif
+
+int cbor_serialize_float_fast(uint8_t *data, float value, size_t max_len);
+
+#ifdef TS_64BIT_TYPES_SUPPORT
+int _cbor_uint_data_fast(uint8_t *data, uint64_t *bytes);
+int cbor_deserialize_uint64_fast(uint8_t *data, uint64_t *value);
+int cbor_deserialize_int64_fast(uint8_t *data, int64_t *value);
+#else
+int _cbor_uint_data_fast(uint8_t *data, uint32_t *bytes);
+#endif
+
+int cbor_deserialize_uint32_fast(uint8_t *data, uint32_t *value);
+
+int cbor_deserialize_int32_fast(uint8_t *data, int32_t *value);
+
+int cbor_deserialize_uint16_fast(uint8_t *data, uint16_t *value);
+
+int cbor_deserialize_int16_fast(uint8_t *data, int16_t *value);
+
+int cbor_deserialize_float_fast(uint8_t *data, float *value);
+
 #ifdef __cplusplus
 }
 #endif
@@ -302,6 +302,107 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
 	return count;
 }
 
+/**
+ * Finds the end of the object or array starting at the current position and
+ * counts its direct children without allocating any tokens.
+ */
+static int jsmn_scan_container(jsmn_parser *parser, const char *js,
+		size_t len, jsmntok_t *token) {
+	int depth = 0;
+	int size = 0;
+	int empty = 1;
+	size_t pos;
+
+	for (pos = parser->pos; pos < len && js[pos] != '\0'; pos++) {
+		char c = js[pos];
+		switch (c) {
+			case '{': case '[':
+				if (depth == 1) empty = 0;
+				depth++;
+				break;
+			case '}': case ']':
+				depth--;
+				if (depth == 0) {
+					token->type = (js[parser->pos] == '{' ? JSMN_OBJECT : JSMN_ARRAY);
+					if ((c == '}') != (token->type == JSMN_OBJECT)) {
+						return JSMN_ERROR_INVAL;
+					}
+					token->start = parser->pos;
+					token->end = pos + 1;
+					token->size = empty ? 0 : size + 1;
+					return 0;
+				}
+				break;
+			case '\"':
+				if (depth == 1) empty = 0;
+				/* skip string contents including escaped quotes */
+				for (pos++; pos < len && js[pos] != '\"'; pos++) {
+					if (js[pos] == '\\') pos++;
+				}
+				break;
+			case ',':
+				if (depth == 1) size++;
+				break;
+			case '\t' : case '\r' : case '\n' : case ' ': case ':':
+				break;
+			default:
+				if (depth == 1) empty = 0;
+				break;
+		}
+	}
+	return JSMN_ERROR_PART;
+}
+
+/**
+ * Pull-mode tokenizer: fills only the next token in document order.
+ */
+int jsmn_next(jsmn_parser *parser, const char *js, size_t len,
+		jsmntok_t *token) {
+	int r;
+	int16_t toknext;
+
+	for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
+		switch (js[parser->pos]) {
+			case '{': case '[':
+				r = jsmn_scan_container(parser, js, len, token);
+				if (r < 0) return r;
+				parser->pos++;
+				return 1;
+			case '}': case ']': case ':': case ',':
+			case '\t' : case '\r' : case '\n' : case ' ':
+				break;
+			case '\"':
+				/* use token as a pool with exactly one element */
+				toknext = parser->toknext;
+				parser->toknext = 0;
+				r = jsmn_parse_string(parser, js, len, token, 1);
+				parser->toknext = toknext;
+				if (r < 0) return r;
+				parser->pos++;
+				return 1;
+#ifdef JSMN_STRICT
+			case '-': case '0': case '1' : case '2': case '3' : case '4':
+			case '5': case '6': case '7' : case '8': case '9':
+			case 't': case 'f': case 'n' :
+#else
+			default:
+#endif
+				toknext = parser->toknext;
+				parser->toknext = 0;
+				r = jsmn_parse_primitive(parser, js, len, token, 1);
+				parser->toknext = toknext;
+				if (r < 0) return r;
+				parser->pos++;
+				return 1;
+#ifdef JSMN_STRICT
+			default:
+				return JSMN_ERROR_INVAL;
+#endif
+		}
+	}
+	return 0;
+}
+
 /**
  * Creates a new parser based over a given  buffer with an array of tokens
  * available.
@@ -72,6 +72,16 @@ void jsmn_init(jsmn_parser *parser);
 int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
 		jsmntok_t *tokens, unsigned int num_tokens);
 
+/**
+ * Run JSON parser in pull mode. Only the next token in the JSON data string is
+ * parsed and stored in token, so memory usage does not depend on the size of the
+ * data. The end and size of objects and arrays are determined by scanning ahead.
+ *
+ * Returns 1 if a token was found, 0 at the end of the data or a negative error code.
+ */
+int jsmn_next(jsmn_parser *parser, const char *js, size_t len,
+		jsmntok_t *token);
+
 #ifdef __cplusplus
 }
 #endif
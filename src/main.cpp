@@ -4,9 +4,12 @@
  * Copyright (c) 2020 Martin Jäger / Libre Solar
  */
 
-#if defined(NATIVE_BUILD) && !defined(UNIT_TEST)
+#if defined(NATIVE_BUILD) && !defined(UNIT_TEST) && !defined(NATIVE_SERVER) && \
+    !defined(NATIVE_BENCH) && !defined(NATIVE_REPLAY) && !defined(NATIVE_PROFILE) && \
+    !defined(NATIVE_EMULATOR)
 
 #include "thingset.h"
+#include "pub_scheduler.h"
 #include "../test/test_data.h"
 #include "../test/test_functions.h"
 
@@ -14,22 +17,47 @@
 #include <stdlib.h>
 #include <string.h>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <iostream>
 
 #include "linenoise.h"
 
 ThingSet ts(data_nodes, sizeof(data_nodes)/sizeof(DataNode));
 
+std::mutex pub_mutex;
+std::condition_variable pub_changed;
+
 void pub_thread()
 {
     char pub_msg[1000];
+    static uint32_t pub_serial_checksums[sizeof(data_nodes)/sizeof(DataNode)];
+    PubDelta pub_serial_delta = {
+        pub_serial_checksums, sizeof(pub_serial_checksums)/sizeof(uint32_t), 0, 0
+    };
+    PubScheduler scheduler(&ts);
+    auto start = std::chrono::steady_clock::now();
 
     while (1) {
-        if (pub_serial_enable) {
-            ts.txt_pub(pub_msg, sizeof(pub_msg), PUB_SER);
-            printf("%s\r\n", pub_msg);
+        uint32_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        uint32_t wait_ms;
+        uint16_t channels = scheduler.poll(now, &wait_ms);
+
+        if (channels & PUB_SER) {
+            pub_serial_delta.refresh_interval = pub_serial_refresh;
+            int len = ts.txt_pub(pub_msg, sizeof(pub_msg), PUB_SER,
+                pub_serial_on_change ? &pub_serial_delta : NULL);
+            if (len > 0) {
+                printf("%s\r\n", pub_msg);
+            }
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(pub_serial_interval));
+        // PUB_CAN is ignored, as there is no CAN interface in the native build
+
+        // wake up early if the publication setup is changed by a request
+        std::unique_lock<std::mutex> lock(pub_mutex);
+        pub_changed.wait_for(lock, std::chrono::milliseconds(wait_ms));
     }
 }
 
@@ -54,6 +82,10 @@ int main()
             linenoiseHistorySave(".thingset-shell-history.txt");
             ts.process((uint8_t *)line, strlen(line), resp_buf, sizeof(resp_buf));
             printf("%s\n", (char *)resp_buf);
+            pub_changed.notify_one();
+#if TS_DEFERRED_CALLBACKS
+            ts.run_deferred_callbacks();
+#endif
         }
         free(line);
     }
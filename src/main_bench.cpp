@@ -0,0 +1,667 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#if defined(NATIVE_BENCH) && !defined(UNIT_TEST)
+
+#include "thingset.h"
+#include "cbor.h"
+#include "stack_usage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * Minimum measurement time per benchmark
+ */
+#define BENCH_MIN_TIME_NS   50000000
+
+/*
+ * Number of rounds the measurement time is split into
+ */
+#define BENCH_ROUNDS        5
+
+/*
+ * Number of values encoded or decoded per operation of the CBOR microbenchmarks
+ */
+#define BENCH_CBOR_VALUES   256
+
+#define ID_DATA     0x01
+#define ID_EXEC     0x02
+#define ID_RUN      0x03
+#define ID_VALUES   0x100       // first ID of the generated value nodes
+
+#define PUB_SER     (1U << 0)   // UART serial
+#define PUB_CAN     (1U << 1)   // CAN bus
+
+typedef std::function<int()> BenchOp;
+
+static int exec_count;
+
+static volatile int64_t sink;      // prevents that decoded values are optimized out
+
+static void bench_exec()
+{
+    exec_count++;
+}
+
+/*
+ * Synthetic node tree with num_nodes nodes: a path "data" with float and int32 value nodes
+ * (alternating, all published via serial and CAN) and an exec node "exec/run"
+ */
+class BenchTree
+{
+public:
+    BenchTree(int num_nodes)
+    {
+        int num_values = num_nodes - 3;
+
+        names.reserve(num_values);
+        floats.resize(num_values);
+        ints.resize(num_values);
+        nodes.reserve(num_nodes);
+
+        nodes.push_back(TS_NODE_PATH(ID_DATA, "data", 0, NULL));
+        nodes.push_back(TS_NODE_PATH(ID_EXEC, "exec", 0, NULL));
+        nodes.push_back(TS_NODE_EXEC(ID_RUN, "run", &bench_exec, ID_EXEC, TS_ANY_RW));
+
+        for (int i = 0; i < num_values; i++) {
+            names.push_back("v" + std::to_string(i));
+            floats[i] = i * 0.25F;
+            ints[i] = i * 7;
+            if (i % 2 == 0) {
+                nodes.push_back(TS_NODE_FLOAT((node_id_t)(ID_VALUES + i), names[i].c_str(),
+                    &floats[i], 2, ID_DATA, TS_ANY_RW, PUB_SER | PUB_CAN));
+            }
+            else {
+                nodes.push_back(TS_NODE_INT32((node_id_t)(ID_VALUES + i), names[i].c_str(),
+                    &ints[i], ID_DATA, TS_ANY_RW, PUB_SER | PUB_CAN));
+            }
+        }
+
+        ts = new ThingSet(nodes.data(), nodes.size());
+    }
+
+    ~BenchTree()
+    {
+        delete ts;
+    }
+
+    /*
+     * Index of the value node number n of num spread over the entire tree
+     */
+    int spread(int n, int num)
+    {
+        return (int)((names.size() - 1) * n / (num - 1)) & ~1;   // float nodes only
+    }
+
+    ThingSet *ts;
+    std::vector<DataNode> nodes;
+    std::vector<std::string> names;
+    std::vector<float> floats;
+    std::vector<int32_t> ints;
+};
+
+static uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Average time of one call of the operation in ns (minimum of several rounds to reduce the
+ * influence of other processes)
+ */
+static double time_op(BenchOp &op)
+{
+    double min_time = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        uint64_t iterations = 0;
+        uint64_t start = now_ns();
+        uint64_t elapsed;
+        do {
+            for (int i = 0; i < 10; i++) {
+                op();
+            }
+            iterations += 10;
+            elapsed = now_ns() - start;
+        } while (elapsed < BENCH_MIN_TIME_NS / BENCH_ROUNDS);
+
+        double time = (double)elapsed / iterations;
+        if (round == 0 || time < min_time) {
+            min_time = time;
+        }
+    }
+    return min_time;
+}
+
+static void run_bench(const char *name, int num_nodes, BenchOp op)
+{
+    int bytes = op();      // warm-up, also provides the response length
+
+    printf("%-16s %6d %12.1f %10d %8zu\n", name, num_nodes, time_op(op), bytes, stack_usage(op));
+}
+
+/*
+ * Runs an operation processing BENCH_CBOR_VALUES values and prints the time per value
+ */
+static void run_micro(const char *name, BenchOp op)
+{
+    int bytes = op();
+
+    printf("%-28s %10.2f %10.2f\n", name, time_op(op) / BENCH_CBOR_VALUES,
+        (double)bytes / BENCH_CBOR_VALUES);
+}
+
+/*
+ * Microbenchmarks of the CBOR primitives in cbor.c (reference implementation and fast paths)
+ *
+ * The integers have random bit lengths of up to 31 bits, so the encoded width changes from
+ * value to value like in publication messages with different data types.
+ */
+static void bench_cbor()
+{
+    static int64_t ints[BENCH_CBOR_VALUES];
+    static uint32_t uints[BENCH_CBOR_VALUES];
+    static float floats[BENCH_CBOR_VALUES];
+    static uint8_t uint_buf[BENCH_CBOR_VALUES * 9];
+    static uint8_t int_buf[BENCH_CBOR_VALUES * 9];
+    static uint8_t short_buf[BENCH_CBOR_VALUES * 3];
+    static uint8_t float_buf[BENCH_CBOR_VALUES * 5];
+    static uint8_t misc_buf[BENCH_CBOR_VALUES * 16];
+
+    uint32_t rnd = 12345;
+    for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+        rnd = rnd * 1103515245 + 12345;
+        int bits = (rnd >> 16) % 32;
+        rnd = rnd * 1103515245 + 12345;
+        ints[i] = (rnd >> 1) & ((1UL << bits) - 1);
+        if (rnd & 1) {
+            ints[i] = -1 - ints[i];
+        }
+        uints[i] = (ints[i] < 0) ? -1 - ints[i] : ints[i];
+        floats[i] = ints[i] * 0.01F;
+    }
+
+    int uint_len = 0, int_len = 0, short_len = 0, float_len = 0;
+    for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+        short_len += cbor_serialize_uint(&short_buf[short_len], uints[i] & INT16_MAX, 3);
+        uint_len += cbor_serialize_uint(&uint_buf[uint_len], uints[i], 9);
+        int_len += cbor_serialize_int(&int_buf[int_len], ints[i], 9);
+        float_len += cbor_serialize_float(&float_buf[float_len], floats[i], 5);
+    }
+
+    printf("%-28s %10s %10s\n", "cbor primitive", "ns/value", "bytes");
+
+    // serialization
+    run_micro("serialize_uint", [&]() {
+        int len = 0;
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            len += cbor_serialize_uint(&misc_buf[len], uints[i], 9);
+        }
+        return len;
+    });
+    run_micro("serialize_uint_fast", [&]() {
+        int len = 0;
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            len += cbor_serialize_uint_fast(&misc_buf[len], uints[i], 9);
+        }
+        return len;
+    });
+    run_micro("serialize_int", [&]() {
+        int len = 0;
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            len += cbor_serialize_int(&misc_buf[len], ints[i], 9);
+        }
+        return len;
+    });
+    run_micro("serialize_int_fast", [&]() {
+        int len = 0;
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            len += cbor_serialize_int_fast(&misc_buf[len], ints[i], 9);
+        }
+        return len;
+    });
+    run_micro("serialize_float", [&]() {
+        int len = 0;
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            len += cbor_serialize_float(&misc_buf[len], floats[i], 5);
+        }
+        return len;
+    });
+    run_micro("serialize_float_fast", [&]() {
+        int len = 0;
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            len += cbor_serialize_float_fast(&misc_buf[len], floats[i], 5);
+        }
+        return len;
+    });
+    run_micro("serialize_bool", [&]() {
+        int len = 0;
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            len += cbor_serialize_bool(&misc_buf[len], ints[i] & 1, 1);
+        }
+        return len;
+    });
+    run_micro("serialize_string", [&]() {
+        int len = 0;
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            len += cbor_serialize_string(&misc_buf[len], (i & 1) ? "Bat_V" : "Ambient_degC", 16);
+        }
+        return len;
+    });
+    run_micro("serialize_map", [&]() {
+        int len = 0;
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            len += cbor_serialize_map(&misc_buf[len], ints[i] & 0xFF, 3);
+        }
+        return len;
+    });
+    run_micro("serialize_array", [&]() {
+        int len = 0;
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            len += cbor_serialize_array(&misc_buf[len], ints[i] & 0xFF, 3);
+        }
+        return len;
+    });
+
+    // deserialization
+    run_micro("uint_data", [&]() {
+        int pos = 0;
+        uint64_t value;
+        while (pos < uint_len) {
+            pos += _cbor_uint_data(&uint_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("uint_data_fast", [&]() {
+        int pos = 0;
+        uint64_t value;
+        while (pos < uint_len) {
+            pos += _cbor_uint_data_fast(&uint_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_uint64", [&]() {
+        int pos = 0;
+        uint64_t value;
+        while (pos < uint_len) {
+            pos += cbor_deserialize_uint64(&uint_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_uint64_fast", [&]() {
+        int pos = 0;
+        uint64_t value;
+        while (pos < uint_len) {
+            pos += cbor_deserialize_uint64_fast(&uint_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_int64", [&]() {
+        int pos = 0;
+        int64_t value;
+        while (pos < int_len) {
+            pos += cbor_deserialize_int64(&int_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_int64_fast", [&]() {
+        int pos = 0;
+        int64_t value;
+        while (pos < int_len) {
+            pos += cbor_deserialize_int64_fast(&int_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_uint32", [&]() {
+        int pos = 0;
+        uint32_t value;
+        while (pos < uint_len) {
+            pos += cbor_deserialize_uint32(&uint_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_uint32_fast", [&]() {
+        int pos = 0;
+        uint32_t value;
+        while (pos < uint_len) {
+            pos += cbor_deserialize_uint32_fast(&uint_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_int32", [&]() {
+        int pos = 0;
+        int32_t value;
+        while (pos < int_len) {
+            pos += cbor_deserialize_int32(&int_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_int32_fast", [&]() {
+        int pos = 0;
+        int32_t value;
+        while (pos < int_len) {
+            pos += cbor_deserialize_int32_fast(&int_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_uint16", [&]() {
+        int pos = 0;
+        uint16_t value;
+        while (pos < short_len) {
+            pos += cbor_deserialize_uint16(&short_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_uint16_fast", [&]() {
+        int pos = 0;
+        uint16_t value;
+        while (pos < short_len) {
+            pos += cbor_deserialize_uint16_fast(&short_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_int16", [&]() {
+        int pos = 0;
+        int16_t value;
+        while (pos < short_len) {
+            pos += cbor_deserialize_int16(&short_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_int16_fast", [&]() {
+        int pos = 0;
+        int16_t value;
+        while (pos < short_len) {
+            pos += cbor_deserialize_int16_fast(&short_buf[pos], &value);
+            sink = value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_float", [&]() {
+        int pos = 0;
+        float value;
+        while (pos < float_len) {
+            pos += cbor_deserialize_float(&float_buf[pos], &value);
+            sink = (int64_t)value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_float_fast", [&]() {
+        int pos = 0;
+        float value;
+        while (pos < float_len) {
+            pos += cbor_deserialize_float_fast(&float_buf[pos], &value);
+            sink = (int64_t)value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_float(int)", [&]() {
+        int pos = 0;
+        float value;
+        while (pos < int_len) {
+            pos += cbor_deserialize_float(&int_buf[pos], &value);
+            sink = (int64_t)value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_float_fast(int)", [&]() {
+        int pos = 0;
+        float value;
+        while (pos < int_len) {
+            pos += cbor_deserialize_float_fast(&int_buf[pos], &value);
+            sink = (int64_t)value;
+        }
+        return pos;
+    });
+    run_micro("deserialize_bool", [&]() {
+        bool value;
+        uint8_t data[2] = { CBOR_TRUE, CBOR_FALSE };
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            cbor_deserialize_bool(&data[i & 1], &value);
+            sink = value;
+        }
+        return BENCH_CBOR_VALUES;
+    });
+    run_micro("deserialize_string", [&]() {
+        int len = cbor_serialize_string(misc_buf, "Ambient_degC", 16);
+        char value[16];
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            cbor_deserialize_string(misc_buf, value, sizeof(value));
+            sink = value[i & 7];
+        }
+        return len * BENCH_CBOR_VALUES;
+    });
+    run_micro("num_elements", [&]() {
+        uint16_t num;
+        uint8_t data[3] = { 0xB9, 0x01, 0x00 };
+        for (int i = 0; i < BENCH_CBOR_VALUES; i++) {
+            cbor_num_elements(&data[(i & 1) * 2], &num);    // 0xB9 0x01 0x00 or 0x00 (uint)
+            sink = num;
+        }
+        return BENCH_CBOR_VALUES;
+    });
+    run_micro("size", [&]() {
+        int pos = 0;
+        while (pos < int_len) {
+            pos += cbor_size(&int_buf[pos]);
+        }
+        return pos;
+    });
+    printf("\n");
+}
+
+static void bench_tree(int num_nodes)
+{
+    BenchTree tree(num_nodes);
+    ThingSet *ts = tree.ts;
+
+    static uint8_t resp[256 * 1024];
+    static uint8_t msg[256 * 1024];
+    const int num_fetch = 10;
+
+    // text mode requests
+    std::string txt_get = "?data";
+
+    std::string txt_fetch = "?data [";
+    for (int i = 0; i < num_fetch; i++) {
+        txt_fetch += "\"" + tree.names[tree.spread(i, num_fetch)] + "\",";
+    }
+    txt_fetch.back() = ']';
+
+    std::string txt_patch = "=data {\"" + tree.names[tree.spread(1, 2)] + "\":1.5}";
+
+    std::string txt_exec = "!exec/run";
+
+    // binary mode requests
+    std::vector<uint8_t> bin_get = { TS_GET, ID_DATA, 0xA0 };
+
+    std::vector<uint8_t> bin_fetch = { TS_FETCH, ID_DATA, (uint8_t)(0x80 + num_fetch) };
+    for (int i = 0; i < num_fetch; i++) {
+        uint16_t id = ID_VALUES + tree.spread(i, num_fetch);
+        bin_fetch.insert(bin_fetch.end(), { 0x19, (uint8_t)(id >> 8), (uint8_t)id });
+    }
+
+    uint16_t patch_id = ID_VALUES + tree.spread(1, 2);
+    std::vector<uint8_t> bin_patch = { TS_PATCH, ID_DATA, 0xA1,
+        0x19, (uint8_t)(patch_id >> 8), (uint8_t)patch_id,
+        0xFA, 0x3F, 0xC0, 0x00, 0x00 };     // 1.5
+
+    std::vector<uint8_t> bin_exec = { TS_POST, ID_RUN, 0x80 };
+
+    std::vector<std::pair<const char *, std::string>> txt_reqs = {
+        { "txt GET", txt_get }, { "txt FETCH", txt_fetch }, { "txt PATCH", txt_patch },
+        { "txt exec", txt_exec },
+    };
+    for (size_t i = 0; i < txt_reqs.size(); i++) {
+        std::string &req = txt_reqs[i].second;
+        run_bench(txt_reqs[i].first, num_nodes, [&]() {
+            return ts->process((uint8_t *)&req[0], req.size(), resp, sizeof(resp));
+        });
+    }
+
+    std::vector<std::pair<const char *, std::vector<uint8_t>>> bin_reqs = {
+        { "bin GET", bin_get }, { "bin FETCH", bin_fetch }, { "bin PATCH", bin_patch },
+        { "bin exec", bin_exec },
+    };
+    for (size_t i = 0; i < bin_reqs.size(); i++) {
+        std::vector<uint8_t> &req = bin_reqs[i].second;
+        run_bench(bin_reqs[i].first, num_nodes, [&]() {
+            return ts->process(req.data(), req.size(), resp, sizeof(resp));
+        });
+    }
+
+#if TS_HOT_NODES > 0
+    // same FETCH request with the fetched nodes in the lookaside list
+    std::vector<node_id_t> hot_ids;
+    for (int i = 0; i < num_fetch; i++) {
+        hot_ids.push_back(ID_VALUES + tree.spread(i, num_fetch));
+    }
+    ts->set_hot_nodes(hot_ids.data(), hot_ids.size());
+    run_bench("bin FETCH hot", num_nodes, [&]() {
+        return ts->process(bin_fetch.data(), bin_fetch.size(), resp, sizeof(resp));
+    });
+    ts->set_hot_nodes(NULL, 0);
+#endif
+
+    run_bench("txt_pub", num_nodes, [&]() {
+        return ts->txt_pub((char *)msg, sizeof(msg), PUB_SER);
+    });
+
+    run_bench("bin_pub", num_nodes, [&]() {
+        return ts->bin_pub(msg, sizeof(msg), PUB_SER);
+    });
+
+    run_bench("bin_pub_can", num_nodes, [&]() {
+        // all messages of one publication cycle
+        int start_pos = 0;
+        int bytes = 0;
+        int len;
+        uint32_t msg_id;
+        uint8_t can_data[8];
+        while ((len = ts->bin_pub_can(start_pos, PUB_CAN, 0x14, msg_id, can_data)) != -1) {
+            bytes += len;
+        }
+        return bytes;
+    });
+}
+
+static void dump_json_discard(const char *buf, size_t len, void *arg)
+{
+}
+
+/*
+ * Peak stack usage of the request paths for a tree with depth nested path nodes "p" and two
+ * value nodes at the deepest level
+ */
+static void bench_depth(int depth)
+{
+    float f32 = 1.5F;
+    int32_t i32 = 2;
+    std::vector<DataNode> nodes;
+    for (int d = 0; d < depth; d++) {
+        nodes.push_back(TS_NODE_PATH((node_id_t)(ID_VALUES + d), "p",
+            (node_id_t)(d > 0 ? ID_VALUES + d - 1 : 0), NULL));
+    }
+    node_id_t parent = ID_VALUES + depth - 1;
+    nodes.push_back(TS_NODE_FLOAT(0x40, "f", &f32, 2, parent, TS_ANY_RW, PUB_SER));
+    nodes.push_back(TS_NODE_INT32(0x41, "i", &i32, parent, TS_ANY_RW, PUB_SER));
+    ThingSet ts(nodes.data(), nodes.size());
+
+    static uint8_t resp[1024];
+    std::string path = "p";
+    for (int d = 1; d < depth; d++) {
+        path += "/p";
+    }
+
+    std::vector<std::pair<const char *, std::string>> txt_reqs = {
+        { "txt GET", "?" + path }, { "txt FETCH", "?" + path + " [\"f\",\"i\"]" },
+        { "txt PATCH", "=" + path + " {\"f\":2.5,\"i\":3}" },
+    };
+    for (size_t i = 0; i < txt_reqs.size(); i++) {
+        std::string &req = txt_reqs[i].second;
+        printf("%-16s %6d %8zu\n", txt_reqs[i].first, depth, stack_usage([&]() {
+            ts.process((uint8_t *)&req[0], req.size(), resp, sizeof(resp));
+        }));
+    }
+
+    std::vector<std::pair<const char *, std::vector<uint8_t>>> bin_reqs = {
+        { "bin GET", { TS_GET, 0x19, (uint8_t)(parent >> 8), (uint8_t)parent, 0xA0 } },
+        { "bin FETCH", { TS_FETCH, 0x19, (uint8_t)(parent >> 8), (uint8_t)parent, 0x82,
+            0x18, 0x40, 0x18, 0x41 } },
+        { "bin PATCH", { TS_PATCH, 0x19, (uint8_t)(parent >> 8), (uint8_t)parent, 0xA1,
+            0x18, 0x41, 0x03 } },
+    };
+    for (size_t i = 0; i < bin_reqs.size(); i++) {
+        std::vector<uint8_t> &req = bin_reqs[i].second;
+        printf("%-16s %6d %8zu\n", bin_reqs[i].first, depth, stack_usage([&]() {
+            ts.process(req.data(), req.size(), resp, sizeof(resp));
+        }));
+    }
+
+    printf("%-16s %6d %8zu\n", "txt_pub", depth, stack_usage([&]() {
+        ts.txt_pub((char *)resp, sizeof(resp), PUB_SER);
+    }));
+    printf("%-16s %6d %8zu\n", "bin_pub", depth, stack_usage([&]() {
+        ts.bin_pub(resp, sizeof(resp), PUB_SER);
+    }));
+    printf("%-16s %6d %8zu\n", "dump_json", depth, stack_usage([&]() {
+        ts.dump_json(dump_json_discard, NULL);
+    }));
+}
+
+/*
+ * Usage: thingset-bench [num_nodes ...]
+ */
+int main(int argc, char *argv[])
+{
+    std::vector<int> sizes = { 10, 100, 1000, 10000 };
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; i++) {
+            sizes.push_back(atoi(argv[i]) > 4 ? atoi(argv[i]) : 4);
+        }
+    }
+
+    bench_cbor();
+
+    printf("%-16s %6s %12s %10s %8s\n", "benchmark", "nodes", "ns/op", "bytes/op", "stack");
+    for (size_t i = 0; i < sizes.size(); i++) {
+        bench_tree(sizes[i]);
+    }
+
+    printf("\n%-16s %6s %8s\n", "request", "depth", "stack");
+    const int depths[] = { 1, 4, 8 };
+    for (size_t i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        bench_depth(depths[i]);
+    }
+
+    printf("\nsizeof(ThingSet) = %zu, sizeof(ThingSetContext) = %zu\n", sizeof(ThingSet),
+        sizeof(ThingSetContext));
+
+    return 0;
+}
+
+#endif
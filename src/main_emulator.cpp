@@ -0,0 +1,253 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#if defined(NATIVE_EMULATOR) && !defined(UNIT_TEST)
+
+#include "thingset.h"
+#include "thingset_gateway.h"
+#include "random_tree.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Number of requests generated in advance per device
+ */
+#define EMU_REQS_PER_DEVICE     8
+
+/*
+ * Maximum number of requests of one client waiting for a response
+ */
+#define EMU_WINDOW              64
+
+/*
+ * Maximum number of devices per gateway (limited by the 8-bit device ID)
+ */
+#define EMU_DEVICES_PER_GATEWAY 256
+
+/*
+ * Emulated device with a random node tree and requests for it
+ */
+struct Device {
+    std::unique_ptr<RandomTree> tree;
+    std::vector<std::vector<uint8_t>> reqs;
+    ThingSetGateway *gateway;
+    uint8_t dev_id;
+};
+
+/*
+ * Client sending requests to random devices
+ */
+struct Client {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    int in_flight = 0;
+    std::vector<uint32_t> latency_ns;
+    uint64_t errors = 0;
+};
+
+static uint32_t xorshift(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void append(std::vector<uint8_t> &req, const std::string &str)
+{
+    req.insert(req.end(), str.begin(), str.end());
+}
+
+static void append_id(std::vector<uint8_t> &req, node_id_t id)
+{
+    req.insert(req.end(), { 0x19, (uint8_t)(id >> 8), (uint8_t)id });
+}
+
+/*
+ * Generates a mix of text and binary mode GET, FETCH and PATCH requests for a device
+ */
+static void generate_requests(Device *dev, uint32_t seed)
+{
+    RandomTree *tree = dev->tree.get();
+    uint32_t state = seed;
+
+    for (int i = 0; i < EMU_REQS_PER_DEVICE; i++) {
+        std::vector<uint8_t> req;
+        node_id_t value_id = tree->values[xorshift(&state) % tree->values.size()];
+        const DataNode *node = tree->ts->get_node(value_id);
+
+        switch (i % 4) {
+            case 0:     // text mode GET of the child node names (paths may contain paths)
+                append(req, "?" + tree->path(node->parent) + "/");
+                break;
+            case 1:     // binary mode GET of a path
+                req.push_back(TS_GET);
+                append_id(req, node->parent);
+                req.push_back(0xA0);
+                break;
+            case 2: {   // binary mode FETCH of a value
+                req.push_back(TS_FETCH);
+                append_id(req, node->parent);
+                append_id(req, value_id);
+                break;
+            }
+            case 3:     // text mode PATCH of a writable value or FETCH of a value
+                if (!tree->writable.empty()) {
+                    node = tree->ts->get_node(
+                        tree->writable[xorshift(&state) % tree->writable.size()]);
+                    append(req, "=" + tree->path(node->parent) + " {\"" + node->name + "\":" +
+                        std::to_string(xorshift(&state) % 100) + "}");
+                }
+                else {
+                    append(req, "?" + tree->path(node->parent) + " [\"" + node->name + "\"]");
+                }
+                break;
+        }
+        dev->reqs.push_back(req);
+    }
+}
+
+static void run_client(Client *client, std::vector<Device> *devices, uint32_t seed,
+    std::chrono::steady_clock::time_point end)
+{
+    uint32_t state = seed;
+
+    while (std::chrono::steady_clock::now() < end) {
+        {
+            std::unique_lock<std::mutex> lock(client->mutex);
+            client->cv.wait(lock, [client]{ return client->in_flight < EMU_WINDOW; });
+            client->in_flight++;
+        }
+
+        Device *dev = &(*devices)[xorshift(&state) % devices->size()];
+        std::vector<uint8_t> &req = dev->reqs[xorshift(&state) % dev->reqs.size()];
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        dev->gateway->submit(dev->dev_id, req.data(), req.size(),
+            [client, start](const uint8_t *resp, int resp_len) {
+                uint32_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+                // status code is the first byte in binary mode or ":XX" in text mode
+                bool error = (resp_len <= 0) ||
+                    (resp[0] == ':' ? resp_len < 2 || resp[1] >= 'A' : resp[0] >= 0xA0);
+                std::lock_guard<std::mutex> lock(client->mutex);
+                client->latency_ns.push_back(ns);
+                client->errors += error;
+                client->in_flight--;
+                client->cv.notify_one();
+            });
+    }
+
+    // wait for all responses
+    std::unique_lock<std::mutex> lock(client->mutex);
+    client->cv.wait(lock, [client]{ return client->in_flight == 0; });
+}
+
+/*
+ * Usage: thingset-emulator [num_devices] [num_nodes] [duration_s] [num_clients] [num_shards]
+ *
+ * Emulates many devices with randomized node trees (each device has a different tree) served
+ * by gateways with up to 256 devices each. The clients send requests to random devices and
+ * the throughput and latency percentiles of all gateways are reported.
+ */
+int main(int argc, char *argv[])
+{
+    int num_devices = (argc > 1) ? atoi(argv[1]) : 1024;
+    int num_nodes = (argc > 2) ? atoi(argv[2]) : 200;
+    double duration = (argc > 3) ? atof(argv[3]) : 5.0;
+    int num_clients = (argc > 4) ? atoi(argv[4]) : 4;
+    int num_shards = (argc > 5) ? atoi(argv[5]) : 0;
+
+    if (num_devices <= 0 || num_nodes < 2 || num_clients <= 0) {
+        // the tree needs at least one path and one value node to generate requests
+        printf("Invalid arguments\n");
+        return 1;
+    }
+
+    int num_gateways = (num_devices + EMU_DEVICES_PER_GATEWAY - 1) / EMU_DEVICES_PER_GATEWAY;
+    std::vector<std::unique_ptr<ThingSetGateway>> gateways;
+    for (int i = 0; i < num_gateways; i++) {
+        gateways.emplace_back(new ThingSetGateway(num_shards));
+    }
+
+    std::chrono::steady_clock::time_point t_setup = std::chrono::steady_clock::now();
+    std::vector<Device> devices(num_devices);
+    size_t total_nodes = 0;
+    for (int i = 0; i < num_devices; i++) {
+        RandomTreeConfig config;
+        config.seed = i + 1;
+        config.num_nodes = num_nodes;
+        devices[i].tree.reset(new RandomTree(config));
+        devices[i].gateway = gateways[i / EMU_DEVICES_PER_GATEWAY].get();
+        devices[i].dev_id = i % EMU_DEVICES_PER_GATEWAY;
+        devices[i].gateway->add_device(devices[i].dev_id, devices[i].tree->ts);
+        generate_requests(&devices[i], i + 1);
+        total_nodes += devices[i].tree->nodes.size();
+    }
+    double setup_s = std::chrono::duration_cast<std::chrono::duration<double>>(
+        std::chrono::steady_clock::now() - t_setup).count();
+
+    printf("devices:    %d with %zu nodes in total (generated in %.2f s)\n", num_devices,
+        total_nodes, setup_s);
+    printf("gateways:   %d with %d shards each\n", num_gateways, gateways[0]->get_num_shards());
+    printf("clients:    %d with up to %d requests in flight each\n", num_clients, EMU_WINDOW);
+
+    for (int i = 0; i < num_gateways; i++) {
+        gateways[i]->start();
+    }
+
+    std::vector<Client> clients(num_clients);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point end = start +
+        std::chrono::microseconds((int64_t)(duration * 1e6));
+    for (int i = 0; i < num_clients; i++) {
+        clients[i].thread = std::thread(run_client, &clients[i], &devices, 1000 + i, end);
+    }
+    for (int i = 0; i < num_clients; i++) {
+        clients[i].thread.join();
+    }
+    double elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+        std::chrono::steady_clock::now() - start).count();
+
+    for (int i = 0; i < num_gateways; i++) {
+        gateways[i]->stop();
+    }
+
+    std::vector<uint32_t> latency;
+    uint64_t errors = 0;
+    for (int i = 0; i < num_clients; i++) {
+        latency.insert(latency.end(), clients[i].latency_ns.begin(),
+            clients[i].latency_ns.end());
+        errors += clients[i].errors;
+    }
+    std::sort(latency.begin(), latency.end());
+
+    printf("requests:   %zu in %.2f s (%llu error responses)\n", latency.size(), elapsed,
+        (unsigned long long)errors);
+    printf("throughput: %.0f requests/s\n", latency.size() / elapsed);
+    if (!latency.empty()) {
+        printf("latency:    p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+            latency[(latency.size() - 1) * 50 / 100] / 1000.0,
+            latency[(latency.size() - 1) * 90 / 100] / 1000.0,
+            latency[(latency.size() - 1) * 99 / 100] / 1000.0, latency.back() / 1000.0);
+    }
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#if defined(NATIVE_PROFILE) && !defined(UNIT_TEST)
+
+#include "thingset.h"
+#include "thingset_capture.h"
+#include "../test/test_data.h"
+#include "../test/test_functions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#if !TS_NODE_PROFILING
+#error "TS_NODE_PROFILING must be enabled to build the profiler"
+#endif
+
+#define NUM_NODES (sizeof(data_nodes)/sizeof(DataNode))
+
+/*
+ * Size of the response buffer (same as the default of the server)
+ */
+#define PROFILE_RESP_SIZE   4096
+
+ThingSet ts(data_nodes, NUM_NODES);
+
+static uint8_t resp[PROFILE_RESP_SIZE];
+
+static uint32_t node_profile[NUM_NODES];
+
+/*
+ * Usage: thingset-profile capture_file [num_hot_nodes]
+ *
+ * Processes all requests of a capture file and prints the node access counts as well as the
+ * most frequently accessed nodes as a lookaside list for ThingSet::set_hot_nodes.
+ */
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        printf("Usage: %s capture_file [num_hot_nodes]\n", argv[0]);
+        return 1;
+    }
+    size_t num_hot = (argc > 2) ? atoi(argv[2]) : 8;
+
+    ThingSetCaptureReader reader;
+    if (reader.open(argv[1]) < 0) {
+        printf("Could not open capture file %s\n", argv[1]);
+        return 1;
+    }
+
+    ts.set_node_profile(node_profile);
+
+    CaptureRecord rec;
+    std::unordered_map<uint32_t, ThingSetContext> contexts;     // one per captured connection
+    int num_requests = 0;
+    while (reader.read(&rec)) {
+        ts.process(rec.req.data(), rec.req.size(), resp, sizeof(resp), &contexts[rec.conn_id]);
+        num_requests++;
+    }
+    reader.close();
+
+    // node indices sorted by access count (stable, so equal counts keep the table order)
+    std::vector<size_t> order;
+    for (size_t i = 0; i < NUM_NODES; i++) {
+        if (node_profile[i] > 0) {
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [](size_t a, size_t b) {
+        return node_profile[a] > node_profile[b];
+    });
+
+    printf("// %d requests, %zu of %zu nodes accessed\n//\n", num_requests, order.size(),
+        NUM_NODES);
+    printf("// %10s %8s  %s\n", "accesses", "index", "name");
+    for (size_t i = 0; i < order.size(); i++) {
+        printf("// %10u %8zu  %s\n", node_profile[order[i]], order[i],
+            data_nodes[order[i]].name);
+    }
+
+    printf("\nconst node_id_t hot_nodes[] = {\n");
+    for (size_t i = 0; i < order.size() && i < num_hot; i++) {
+        const DataNode *node = &data_nodes[order[i]];
+        printf("    0x%04X,     // %s\n", node->id, node->name);
+    }
+    printf("};\n");
+
+    return 0;
+}
+
+void conf_callback()
+{
+    // no output, as it would be mixed with the generated code
+}
+
+void dummy()
+{
+    // do nothing, only used in unit-tests
+}
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#if defined(NATIVE_REPLAY) && !defined(UNIT_TEST)
+
+#include "thingset.h"
+#include "thingset_capture.h"
+#include "../test/test_data.h"
+#include "../test/test_functions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Size of the response buffer (same as the default of the server)
+ */
+#define REPLAY_RESP_SIZE    4096
+
+ThingSet ts(data_nodes, sizeof(data_nodes)/sizeof(DataNode));
+
+static uint8_t resp[REPLAY_RESP_SIZE];
+
+/*
+ * Returns the p-th percentile of the sorted values
+ */
+static uint32_t percentile(const std::vector<uint32_t> &sorted, int p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[(sorted.size() - 1) * p / 100];
+}
+
+static void print_latency(const char *name, std::vector<uint32_t> &latency)
+{
+    std::sort(latency.begin(), latency.end());
+    printf("%-12s %10.1f %10.1f %10.1f %10.1f\n", name, percentile(latency, 50) / 1000.0,
+        percentile(latency, 90) / 1000.0, percentile(latency, 99) / 1000.0,
+        latency.empty() ? 0.0 : latency.back() / 1000.0);
+}
+
+/*
+ * Usage: thingset-replay capture_file [speed] [repeat]
+ *
+ * speed: 0 for maximum speed, otherwise factor of the original speed (default: 1)
+ * repeat: number of times the captured traffic is replayed (default: 1)
+ */
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        printf("Usage: %s capture_file [speed] [repeat]\n", argv[0]);
+        return 1;
+    }
+    double speed = (argc > 2) ? atof(argv[2]) : 1.0;
+    int repeat = (argc > 3) ? atoi(argv[3]) : 1;
+
+    ThingSetCaptureReader reader;
+    if (reader.open(argv[1]) < 0) {
+        printf("Could not open capture file %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<CaptureRecord> records;
+    CaptureRecord rec;
+    while (reader.read(&rec)) {
+        records.push_back(rec);
+    }
+    reader.close();
+
+    std::vector<uint32_t> latency_captured;
+    for (size_t i = 0; i < records.size(); i++) {
+        latency_captured.push_back(records[i].latency_ns);
+    }
+
+    std::vector<uint32_t> latency;
+    std::vector<uint8_t> req;
+    int mismatches = 0;
+
+    // one session per captured connection, e.g. to keep authentication separate
+    std::unordered_map<uint32_t, ThingSetContext> contexts;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (int r = 0; r < repeat; r++) {
+        std::chrono::steady_clock::time_point round_start = std::chrono::steady_clock::now();
+        contexts.clear();
+        for (size_t i = 0; i < records.size(); i++) {
+            if (speed > 0) {
+                std::this_thread::sleep_until(round_start +
+                    std::chrono::nanoseconds((uint64_t)(records[i].timestamp_ns / speed)));
+            }
+
+            // process modifies the request buffer in text mode
+            req = records[i].req;
+            ThingSetContext *ctx = &contexts[records[i].conn_id];
+
+            std::chrono::steady_clock::time_point t_start = std::chrono::steady_clock::now();
+            int len = ts.process(req.data(), req.size(), resp, sizeof(resp), ctx);
+            std::chrono::steady_clock::time_point t_end = std::chrono::steady_clock::now();
+
+            latency.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                t_end - t_start).count());
+
+            if ((size_t)len != records[i].resp.size() ||
+                memcmp(resp, records[i].resp.data(), len) != 0)
+            {
+                mismatches++;
+            }
+        }
+    }
+
+    double duration = std::chrono::duration_cast<std::chrono::duration<double>>(
+        std::chrono::steady_clock::now() - start).count();
+
+    printf("requests:   %zu (%zu records, replayed %d times)\n", latency.size(),
+        records.size(), repeat);
+    printf("duration:   %.3f s\n", duration);
+    printf("throughput: %.0f requests/s\n", (duration > 0) ? latency.size() / duration : 0.0);
+    printf("mismatches: %d responses differ from capture\n\n", mismatches);
+
+    printf("%-12s %10s %10s %10s %10s\n", "latency (us)", "p50", "p90", "p99", "max");
+    print_latency("captured", latency_captured);
+    print_latency("replayed", latency);
+
+    return 0;
+}
+
+void conf_callback()
+{
+    // no output, as it would distort the latency measurement
+}
+
+void dummy()
+{
+    // do nothing, only used in unit-tests
+}
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#if defined(NATIVE_SERVER) && !defined(UNIT_TEST)
+
+#include "thingset.h"
+#include "thingset_server.h"
+#include "thingset_capture.h"
+#include "../test/test_data.h"
+#include "../test/test_functions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <thread>
+
+ThingSet ts(data_nodes, sizeof(data_nodes)/sizeof(DataNode));
+
+static ThingSetServer *server_ptr;
+
+/*
+ * Stops the server on SIGINT and SIGTERM, so that the capture file is completely written
+ */
+static void stop_handler(int sig)
+{
+    server_ptr->stop();     // only writes to an eventfd, so it is async-signal-safe
+}
+
+/*
+ * Usage: thingset-server [tcp_port] [unix_socket_path] [num_workers] [capture_file]
+ */
+int main(int argc, char *argv[])
+{
+    uint16_t port = (argc > 1) ? atoi(argv[1]) : 9001;
+    const char *path = (argc > 2) ? argv[2] : "/tmp/thingset.sock";
+    int num_workers = (argc > 3) ? atoi(argv[3]) : std::thread::hardware_concurrency();
+
+    ThingSetServer server(&ts, num_workers);
+
+    ThingSetRecorder recorder(&ts);
+    if (argc > 4) {
+        if (recorder.open(argv[4]) < 0) {
+            perror("Capture file");
+            return 1;
+        }
+        server.set_recorder(&recorder);
+    }
+
+    server_ptr = &server;
+    signal(SIGINT, stop_handler);
+    signal(SIGTERM, stop_handler);
+
+    if (server.listen_tcp(port) < 0) {
+        perror("TCP socket");
+        return 1;
+    }
+    if (server.listen_unix(path) < 0) {
+        perror("Unix domain socket");
+        return 1;
+    }
+
+    printf("ThingSet server listening on TCP port %d and %s with %d workers\n",
+        port, path, num_workers);
+
+    server.run();
+    return 0;
+}
+
+void conf_callback()
+{
+    printf("Conf callback called!\n");
+}
+
+void dummy()
+{
+    // do nothing, only used in unit-tests
+}
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#include "pub_scheduler.h"
+
+#include <string.h>
+
+PubScheduler::PubScheduler(ThingSet *ts)
+{
+    const DataNode *node;
+
+    for (int i = 0; i < TS_PUB_WHEEL_SLOTS; i++) {
+        wheel[i] = -1;
+    }
+
+    for (size_t i = 0; (node = ts->get_node_by_index(i)) != NULL; i++) {
+        if (node->type != TS_T_PUBSUB || num_channels >= TS_PUB_MAX_CHANNELS) {
+            continue;
+        }
+
+        const DataNode *interval = ts->get_node("Interval_ms", strlen("Interval_ms"),
+            node->parent);
+        if (interval == NULL ||
+            (interval->type != TS_T_UINT16 && interval->type != TS_T_UINT32))
+        {
+            // channel is not published periodically
+            continue;
+        }
+
+        const DataNode *enable = ts->get_node("Enable", strlen("Enable"), node->parent);
+
+        PubChannel *ch = &channels[num_channels++];
+        ch->pub_ch = node->detail;
+        ch->enable = (enable != NULL && enable->type == TS_T_BOOL) ? enable : NULL;
+        ch->interval = interval;
+        ch->interval_ms = 0;
+        ch->due_ms = 0;
+        ch->next = -1;
+    }
+}
+
+uint32_t PubScheduler::read_interval(const PubChannel *ch)
+{
+    uint32_t interval;
+
+    if (ch->interval->type == TS_T_UINT32) {
+        interval = *((uint32_t *)ch->interval->data);
+    }
+    else {
+        interval = *((uint16_t *)ch->interval->data);
+    }
+
+    return (interval > 0) ? interval : 1;
+}
+
+void PubScheduler::wheel_insert(int index)
+{
+    int slot = (channels[index].due_ms / TS_PUB_WHEEL_TICK_MS) % TS_PUB_WHEEL_SLOTS;
+
+    channels[index].next = wheel[slot];
+    wheel[slot] = index;
+}
+
+void PubScheduler::wheel_remove(int index)
+{
+    int slot = (channels[index].due_ms / TS_PUB_WHEEL_TICK_MS) % TS_PUB_WHEEL_SLOTS;
+    int8_t *link = &wheel[slot];
+
+    while (*link >= 0) {
+        if (*link == index) {
+            *link = channels[index].next;
+            break;
+        }
+        link = &channels[*link].next;
+    }
+    channels[index].next = -1;
+}
+
+uint16_t PubScheduler::poll(uint32_t now_ms, uint32_t *wait_ms)
+{
+    uint16_t due_channels = 0;
+    uint32_t now_tick = now_ms / TS_PUB_WHEEL_TICK_MS;
+
+    if (!started) {
+        for (int i = 0; i < num_channels; i++) {
+            channels[i].interval_ms = read_interval(&channels[i]);
+            channels[i].due_ms = now_ms;
+            wheel_insert(i);
+        }
+        tick = now_tick;
+        started = true;
+    }
+
+    // intervals changed since last call are applied immediately, based on the last publication
+    for (int i = 0; i < num_channels; i++) {
+        PubChannel *ch = &channels[i];
+        uint32_t interval = read_interval(ch);
+        if (interval != ch->interval_ms) {
+            wheel_remove(i);
+            ch->due_ms = ch->due_ms - ch->interval_ms + interval;
+            if ((int32_t)(ch->due_ms - now_ms) < 0) {
+                ch->due_ms = now_ms;
+            }
+            ch->interval_ms = interval;
+            wheel_insert(i);
+        }
+    }
+
+    // process all slots passed since the last call (including the last one again, as it may
+    // contain channels due later in the same tick)
+    uint32_t num_ticks = now_tick - tick + 1;
+    if (num_ticks > TS_PUB_WHEEL_SLOTS) {
+        num_ticks = TS_PUB_WHEEL_SLOTS;
+    }
+    for (uint32_t t = now_tick - num_ticks + 1; t != now_tick + 1; t++) {
+        int index = wheel[t % TS_PUB_WHEEL_SLOTS];
+        while (index >= 0) {
+            PubChannel *ch = &channels[index];
+            int next = ch->next;
+            if ((int32_t)(now_ms - ch->due_ms) >= 0) {
+                if (ch->enable == NULL || *((bool *)ch->enable->data) == true) {
+                    due_channels |= ch->pub_ch;
+                }
+                wheel_remove(index);
+                ch->due_ms += ch->interval_ms;
+                if ((int32_t)(ch->due_ms - now_ms) <= 0) {
+                    // publications were missed: don't try to catch up
+                    ch->due_ms = now_ms + ch->interval_ms;
+                }
+                wheel_insert(index);
+            }
+            index = next;
+        }
+    }
+    tick = now_tick;
+
+    if (wait_ms != NULL) {
+        *wait_ms = UINT32_MAX;
+        for (int i = 0; i < num_channels; i++) {
+            uint32_t remaining = channels[i].due_ms - now_ms;
+            if (remaining < *wait_ms) {
+                *wait_ms = remaining;
+            }
+        }
+    }
+
+    return due_channels;
+}
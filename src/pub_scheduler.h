@@ -0,0 +1,135 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifndef PUB_SCHEDULER_H_
+#define PUB_SCHEDULER_H_
+
+#include "ts_config.h"
+#include "thingset.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Publication channel handled by the scheduler
+ */
+typedef struct {
+    /**
+     * Flag of the channel (as used in pubsub of the data nodes)
+     */
+    uint16_t pub_ch;
+
+    /**
+     * Bool node to enable/disable the channel (NULL if always enabled)
+     */
+    const DataNode *enable;
+
+    /**
+     * Node storing the interval in milliseconds (uint16 or uint32)
+     */
+    const DataNode *interval;
+
+    /**
+     * Interval used to calculate the current due time
+     */
+    uint32_t interval_ms;
+
+    /**
+     * Time when the channel has to be published next
+     */
+    uint32_t due_ms;
+
+    /**
+     * Index of the next channel in the same slot of the timer wheel (-1 for end of list)
+     */
+    int8_t next;
+} PubChannel;
+
+/**
+ * Scheduler for publication messages of multiple channels
+ *
+ * The channels are detected from the data node tree: Each pubsub node (TS_NODE_PUBSUB)
+ * defines a channel and its siblings named "Enable" and "Interval_ms" are used to configure
+ * the channel. Changes of these nodes (e.g. via PATCH requests) are considered in the next call
+ * of poll().
+ *
+ * The due channels are stored in a hashed timer wheel with TS_PUB_WHEEL_SLOTS slots of
+ * TS_PUB_WHEEL_TICK_MS each. The due times are calculated from the previous due time, so the
+ * messages don't drift even if the publishing thread is delayed.
+ */
+class PubScheduler
+{
+public:
+    /**
+     * Initialize the scheduler with all publication channels found in the data nodes
+     *
+     * @param ts Pointer to ThingSet object containing the data nodes
+     */
+    PubScheduler(ThingSet *ts);
+
+    /**
+     * Get the channels that have to be published at the current time
+     *
+     * All channels are due at the first call.
+     *
+     * @param now_ms Current time in milliseconds (monotonic clock, overflow allowed)
+     * @param wait_ms Pointer to store the time until the next channel is due (can be NULL)
+     *
+     * @returns Flags of all enabled channels that are due
+     */
+    uint16_t poll(uint32_t now_ms, uint32_t *wait_ms = NULL);
+
+    /**
+     * Get number of channels found in the data nodes
+     */
+    int get_num_channels()
+    {
+        return num_channels;
+    }
+
+private:
+    /**
+     * Read current interval of a channel from its data node
+     */
+    uint32_t read_interval(const PubChannel *ch);
+
+    /**
+     * Add a channel to the wheel slot of its due time
+     */
+    void wheel_insert(int index);
+
+    /**
+     * Remove a channel from its wheel slot
+     */
+    void wheel_remove(int index);
+
+    /**
+     * Channels found in the data nodes
+     */
+    PubChannel channels[TS_PUB_MAX_CHANNELS];
+
+    /**
+     * Number of channels found in the data nodes
+     */
+    int num_channels = 0;
+
+    /**
+     * Index of the first channel in each slot (-1 if empty)
+     */
+    int8_t wheel[TS_PUB_WHEEL_SLOTS];
+
+    /**
+     * Last processed tick of the timer wheel
+     */
+    uint32_t tick = 0;
+
+    /**
+     * Set after the first call of poll()
+     */
+    bool started = false;
+};
+
+#endif /* PUB_SCHEDULER_H_ */
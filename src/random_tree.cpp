@@ -0,0 +1,246 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifdef __linux__
+
+#include "random_tree.h"
+
+#include <stdio.h>
+
+/*
+ * IDs of the publication channel nodes: path "pub" and 4 nodes per channel
+ */
+#define ID_PUB          0x10
+#define ID_PUB_CH(ch)   (ID_PUB + 1 + 4 * (ch))
+
+static std::string _hex_name(const char *prefix, node_id_t id)
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%s%X", prefix, id);
+    return buf;
+}
+
+RandomTree::RandomTree(const RandomTreeConfig &config) :
+    config(config),
+    rand_state(config.seed != 0 ? config.seed : 1)
+{
+    int num_channels = config.num_pub_channels;
+    if (num_channels > 16) {
+        num_channels = 16;
+    }
+    else if (num_channels < 0) {
+        num_channels = 0;
+    }
+
+    nodes.reserve(config.num_nodes + 1 + 4 * num_channels);
+
+    // publication channels, each with all nodes required by PubScheduler
+    if (num_channels > 0) {
+        nodes.push_back(TS_NODE_PATH(ID_PUB, "pub", 0, NULL));
+    }
+    for (int ch = 0; ch < num_channels; ch++) {
+        node_id_t id = ID_PUB_CH(ch);
+        uint16_t channel = 1U << ch;
+        pub_channels.push_back(channel);
+        names.push_back("ch" + std::to_string(ch));
+        bools.push_back(true);
+        uint16s.push_back(100 * (ch + 1));
+        nodes.push_back(TS_NODE_PATH(id, names.back().c_str(), ID_PUB, NULL));
+        nodes.push_back(TS_NODE_BOOL((node_id_t)(id + 1), "Enable", &bools.back(), id,
+            TS_ANY_RW, 0));
+        nodes.push_back(TS_NODE_UINT16((node_id_t)(id + 2), "Interval_ms", &uint16s.back(), id,
+            TS_ANY_RW, 0));
+        nodes.push_back(TS_NODE_PUBSUB((node_id_t)(id + 3), "IDs", (int16_t)channel, id,
+            TS_ANY_RW, 0));
+    }
+
+    size_t num_fixed = nodes.size();
+    while (nodes.size() - num_fixed < (size_t)config.num_nodes) {
+        // the last node is a value node if there is none yet (requires num_nodes >= 2)
+        bool value_required = values.empty() &&
+            nodes.size() - num_fixed + 1 == (size_t)config.num_nodes;
+        if (paths.empty() || (!value_required && rand() % 8 == 0)) {
+            // prefer the most recently created paths as parents to get deep trees
+            node_id_t parent = 0;
+            if (!paths.empty() && rand() % 4 != 0) {
+                size_t recent = (paths.size() < 4) ? paths.size() : 4;
+                size_t index = (rand() % 2 == 0) ? paths.size() - 1 - rand() % recent :
+                    rand() % paths.size();
+                if (path_depth[index] < config.max_depth) {
+                    parent = paths[index];
+                }
+            }
+            add_path("p", parent);
+        }
+        else {
+            add_value(paths[rand() % paths.size()]);
+        }
+    }
+
+    ts = new ThingSet(nodes.data(), nodes.size());
+}
+
+RandomTree::~RandomTree()
+{
+    delete ts;
+}
+
+std::string RandomTree::path(node_id_t id)
+{
+    std::string path;
+    const DataNode *node = ts->get_node(id);
+    while (node != NULL) {
+        path = path.empty() ? node->name : std::string(node->name) + "/" + path;
+        node = (node->parent != 0) ? ts->get_node(node->parent) : NULL;
+    }
+    return path;
+}
+
+/*
+ * xorshift32 (independent of the standard library implementation)
+ */
+uint32_t RandomTree::rand()
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+node_id_t RandomTree::add_path(const char *name, node_id_t parent)
+{
+    int depth = 1;
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (paths[i] == parent) {
+            depth = path_depth[i] + 1;
+            break;
+        }
+    }
+
+    node_id_t id = next_id++;
+    names.push_back(_hex_name(name, id));
+    nodes.push_back(TS_NODE_PATH(id, names.back().c_str(), parent, NULL));
+    paths.push_back(id);
+    path_depth.push_back(depth);
+    return id;
+}
+
+void RandomTree::add_value(node_id_t parent)
+{
+    node_id_t id = next_id++;
+    uint16_t access = (rand() % 4 == 0) ? TS_ANY_R : TS_ANY_RW;
+
+    uint16_t pubsub = 0;
+    for (size_t ch = 0; ch < pub_channels.size(); ch++) {
+        if (rand() % 4 == 0) {
+            pubsub |= pub_channels[ch];
+        }
+    }
+
+    bool numeric = true;
+    int len;
+    switch (rand() % 12) {
+        case 0:
+            names.push_back(_hex_name("b", id));
+            bools.push_back(rand() % 2);
+            nodes.push_back(TS_NODE_BOOL(id, names.back().c_str(), &bools.back(), parent,
+                access, pubsub));
+            numeric = false;
+            break;
+        case 1:
+            names.push_back(_hex_name("u16_", id));
+            uint16s.push_back(rand());
+            nodes.push_back(TS_NODE_UINT16(id, names.back().c_str(), &uint16s.back(), parent,
+                access, pubsub));
+            break;
+        case 2:
+            names.push_back(_hex_name("i16_", id));
+            int16s.push_back(rand());
+            nodes.push_back(TS_NODE_INT16(id, names.back().c_str(), &int16s.back(), parent,
+                access, pubsub));
+            break;
+        case 3:
+            names.push_back(_hex_name("u32_", id));
+            uint32s.push_back(rand());
+            nodes.push_back(TS_NODE_UINT32(id, names.back().c_str(), &uint32s.back(), parent,
+                access, pubsub));
+            break;
+#if TS_64BIT_TYPES_SUPPORT
+        case 4: {
+            // separate statements, as the evaluation order of operands is unspecified
+            uint64_t hi = rand();
+            uint64_t lo = rand();
+            names.push_back(_hex_name("u64_", id));
+            uint64s.push_back(hi << 32 | lo);
+            nodes.push_back(TS_NODE_UINT64(id, names.back().c_str(), &uint64s.back(), parent,
+                access, pubsub));
+            break;
+        }
+        case 5: {
+            uint64_t hi = rand();
+            uint64_t lo = rand();
+            names.push_back(_hex_name("i64_", id));
+            int64s.push_back((int64_t)(hi << 32 | lo));
+            nodes.push_back(TS_NODE_INT64(id, names.back().c_str(), &int64s.back(), parent,
+                access, pubsub));
+            break;
+        }
+#endif
+        case 6:
+            names.push_back(_hex_name("s", id));
+            strings.push_back(std::vector<char>(config.max_string_len, '\0'));
+            snprintf(strings.back().data(), config.max_string_len, "str%u", rand() % 10000);
+            nodes.push_back(TS_NODE_STRING(id, names.back().c_str(), strings.back().data(),
+                (int16_t)config.max_string_len, parent, access, pubsub));
+            numeric = false;
+            break;
+        case 7:
+            names.push_back(_hex_name("af", id));
+            len = 1 + rand() % config.max_array_len;
+            float_arrays.push_back(std::vector<float>(config.max_array_len));
+            for (int i = 0; i < len; i++) {
+                float_arrays.back()[i] = (int)(rand() % 20000 - 10000) / 100.0F;
+            }
+            arrays.push_back({ float_arrays.back().data(), (uint16_t)config.max_array_len,
+                (uint16_t)len, TS_T_FLOAT32 });
+            nodes.push_back(TS_NODE_ARRAY(id, names.back().c_str(), &arrays.back(), 2, parent,
+                access, pubsub));
+            numeric = false;
+            break;
+        case 8:
+            names.push_back(_hex_name("ai", id));
+            len = 1 + rand() % config.max_array_len;
+            int32_arrays.push_back(std::vector<int32_t>(config.max_array_len));
+            for (int i = 0; i < len; i++) {
+                int32_arrays.back()[i] = rand() % 2000 - 1000;
+            }
+            arrays.push_back({ int32_arrays.back().data(), (uint16_t)config.max_array_len,
+                (uint16_t)len, TS_T_INT32 });
+            nodes.push_back(TS_NODE_ARRAY(id, names.back().c_str(), &arrays.back(), 0, parent,
+                access, pubsub));
+            numeric = false;
+            break;
+        case 9:
+            names.push_back(_hex_name("i32_", id));
+            int32s.push_back(rand());
+            nodes.push_back(TS_NODE_INT32(id, names.back().c_str(), &int32s.back(), parent,
+                access, pubsub));
+            break;
+        default:
+            names.push_back(_hex_name("f", id));
+            floats.push_back((int)(rand() % 20000 - 10000) / 100.0F);
+            nodes.push_back(TS_NODE_FLOAT(id, names.back().c_str(), &floats.back(),
+                (int16_t)(rand() % 4), parent, access, pubsub));
+            break;
+    }
+
+    values.push_back(id);
+    if (numeric && (access & TS_WRITE_MASK)) {
+        writable.push_back(id);
+    }
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,117 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifndef RANDOM_TREE_H_
+#define RANDOM_TREE_H_
+
+#ifdef __linux__
+
+#include "thingset.h"
+
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+/*
+ * First ID of the generated nodes (lower IDs are used for the publication channels)
+ */
+#define RANDOM_TREE_FIRST_ID    0x100
+
+/**
+ * Parameters of a generated node tree
+ */
+struct RandomTreeConfig {
+    uint32_t seed = 1;              ///< Trees with the same parameters and seed are identical
+    int num_nodes = 1000;           ///< Number of data nodes (without publication channels),
+                                    ///< at least one of them is a value node if >= 2
+    int max_depth = 6;              ///< Maximum number of path levels above the value nodes
+    int num_pub_channels = 8;       ///< Number of publication channels (up to 16)
+    int max_array_len = 16;         ///< Maximum number of elements of array nodes
+    int max_string_len = 32;        ///< Size of the buffers of string nodes
+};
+
+/**
+ * Randomized data node tree for load tests (Linux only)
+ *
+ * The tree contains paths of random depth with value nodes of all types supported by the
+ * library (including strings and arrays) as well as publication channels under the path
+ * "pub" with the child nodes Enable, Interval_ms and IDs. The random number generator is
+ * implemented here, so trees are identical on all platforms.
+ */
+class RandomTree
+{
+public:
+    RandomTree(const RandomTreeConfig &config);
+
+    ~RandomTree();
+
+    /**
+     * Full path of a node (e.g. "p1A/f1B2")
+     */
+    std::string path(node_id_t id);
+
+    /**
+     * ThingSet object with the generated data nodes
+     */
+    ThingSet *ts;
+
+    std::vector<DataNode> nodes;
+
+    /**
+     * IDs of the path nodes (without publication channels)
+     */
+    std::vector<node_id_t> paths;
+
+    /**
+     * IDs of the value nodes
+     */
+    std::vector<node_id_t> values;
+
+    /**
+     * IDs of writable value nodes of numeric type (e.g. for PATCH requests)
+     */
+    std::vector<node_id_t> writable;
+
+    /**
+     * Bitfields of the publication channels
+     */
+    std::vector<uint16_t> pub_channels;
+
+private:
+    uint32_t rand();
+
+    node_id_t add_path(const char *name, node_id_t parent);
+
+    void add_value(node_id_t parent);
+
+    RandomTreeConfig config;
+
+    uint32_t rand_state;
+
+    node_id_t next_id = RANDOM_TREE_FIRST_ID;
+
+    // containers with stable addresses of their elements for the data referenced by the nodes
+    std::deque<std::string> names;
+    std::deque<bool> bools;
+    std::deque<uint16_t> uint16s;
+    std::deque<int16_t> int16s;
+    std::deque<uint32_t> uint32s;
+    std::deque<int32_t> int32s;
+    std::deque<uint64_t> uint64s;
+    std::deque<int64_t> int64s;
+    std::deque<float> floats;
+    std::deque<std::vector<char>> strings;
+    std::deque<std::vector<float>> float_arrays;
+    std::deque<std::vector<int32_t>> int32_arrays;
+    std::deque<ArrayInfo> arrays;
+    std::vector<int> path_depth;
+};
+
+#endif /* __linux__ */
+
+#endif /* RANDOM_TREE_H_ */
@@ -0,0 +1,64 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifdef __linux__
+
+#include "stack_usage.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define STACK_USAGE_PATTERN 0xA5
+
+static uint8_t stack[STACK_USAGE_SIZE] __attribute__((aligned(64)));
+
+static void *_stack_thread(void *arg)
+{
+    (*(std::function<void()> *)arg)();
+    return NULL;
+}
+
+/*
+ * Returns the number of bytes of the stack overwritten by a thread calling fn
+ */
+static size_t _peak_stack(std::function<void()> &fn)
+{
+    memset(stack, STACK_USAGE_PATTERN, sizeof(stack));
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, sizeof(stack));
+
+    pthread_t thread;
+    int err = pthread_create(&thread, &attr, _stack_thread, &fn);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        return 0;
+    }
+    pthread_join(thread, NULL);
+
+    // stack grows downwards: find lowest byte that was written
+    size_t untouched = 0;
+    while (untouched < sizeof(stack) && stack[untouched] == STACK_USAGE_PATTERN) {
+        untouched++;
+    }
+    return sizeof(stack) - untouched;
+}
+
+size_t stack_usage(std::function<void()> fn)
+{
+    static size_t baseline = 0;
+    if (baseline == 0) {
+        std::function<void()> empty = []() {};
+        baseline = _peak_stack(empty);
+    }
+
+    size_t peak = _peak_stack(fn);
+    return (peak > baseline) ? peak - baseline : 0;
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,40 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifndef STACK_USAGE_H_
+#define STACK_USAGE_H_
+
+#ifdef __linux__
+
+#include <stddef.h>
+
+#include <functional>
+
+/*
+ * Size of the stack used for the measurement
+ */
+#ifndef STACK_USAGE_SIZE
+#define STACK_USAGE_SIZE (256 * 1024)
+#endif
+
+/**
+ * Measure the peak stack usage of a function (Linux only)
+ *
+ * The function is called in a thread whose stack is painted with a pattern before. The bytes
+ * overwritten by the thread are counted, and the usage of a thread calling an empty function
+ * is subtracted, so the result does not contain the thread startup overhead.
+ *
+ * Not thread-safe, as the same stack buffer is used for all measurements.
+ *
+ * @param fn Function to be measured
+ *
+ * @returns Peak stack usage of the function in bytes or 0 in case of error
+ */
+size_t stack_usage(std::function<void()> fn);
+
+#endif /* __linux__ */
+
+#endif /* STACK_USAGE_H_ */
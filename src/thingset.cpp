@@ -11,9 +11,13 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 
 #define DEBUG 0
 
+TS_THREAD_LOCAL ThingSetContext *ThingSet::_callback_ctx = NULL;
+
 static void _check_id_duplicates(const DataNode *data, size_t num)
 {
     for (unsigned int i = 0; i < num; i++) {
@@ -56,6 +60,55 @@ static void _count_array_elements(const DataNode *data, size_t num)
     }
 }
 
+#if TS_SEQLOCK || TS_DOUBLE_BUFFER
+/*
+ * Progress of a request processed in steps, saved to repeat a step with inconsistent values
+ */
+typedef struct {
+    uint8_t handler;
+    const DataNode *node;
+    unsigned int index;
+    unsigned int pos;
+    unsigned int count;
+    unsigned int total;
+#if TS_JSON_STREAMING
+    jsmn_parser json_parser;
+    jsmntok_t json_tok;
+    int json_tok_index;
+#endif
+} StepState;
+
+static void _save_step(const ThingSetContext *ctx, StepState *saved)
+{
+    saved->handler = ctx->step_handler;
+    saved->node = ctx->step_node;
+    saved->index = ctx->step_index;
+    saved->pos = ctx->step_pos;
+    saved->count = ctx->step_count;
+    saved->total = ctx->step_total;
+#if TS_JSON_STREAMING
+    saved->json_parser = ctx->json_parser;
+    saved->json_tok = ctx->json_tok;
+    saved->json_tok_index = ctx->json_tok_index;
+#endif
+}
+
+static void _restore_step(ThingSetContext *ctx, const StepState *saved)
+{
+    ctx->step_handler = saved->handler;
+    ctx->step_node = saved->node;
+    ctx->step_index = saved->index;
+    ctx->step_pos = saved->pos;
+    ctx->step_count = saved->count;
+    ctx->step_total = saved->total;
+#if TS_JSON_STREAMING
+    ctx->json_parser = saved->json_parser;
+    ctx->json_tok = saved->json_tok;
+    ctx->json_tok_index = saved->json_tok_index;
+#endif
+}
+#endif
+
 ThingSet::ThingSet(DataNode *data, size_t num)
 {
     _check_id_duplicates(data, num);
@@ -64,37 +117,568 @@ ThingSet::ThingSet(DataNode *data, size_t num)
 
     data_nodes = data;
     num_nodes = num;
+
+#if TS_DEFERRED_CALLBACKS
+    for (uint32_t i = 0; i < TS_CALLBACK_QUEUE_SIZE; i++) {
+        _call_queue[i].seq.store(i, std::memory_order_relaxed);
+    }
+#endif
 }
 
-int ThingSet::process(uint8_t *request, size_t request_len, uint8_t *response, size_t response_size)
+int ThingSet::process(uint8_t *request, size_t request_len, uint8_t *response,
+    size_t response_size, ThingSetContext *ctx)
 {
     // check if proper request was set before asking for a response
     if (request == NULL || request_len < 1)
         return 0;
 
-    // assign private variables
-    req = request;
-    req_len = request_len;
-    resp = response;
-    resp_size = response_size;
+    if (ctx == NULL) {
+        ctx = &_ctx;
+    }
+
+    // assign request data to context
+    ctx->req = request;
+    ctx->req_len = request_len;
+    ctx->resp = response;
+    ctx->resp_size = response_size;
+
+    // process entire request at once
+    ctx->step_budget = -1;
+    ctx->step_handler = TS_STEP_NONE;
+
+#if TS_STATS
+    uint32_t start = _stats_cycle_counter ? _stats_cycle_counter() : 0;
+#endif
+
+    int len = 0;
+#if TS_SEQLOCK || TS_DOUBLE_BUFFER
+    // read-only requests are repeated if node values were updated in the meantime
+    bool read_only = (ctx->req[0] == '?' || ctx->req[0] == TS_GET || ctx->req[0] == TS_FETCH);
+    bool valid = false;
+    for (int i = 0; i < TS_SNAPSHOT_MAX_ATTEMPTS && !valid; i++) {
+        ReadState state;
+        read_begin(&state, ctx);
+        len = process_request(ctx);
+        valid = !read_only || read_validate(&state);
+        read_end(&state, ctx);
+    }
+    if (!valid) {
+        len = (ctx->req[0] == '?') ? txt_response(ctx, TS_STATUS_SERVICE_UNAVAILABLE) :
+            bin_response(ctx, TS_STATUS_SERVICE_UNAVAILABLE);
+    }
+#else
+    len = process_request(ctx);
+#endif
+
+#if TS_STATS
+    if (_stats) {
+        update_stats(ctx, len, _stats_cycle_counter ? _stats_cycle_counter() - start : 0);
+    }
+#endif
+    return len;
+}
+
+void ThingSet::process_start(uint8_t *request, size_t request_len, uint8_t *response,
+    size_t response_size, ThingSetContext *ctx)
+{
+    if (ctx == NULL) {
+        ctx = &_ctx;
+    }
+
+    ctx->req = request;
+    ctx->req_len = request_len;
+    ctx->resp = response;
+    ctx->resp_size = response_size;
+    ctx->step_handler = TS_STEP_NONE;
+#if TS_STATS
+    ctx->stats_cycles = 0;
+#endif
+}
+
+int ThingSet::process_step(int max_nodes, ThingSetContext *ctx)
+{
+    if (ctx == NULL) {
+        ctx = &_ctx;
+    }
+
+    if (ctx->req == NULL || ctx->req_len < 1) {
+        return 0;
+    }
+
+    // at least one node per step to make sure that the request is finished eventually
+    int budget = (max_nodes > 0) ? max_nodes : 1;
+
+#if TS_STATS
+    uint32_t start = _stats_cycle_counter ? _stats_cycle_counter() : 0;
+#endif
+
+    int len = 0;
+#if TS_SEQLOCK || TS_DOUBLE_BUFFER
+    // read-only steps are repeated from the saved progress if values were updated meanwhile
+    bool read_only = (ctx->req[0] == '?' || ctx->req[0] == TS_GET || ctx->req[0] == TS_FETCH);
+    StepState saved;
+    _save_step(ctx, &saved);
+    bool valid = false;
+    for (int i = 0; i < TS_SNAPSHOT_MAX_ATTEMPTS && !valid; i++) {
+        if (i > 0) {
+            _restore_step(ctx, &saved);     // discards the partial response of this step
+        }
+        ctx->step_budget = budget;
+        ReadState state;
+        read_begin(&state, ctx);
+        len = process_step_handler(ctx);
+        valid = !read_only || read_validate(&state);
+        read_end(&state, ctx);
+    }
+    if (!valid) {
+        len = (ctx->req[0] == '?') ? txt_response(ctx, TS_STATUS_SERVICE_UNAVAILABLE) :
+            bin_response(ctx, TS_STATUS_SERVICE_UNAVAILABLE);
+    }
+#else
+    ctx->step_budget = budget;
+    len = process_step_handler(ctx);
+#endif
+
+#if TS_STATS
+    if (_stats_cycle_counter) {
+        // time between the steps is not counted
+        ctx->stats_cycles += _stats_cycle_counter() - start;
+    }
+#endif
+
+    if (len != TS_PROCESS_PENDING) {
+        ctx->step_handler = TS_STEP_NONE;
+        ctx->step_budget = -1;
+#if TS_STATS
+        if (_stats) {
+            update_stats(ctx, len, ctx->stats_cycles);
+        }
+#endif
+    }
+    return len;
+}
+
+int ThingSet::process_step_handler(ThingSetContext *ctx)
+{
+    int len;
+    switch (ctx->step_handler) {
+        case TS_STEP_TXT_GET_NAMES:
+            len = txt_get(ctx, ctx->step_node, false);
+            break;
+        case TS_STEP_TXT_GET_VALUES:
+            len = txt_get(ctx, ctx->step_node, true);
+            break;
+        case TS_STEP_TXT_FETCH:
+            len = txt_fetch(ctx, ctx->step_node->id);
+            break;
+        case TS_STEP_BIN_GET_NAMES:
+            len = bin_get(ctx, ctx->step_node, false, false);
+            break;
+        case TS_STEP_BIN_GET_VALUES:
+            len = bin_get(ctx, ctx->step_node, true, false);
+            break;
+        case TS_STEP_BIN_GET_IDS:
+            len = bin_get(ctx, ctx->step_node, false, true);
+            break;
+        case TS_STEP_BIN_FETCH:
+            len = bin_fetch(ctx, ctx->step_node, 0);
+            break;
+        default:
+            // first step: parse request and call the handler
+            len = process_request(ctx);
+            break;
+    }
+    return len;
+}
 
-    if (req[0] < 0x20) {
+int ThingSet::process_request(ThingSetContext *ctx)
+{
+    if (ctx->req[0] < 0x20) {
         // binary mode request
-        return bin_process();
+        return bin_process(ctx);
     }
-    else if (req[0] == '?' || req[0] == '=' || req[0] == '+' || req[0] == '-' || req[0] == '!') {
+    else if (ctx->req[0] == '?' || ctx->req[0] == '=' || ctx->req[0] == '+' ||
+        ctx->req[0] == '-' || ctx->req[0] == '!')
+    {
         // text mode request
-        return txt_process();
+        return txt_process(ctx);
     }
     else {
         // not a thingset command --> ignore and set response to empty string
-        response[0] = 0;
+        ctx->resp[0] = 0;
         return 0;
     }
 }
 
+#if TS_STATS
+/*
+ * Determines the index of the function code of a request in the statistics (-1 if unknown)
+ */
+static int _stats_function(const uint8_t *req, size_t req_len)
+{
+    switch (req[0]) {
+        case TS_GET:
+            return TS_STATS_GET;
+        case TS_FETCH:
+            return TS_STATS_FETCH;
+        case TS_PATCH:
+        case '=':
+            return TS_STATS_PATCH;
+        case TS_POST:
+        case '!':
+        case '+':
+            return TS_STATS_POST;
+        case TS_DELETE:
+        case '-':
+            return TS_STATS_DELETE;
+        case '?': {
+            // text mode FETCH requests contain a payload after the path
+            const uint8_t *path_end = (const uint8_t *)memchr(req, ' ', req_len);
+            for (const uint8_t *c = path_end; c != NULL && c < req + req_len; c++) {
+                if (*c != ' ' && *c != '\n' && *c != '\0') {
+                    return TS_STATS_FETCH;
+                }
+            }
+            return TS_STATS_GET;
+        }
+        default:
+            return -1;
+    }
+}
+
+/*
+ * Extracts the status code from a response (0 if not found)
+ */
+static int _stats_status(const uint8_t *resp, int len)
+{
+    if (len >= 3 && resp[0] == ':') {
+        char hex[3] = { (char)resp[1], (char)resp[2], '\0' };
+        return strtoul(hex, NULL, 16);
+    }
+    else if (len >= 1 && resp[0] >= 0x80) {
+        return resp[0];
+    }
+    return 0;
+}
+
+void ThingSet::update_stats(ThingSetContext *ctx, int len, uint32_t cycles)
+{
+    int function = _stats_function(ctx->req, ctx->req_len);
+    if (function < 0) {
+        return;     // not a ThingSet request
+    }
+
+    _stats->requests[function]++;
+
+    switch (_stats_status(ctx->resp, len)) {
+        case TS_STATUS_BAD_REQUEST:
+            _stats->bad_request++;
+            break;
+        case TS_STATUS_UNAUTHORIZED:
+            _stats->unauthorized++;
+            break;
+        case TS_STATUS_FORBIDDEN:
+            _stats->forbidden++;
+            break;
+        case TS_STATUS_NOT_FOUND:
+            _stats->not_found++;
+            break;
+        case TS_STATUS_METHOD_NOT_ALLOWED:
+            _stats->method_not_allowed++;
+            break;
+        case TS_STATUS_REQUEST_TOO_LARGE:
+            _stats->request_too_large++;
+            break;
+        case TS_STATUS_SERVICE_UNAVAILABLE:
+            _stats->service_unavailable++;
+            break;
+        case TS_STATUS_RESPONSE_TOO_LARGE:
+            _stats->response_too_large++;
+            break;
+        case TS_STATUS_CREATED:
+        case TS_STATUS_DELETED:
+        case TS_STATUS_VALID:
+        case TS_STATUS_CHANGED:
+        case TS_STATUS_CONTENT:
+            break;
+        default:
+            _stats->other_errors++;
+            break;
+    }
+
+    if (_stats_cycle_counter) {
+        // bucket n contains latencies of less than 2^n cycles
+        int bucket = 0;
+        while (bucket < TS_STATS_HIST_BUCKETS - 1 && cycles >= (1UL << bucket)) {
+            bucket++;
+        }
+        _stats->latency[function][bucket]++;
+    }
+}
+#endif
+
+bool ThingSet::reserve_callback(ThingSetContext *ctx, const DataNode *node)
+{
+#if TS_DEFERRED_CALLBACKS
+    ctx->callback_reserved = false;
+    if (node->data == NULL) {
+        return true;
+    }
+    else if (node->type == TS_T_EXEC && (node->detail == TS_EXEC_IMMEDIATE ||
+        next_child(node->id, 0) < num_nodes))
+    {
+        // parameters are stored in the shared child nodes and could be overwritten by other
+        // requests before a deferred call, so functions with parameters are called immediately
+        return true;
+    }
+
+    uint32_t pos = _call_head.load(std::memory_order_relaxed);
+    while (true) {
+        uint32_t seq = _call_queue[pos % TS_CALLBACK_QUEUE_SIZE].seq.load(
+            std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            if (_call_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return false;   // slot not yet released by run_deferred_callbacks: queue full
+        }
+        else {
+            pos = _call_head.load(std::memory_order_relaxed);
+        }
+    }
+    ctx->callback_slot = pos;
+    ctx->callback_reserved = true;
+#endif
+    return true;
+}
+
+void ThingSet::run_callback(ThingSetContext *ctx, const DataNode *node, bool call)
+{
+    // create function pointer
+    void (*fun)(void) = reinterpret_cast<void(*)()>(node->data);
+
+#if TS_DEFERRED_CALLBACKS
+    if (ctx->callback_reserved) {
+        DeferredCall *slot = &_call_queue[ctx->callback_slot % TS_CALLBACK_QUEUE_SIZE];
+        slot->fn = call ? fun : NULL;
+        slot->seq.store(ctx->callback_slot + 1, std::memory_order_release);
+        ctx->callback_reserved = false;
+        return;
+    }
+#endif
+
+    if (call && fun != NULL) {
+        // restore previous context in case of nested calls (e.g. by another ThingSet instance)
+        ThingSetContext *prev_ctx = _callback_ctx;
+        _callback_ctx = ctx;
+        fun();
+        _callback_ctx = prev_ctx;
+    }
+}
+
+#if TS_DEFERRED_CALLBACKS
+static_assert((TS_CALLBACK_QUEUE_SIZE & (TS_CALLBACK_QUEUE_SIZE - 1)) == 0,
+    "TS_CALLBACK_QUEUE_SIZE must be a power of two");
+
+int ThingSet::run_deferred_callbacks()
+{
+    int count = 0;
+    uint32_t pos = _call_tail.load(std::memory_order_relaxed);
+
+    while (true) {
+        DeferredCall *slot = &_call_queue[pos % TS_CALLBACK_QUEUE_SIZE];
+        int32_t diff = (int32_t)(slot->seq.load(std::memory_order_acquire) - (pos + 1));
+        if (diff == 0) {
+            if (_call_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                void (*fn)(void) = slot->fn;
+                // release the slot before the call, as the function may process requests
+                slot->seq.store(pos + TS_CALLBACK_QUEUE_SIZE, std::memory_order_release);
+                if (fn != NULL) {
+                    fn();
+                    count++;
+                }
+                pos++;
+            }
+        }
+        else if (diff < 0) {
+            break;          // queue empty or next call not yet added by its request
+        }
+        else {
+            pos = _call_tail.load(std::memory_order_relaxed);
+        }
+    }
+    return count;
+}
+#endif
+
+#if TS_UPDATE_QUEUE
+/*
+ * Limits a value to the range of an integer type (bounds must be exactly representable as double)
+ */
+static inline double _clamp(double value, double min, double max)
+{
+    return (value < min) ? min : ((value > max) ? max : value);
+}
+
+/*
+ * Writes a queued value to the data node, converted to the type of the node
+ *
+ * Values outside the range of an integer node are saturated. NaN can only be stored in float
+ * nodes, so the update is dropped for all other types.
+ */
+static bool _write_update(const DataNode *node, const NodeUpdate *update)
+{
+    double value;       // represents all possible float, int32 and uint32 values exactly
+
+    switch (update->type) {
+        case TS_T_FLOAT32:
+            value = update->value.f32;
+            break;
+        case TS_T_INT32:
+            value = update->value.i32;
+            break;
+        case TS_T_UINT32:
+            value = update->value.u32;
+            break;
+        case TS_T_BOOL:
+            value = update->value.b;
+            break;
+        default:
+            return false;
+    }
+
+    if (node->type == TS_T_FLOAT32) {
+        *((float *)node->data) = value;
+        return true;
+    }
+    else if (isnan(value)) {
+        return false;
+    }
+
+    switch (node->type) {
+        case TS_T_UINT64:
+            // max. values of 64-bit types are not representable as double, so 2^64 and 2^63
+            // are used as (exclusive) upper bounds
+            *((uint64_t *)node->data) = (value <= 0) ? 0 :
+                ((value >= 18446744073709551616.0) ? UINT64_MAX : (uint64_t)value);
+            break;
+        case TS_T_INT64:
+            *((int64_t *)node->data) = (value <= INT64_MIN) ? INT64_MIN :
+                ((value >= 9223372036854775808.0) ? INT64_MAX : (int64_t)value);
+            break;
+        case TS_T_UINT32:
+            *((uint32_t *)node->data) = _clamp(value, 0, UINT32_MAX);
+            break;
+        case TS_T_INT32:
+            *((int32_t *)node->data) = _clamp(value, INT32_MIN, INT32_MAX);
+            break;
+        case TS_T_UINT16:
+            *((uint16_t *)node->data) = _clamp(value, 0, UINT16_MAX);
+            break;
+        case TS_T_INT16:
+            *((int16_t *)node->data) = _clamp(value, INT16_MIN, INT16_MAX);
+            break;
+        case TS_T_BOOL:
+            *((bool *)node->data) = (value != 0);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+int ThingSet::apply_updates()
+{
+    int count = 0;
+    uint32_t tail = _update_tail.load(std::memory_order_relaxed);
+    uint32_t head = _update_head.load(std::memory_order_acquire);
+
+    if (tail == head) {
+        return 0;
+    }
+
+    begin_update();
+    while (tail != head) {
+        const NodeUpdate *update = &_update_queue[tail % TS_UPDATE_QUEUE_SIZE];
+        const DataNode *node = get_node(update->id);
+        if (node != NULL && _write_update(node, update)) {
+            count++;
+        }
+        // release the slot only after the update was read
+        _update_tail.store(++tail, std::memory_order_release);
+    }
+    end_update();
+
+    return count;
+}
+#endif
+
+#if TS_DOUBLE_BUFFER
+void ThingSet::set_double_buffer(void *front, void *back, void *spare, size_t size)
+{
+    _buf[0] = (uint8_t *)front;
+    _buf[1] = (uint8_t *)back;
+    _buf[2] = (uint8_t *)spare;
+    _buf_size = size;
+    _buf_back = 1;
+    _buf_front.store(0);
+    if (size > 0) {
+        memcpy(back, front, size);
+    }
+}
+
+bool ThingSet::swap_buffers()
+{
+    uint32_t spare = 3 - _buf_front.load(std::memory_order_relaxed) - _buf_back;
+
+    // readers release the old front buffer quickly, but a reader may still be interrupted
+    if (_buf_readers[spare].load() != 0) {
+        return false;
+    }
+
+    // readers only acquire the front buffer, so the spare buffer can be written without races
+    _buf_front.store(_buf_back);
+    if (_buf_size > 0) {
+        memcpy(_buf[spare], _buf[_buf_back], _buf_size);
+    }
+    _buf_back = spare;
+    return true;
+}
+#endif
+
 DataNode *const ThingSet::get_node(const char *str, size_t len, int32_t parent)
 {
+#if TS_NODE_INDEX
+    // names are only unique below the same parent, so global searches can't use the index
+    if (_index != NULL && _index->name_slots != NULL && parent != -1) {
+        unsigned int slot = ts_name_hash(parent, str, len) & _index->name_mask;
+        while (_index->name_slots[slot] != TS_INDEX_EMPTY) {
+            DataNode *node = &data_nodes[_index->name_slots[slot]];
+            if (node->parent == parent && strncmp(node->name, str, len) == 0
+                && node->name[len] == '\0')
+            {
+                return count_access(node);
+            }
+            slot = (slot + 1) & _index->name_mask;
+        }
+        return NULL;
+    }
+#endif
+
+#if TS_HOT_NODES > 0
+    // names are only unique below the same parent, so global searches skip the lookaside list
+    for (unsigned int i = 0; i < _num_hot_nodes && parent != -1; i++) {
+        if (_hot_nodes[i]->parent == parent && strncmp(_hot_nodes[i]->name, str, len) == 0
+            && strlen(_hot_nodes[i]->name) == len)
+        {
+            return count_access(_hot_nodes[i]);
+        }
+    }
+#endif
+
     for (unsigned int i = 0; i < num_nodes; i++) {
         if (parent != -1 && data_nodes[i].parent != parent) {
             continue;
@@ -102,7 +686,7 @@ DataNode *const ThingSet::get_node(const char *str, size_t len, int32_t parent)
         else if (strncmp(data_nodes[i].name, str, len) == 0
             && strlen(data_nodes[i].name) == len)  // otherwise e.g. foo and fooBar would be recognized as equal
         {
-            return &(data_nodes[i]);
+            return count_access(&(data_nodes[i]));
         }
     }
     return NULL;
@@ -110,19 +694,129 @@ DataNode *const ThingSet::get_node(const char *str, size_t len, int32_t parent)
 
 DataNode *const ThingSet::get_node(node_id_t id)
 {
+#if TS_NODE_INDEX
+    if (_index != NULL) {
+        unsigned int pos = index_find(id);
+        return (pos < num_nodes) ? count_access(&data_nodes[pos]) : NULL;
+    }
+#endif
+
+#if TS_HOT_NODES > 0
+    for (unsigned int i = 0; i < _num_hot_nodes; i++) {
+        if (_hot_nodes[i]->id == id) {
+            return count_access(_hot_nodes[i]);
+        }
+    }
+#endif
+
     for (unsigned int i = 0; i < num_nodes; i++) {
         if (data_nodes[i].id == id) {
-            return &(data_nodes[i]);
+            return count_access(&(data_nodes[i]));
         }
     }
     return NULL;
 }
 
+#if TS_HOT_NODES > 0
+int ThingSet::set_hot_nodes(const node_id_t *ids, size_t num_ids)
+{
+    _num_hot_nodes = 0;
+    for (size_t i = 0; i < num_ids && _num_hot_nodes < TS_HOT_NODES; i++) {
+        for (unsigned int j = 0; j < num_nodes; j++) {
+            if (data_nodes[j].id == ids[i]) {
+                _hot_nodes[_num_hot_nodes++] = &data_nodes[j];
+                break;
+            }
+        }
+    }
+    return _num_hot_nodes;
+}
+#endif
+
+#if TS_NODE_INDEX
+int ThingSet::set_index(const ThingSetIndex *index)
+{
+    if (index != NULL && (index->num_nodes != num_nodes || index->num_id_buckets == 0)) {
+        _index = NULL;
+        return -1;
+    }
+    _index = index;
+    _index_pub_valid = true;
+    return 0;
+}
+
+/*
+ * Returns the position of the first element >= value in a sorted range of node positions
+ * or end if there is none
+ */
+static inline unsigned int _lower_bound(const uint16_t *positions, unsigned int begin,
+    unsigned int end, unsigned int value)
+{
+    while (begin < end) {
+        unsigned int mid = begin + (end - begin) / 2;
+        if (positions[mid] < value) {
+            begin = mid + 1;
+        }
+        else {
+            end = mid;
+        }
+    }
+    return begin;
+}
+#endif
+
+unsigned int ThingSet::next_child(node_id_t parent_id, unsigned int start)
+{
+#if TS_NODE_INDEX
+    if (_index != NULL && _index->child_offsets != NULL) {
+        // children of the root node are stored after the children of the last node
+        unsigned int parent_pos = (parent_id == 0) ? num_nodes : index_find(parent_id);
+        if (parent_pos == num_nodes && parent_id != 0) {
+            return num_nodes;
+        }
+        unsigned int end = _index->child_offsets[parent_pos + 1];
+        unsigned int i = _lower_bound(_index->children, _index->child_offsets[parent_pos], end,
+            start);
+        return (i < end) ? _index->children[i] : num_nodes;
+    }
+#endif
+
+    for (unsigned int i = start; i < num_nodes; i++) {
+        if (data_nodes[i].parent == parent_id) {
+            return i;
+        }
+    }
+    return num_nodes;
+}
+
+unsigned int ThingSet::next_pub_node(uint16_t pub_ch, unsigned int start)
+{
+#if TS_NODE_INDEX
+    // lists are only stored for single channels, other combinations are searched linearly
+    for (unsigned int ch = 0; _index != NULL && _index_pub_valid &&
+        ch < _index->num_pub_channels; ch++)
+    {
+        if (_index->pub_channels[ch] == pub_ch) {
+            unsigned int end = _index->pub_offsets[ch + 1];
+            unsigned int i = _lower_bound(_index->pub_nodes, _index->pub_offsets[ch], end, start);
+            return (i < end) ? _index->pub_nodes[i] : num_nodes;
+        }
+    }
+#endif
+
+    for (unsigned int i = start; i < num_nodes; i++) {
+        if (data_nodes[i].pubsub & pub_ch) {
+            return i;
+        }
+    }
+    return num_nodes;
+}
+
 DataNode *const ThingSet::get_endpoint(const char *path, size_t len)
 {
     const DataNode *node;
     const char *start = path;
-    const char *end = strchr(path, '/');
+    const char *end = (const char *)memchr(path, '/', len);
     uint16_t parent = 0;
 
     // maximum depth of 10 assumed
@@ -135,7 +829,7 @@ DataNode *const ThingSet::get_endpoint(const char *path, size_t len)
                 }
                 parent = node->id;
                 start = end + 1;
-                end = strchr(start, '/');
+                end = (const char *)memchr(start, '/', path + len - start);
             }
             else {
                 // resource ends with trailing slash
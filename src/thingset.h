@@ -13,6 +13,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#if TS_SEQLOCK || TS_DOUBLE_BUFFER || TS_DEFERRED_CALLBACKS || TS_UPDATE_QUEUE
+#include <atomic>
+#endif
+
 /*
  * Protocol function codes (same as CoAP)
  */
@@ -49,10 +53,23 @@
 // server errors
 #define TS_STATUS_INTERNAL_SERVER_ERR   0xC0
 #define TS_STATUS_NOT_IMPLEMENTED       0xC1
+#define TS_STATUS_SERVICE_UNAVAILABLE   0xC3        // callback queue full
 
 // ThingSet specific errors
 #define TS_STATUS_RESPONSE_TOO_LARGE    0xE1
 
+/*
+ * Return value of ThingSet::process_step if the request is not finished yet
+ */
+#define TS_PROCESS_PENDING  (-1)
+
+/*
+ * Increment of the seqlock counter for each finished update and mask of the bits counting the
+ * writers updating node values at the moment (see ThingSet::begin_update)
+ */
+#define TS_SEQ_UPDATE           0x100U
+#define TS_SEQ_WRITERS_MASK     (TS_SEQ_UPDATE - 1)
+
 /**
  * Internal C data types (used to cast void* pointers)
  */
@@ -84,6 +101,20 @@ typedef struct {
     uint8_t type;               ///< Type of the array elements
 } ArrayInfo;
 
+/**
+ * State of a publication channel sending only changed values (delta mode)
+ *
+ * A checksum of the last published value of each node is stored to detect changes. The
+ * checksums buffer is indexed in the same order as the data_nodes array, so it should have
+ * the same number of elements. Nodes beyond num_checksums are always published.
+ */
+typedef struct {
+    uint32_t *checksums;        ///< Checksums of last published values (one per data node)
+    size_t num_checksums;       ///< Number of elements in checksums buffer
+    uint16_t refresh_interval;  ///< Publish all nodes every n-th call (0 = only first call)
+    uint16_t count;             ///< Number of calls since last full refresh (0 forces refresh)
+} PubDelta;
+
 /**
  * If TS_AUTODETECT_ARRLEN is assigned to num_elements, the number of elements in the array is
  * detected in the constructor by counting downwards till the first non-zero element is found.
@@ -135,6 +166,18 @@ static inline void *_function_to_void(void (*fnptr)()) { return (void*) fnptr; }
 #define TS_NODE_EXEC(_id, _name, _function_ptr, _parent, _acc) \
     {_id, _parent, _name, _function_to_void(_function_ptr), TS_T_EXEC, 0, _acc, 0}
 
+/*
+ * Exec node whose function is always called inside ThingSet::process, even if
+ * TS_DEFERRED_CALLBACKS is enabled (needed e.g. for authentication, which changes the context
+ * of the request)
+ *
+ * Exec nodes with parameters (child nodes) are always called immediately.
+ */
+#define TS_EXEC_IMMEDIATE 1
+#define TS_NODE_EXEC_IMMEDIATE(_id, _name, _function_ptr, _parent, _acc) \
+    {_id, _parent, _name, _function_to_void(_function_ptr), TS_T_EXEC, TS_EXEC_IMMEDIATE, \
+        _acc, 0}
+
 static inline void *_array_to_void(ArrayInfo *ptr) { return (void *) ptr; }
 #define TS_NODE_ARRAY(_id, _name, _data_ptr, _digits, _parent, _acc, _pubsub) \
     {_id, _parent, _name, _array_to_void(_data_ptr), TS_T_ARRAY, _digits, _acc, _pubsub}
@@ -230,6 +273,391 @@ typedef struct DataNode {
 
 } DataNode;
 
+/**
+ * Marks unused slots in the hash tables of ThingSetIndex
+ */
+#define TS_INDEX_EMPTY          UINT16_MAX
+
+/**
+ * Lookup structures for a fixed data nodes array generated by tools/ts_codegen.py
+ *
+ * All nodes are referenced by their position in the data nodes array. The arrays are constant,
+ * so they can be stored in flash.
+ *
+ * Node IDs are found with a minimal perfect hash: The first-level hash ts_id_hash(id, 0)
+ * selects a bucket (reduced to the range with ts_id_hash_range), which owns as many consecutive slots as IDs are mapped to it. The seed
+ * stored for the bucket is used for a second ts_id_hash, which maps the IDs of the bucket to
+ * different slots. As the buckets are independent, the hash can also be built at compile time
+ * (see thingset_id_hash.h).
+ *
+ * Node names are found in an open addressing hash table of ts_name_hash values with linear
+ * probing. The name, child, publication and CBOR key tables are optional (NULL and 0 if not
+ * used).
+ *
+ * The CBOR keys contain the ID of each node encoded as CBOR uint directly followed by the name
+ * encoded as CBOR text string, so binary mode responses and publication messages copy the keys
+ * instead of encoding them for each request.
+ */
+typedef struct {
+    uint16_t num_nodes;             ///< Number of nodes of the array the index was generated for
+    uint16_t num_id_buckets;        ///< Number of buckets of the ID hash
+    const uint16_t *id_seeds;       ///< Seed of the second-level ID hash for each bucket
+    const uint16_t *id_offsets;     ///< First slot of each bucket (num_id_buckets + 1 elements)
+    const uint16_t *id_slots;       ///< Node positions ordered by ID hash (num_nodes elements)
+    uint16_t name_mask;             ///< Number of slots of the name hash table minus 1
+    const uint16_t *name_slots;     ///< Node positions or TS_INDEX_EMPTY (name_mask + 1 elements)
+    const uint16_t *child_offsets;  ///< Start of the child nodes of each node in the children
+                                    ///< array (num_nodes + 2 elements, root node at num_nodes)
+    const uint16_t *children;       ///< Positions of child nodes in ascending order per parent
+    uint16_t num_pub_channels;      ///< Number of publication channels
+    const uint16_t *pub_channels;   ///< Bitfield of each publication channel
+    const uint16_t *pub_offsets;    ///< Start of the nodes of each channel in the pub_nodes
+                                    ///< array (num_pub_channels + 1 elements)
+    const uint16_t *pub_nodes;      ///< Positions of published nodes in ascending order per channel
+    const uint8_t *cbor_keys;       ///< CBOR encoded ID and name of all nodes
+    const uint16_t *cbor_key_offsets;   ///< Start of the keys of each node in the cbor_keys
+                                        ///< array (num_nodes + 1 elements)
+} ThingSetIndex;
+
+static constexpr uint32_t _ts_hash_mix(uint32_t hash, uint32_t shift, uint32_t factor)
+{
+    return (hash ^ (hash >> shift)) * factor;
+}
+
+/**
+ * Hash function for node IDs used by ThingSetIndex (murmur3 finalizer)
+ *
+ * Written as a single expression, so that it can be evaluated at compile time with C++11.
+ */
+static constexpr uint32_t ts_id_hash(node_id_t id, uint32_t seed)
+{
+    return _ts_hash_mix(_ts_hash_mix(_ts_hash_mix(id ^ (seed * 0x9E3779B9U), 16, 0x85EBCA6BU),
+        13, 0xC2B2AE35U), 16, 1);
+}
+
+/**
+ * Map a ts_id_hash value to the range 0...n-1 (n < 65536)
+ *
+ * Multiply-shift of the upper 16 bits of the hash instead of a modulo, as targets like
+ * Cortex-M0 have no hardware divider. The product fits into 32 bits, so it is a single
+ * multiplication on all targets.
+ */
+static constexpr uint32_t ts_id_hash_range(uint32_t hash, uint32_t n)
+{
+    return ((hash >> 16) * n) >> 16;
+}
+
+/**
+ * Hash function for node names used by ThingSetIndex (FNV-1a including the parent ID)
+ */
+static inline uint32_t ts_name_hash(node_id_t parent, const char *name, size_t len)
+{
+    uint32_t hash = 2166136261U ^ parent;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619U;
+    }
+    return hash;
+}
+
+/**
+ * Pre-encode the CBOR keys of a data nodes array for a ThingSetIndex
+ *
+ * For data nodes arrays not generated by tools/ts_codegen.py (e.g. with an index built by
+ * ts_make_id_hash), the keys can be encoded once at init instead. The index and both buffers
+ * have to be kept as long as the index is used.
+ *
+ * @param index Index to store the keys in (cbor_keys and cbor_key_offsets are set)
+ * @param nodes Data nodes array
+ * @param num_nodes Number of nodes in the data nodes array
+ * @param offsets Buffer for the offsets of the keys (num_nodes + 1 elements)
+ * @param keys Buffer for the keys or NULL to calculate the required size only
+ * @param size Size of the keys buffer
+ *
+ * @returns Number of bytes of the keys or -1 if the buffer is too small or the keys exceed
+ *          64 KiB (offsets are stored with 16 bits)
+ */
+int ts_encode_cbor_keys(ThingSetIndex *index, const DataNode *nodes, size_t num_nodes,
+    uint16_t *offsets, uint8_t *keys, size_t size);
+
+/**
+ * Context of a request processed by ThingSet
+ *
+ * Stores all data needed while processing a single request. Several threads can process
+ * requests with the same ThingSet object at the same time if each of them provides its own
+ * context.
+ *
+ * The context also stores the authentication status, so it should be kept for the entire
+ * session of a client (e.g. one context per communication interface or connection).
+ */
+typedef struct {
+    /**
+     * Pointer to request buffer (provided in process function)
+     */
+    uint8_t *req;
+
+    /**
+     * Length of the request
+     */
+    size_t req_len;
+
+    /**
+     * Pointer to response buffer (provided in process function)
+     */
+    uint8_t *resp;
+
+    /**
+     * Size of response buffer (i.e. maximum length)
+     */
+    size_t resp_size;
+
+    /**
+     * Pointer to the start of JSON payload in the request
+     */
+    char *json_str;
+
+    /**
+     * Length of JSON payload in the request
+     */
+    size_t json_len;
+
+#if TS_JSON_STREAMING
+    /**
+     * JSMN parser state to read tokens from json_str on demand
+     */
+    jsmn_parser json_parser;
+
+    /**
+     * Most recently parsed JSON token
+     */
+    jsmntok_t json_tok;
+
+    /**
+     * Index of json_tok (-1 if no token was parsed yet)
+     */
+    int json_tok_index;
+#else
+    /**
+     * JSON tokes in json_str parsed by JSMN
+     */
+    jsmntok_t tokens[TS_NUM_JSON_TOKENS];
+#endif
+
+    /**
+     * Number of JSON tokens parsed by JSMN
+     */
+    int tok_count;
+
+    /**
+     * Authentication status of the session using this context (authentication as "normal"
+     * user as default)
+     */
+    uint16_t auth_flags = TS_USR_MASK;
+
+    /**
+     * Number of nodes that may still be processed in the current step (-1 for unlimited)
+     */
+    int step_budget = -1;
+
+    /**
+     * Handler to be continued in the next step (0 if the request was not dispatched yet)
+     */
+    uint8_t step_handler = 0;
+
+    /**
+     * Endpoint of a request processed in multiple steps
+     */
+    const DataNode *step_node;
+
+    /**
+     * Index of the next node or JSON token (binary mode FETCH: position in the request)
+     */
+    unsigned int step_index;
+
+    /**
+     * Length of the response generated so far
+     */
+    unsigned int step_pos;
+
+    /**
+     * Number of elements already added to the response
+     */
+    unsigned int step_count;
+
+#if TS_DOUBLE_BUFFER
+    /**
+     * Front buffer acquired for the current request (NULL if none is acquired)
+     */
+    uint8_t *read_buf = NULL;
+#endif
+
+    /**
+     * Total number of elements (binary mode FETCH) or JSON array flag (text mode FETCH)
+     */
+    unsigned int step_total;
+
+#if TS_STATS
+    /**
+     * Cycles spent in the steps of the current request so far
+     */
+    uint32_t stats_cycles;
+#endif
+
+#if TS_DEFERRED_CALLBACKS
+    /**
+     * Position in the callback queue reserved by the current request
+     */
+    uint32_t callback_slot;
+
+    /**
+     * True if a position in the callback queue was reserved by the current request
+     */
+    bool callback_reserved = false;
+#endif
+} ThingSetContext;
+
+#if TS_UPDATE_QUEUE
+/**
+ * Value of a queued node update
+ */
+typedef union {
+    float f32;
+    int32_t i32;
+    uint32_t u32;
+    bool b;
+} NodeUpdateValue;
+
+/**
+ * Node update waiting in the queue
+ */
+typedef struct {
+    /**
+     * ID of the data node to be updated
+     */
+    node_id_t id;
+
+    /**
+     * Type of the value (TS_T_FLOAT32, TS_T_INT32, TS_T_UINT32 or TS_T_BOOL), converted to the
+     * type of the data node when applied
+     */
+    uint8_t type;
+
+    /**
+     * New value
+     */
+    NodeUpdateValue value;
+} NodeUpdate;
+#endif
+
+#if TS_STATS
+/**
+ * Index of the function codes in the request statistics
+ */
+enum ThingSetStatsFunction {
+    TS_STATS_GET,
+    TS_STATS_FETCH,
+    TS_STATS_PATCH,
+    TS_STATS_POST,          ///< Also create ('+') and exec ('!') requests in text mode
+    TS_STATS_DELETE,
+    TS_STATS_NUM_FUNCTIONS
+};
+
+/**
+ * Statistics of processed requests (see ThingSet::set_stats)
+ *
+ * The counters are only updated by the thread processing requests without any locking. If
+ * several threads process requests at the same time, single counts may get lost.
+ */
+struct ThingSetStats {
+    /**
+     * Number of requests per function code
+     */
+    uint32_t requests[TS_STATS_NUM_FUNCTIONS] = {};
+
+    /**
+     * Error responses by status code
+     */
+    uint32_t bad_request = 0;
+    uint32_t unauthorized = 0;
+    uint32_t forbidden = 0;
+    uint32_t not_found = 0;
+    uint32_t method_not_allowed = 0;
+    uint32_t request_too_large = 0;
+    uint32_t service_unavailable = 0;
+    uint32_t response_too_large = 0;
+    uint32_t other_errors = 0;      ///< Any other error status code
+
+    /**
+     * Latency histograms per function code (log-scale, see TS_STATS_HIST_BUCKETS)
+     */
+    uint32_t latency[TS_STATS_NUM_FUNCTIONS][TS_STATS_HIST_BUCKETS] = {};
+
+    /**
+     * Array information of the histograms for TS_STATS_NODES
+     */
+    ArrayInfo latency_info[TS_STATS_NUM_FUNCTIONS];
+
+    ThingSetStats()
+    {
+        for (int i = 0; i < TS_STATS_NUM_FUNCTIONS; i++) {
+            latency_info[i].ptr = latency[i];
+            latency_info[i].max_elements = TS_STATS_HIST_BUCKETS;
+            latency_info[i].num_elements = TS_STATS_HIST_BUCKETS;
+            latency_info[i].type = TS_T_UINT32;
+        }
+    }
+};
+
+/**
+ * Number of data nodes created by TS_STATS_NODES (IDs _first_id ... _first_id + 18)
+ */
+#define TS_STATS_NUM_NODES  19
+
+/**
+ * Read-only data nodes exposing the statistics, to be added to the data nodes array
+ *
+ * Example: TS_NODE_PATH(ID_STATS, "stats", 0, NULL), TS_STATS_NODES(0x7100, ID_STATS, stats, 0)
+ */
+#define TS_STATS_NODES(_first_id, _parent, _stats, _pubsub) \
+    TS_NODE_UINT32(_first_id, "GET", &(_stats).requests[TS_STATS_GET], \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 1, "FETCH", &(_stats).requests[TS_STATS_FETCH], \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 2, "PATCH", &(_stats).requests[TS_STATS_PATCH], \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 3, "POST", &(_stats).requests[TS_STATS_POST], \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 4, "DELETE", &(_stats).requests[TS_STATS_DELETE], \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 5, "BadRequest", &(_stats).bad_request, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 6, "Unauthorized", &(_stats).unauthorized, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 7, "Forbidden", &(_stats).forbidden, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 8, "NotFound", &(_stats).not_found, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 9, "MethodNotAllowed", &(_stats).method_not_allowed, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 10, "RequestTooLarge", &(_stats).request_too_large, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 11, "ServiceUnavailable", &(_stats).service_unavailable, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 12, "ResponseTooLarge", &(_stats).response_too_large, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_UINT32((_first_id) + 13, "OtherErrors", &(_stats).other_errors, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_ARRAY((_first_id) + 14, "LatencyGET", &(_stats).latency_info[TS_STATS_GET], 0, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_ARRAY((_first_id) + 15, "LatencyFETCH", &(_stats).latency_info[TS_STATS_FETCH], 0, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_ARRAY((_first_id) + 16, "LatencyPATCH", &(_stats).latency_info[TS_STATS_PATCH], 0, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_ARRAY((_first_id) + 17, "LatencyPOST", &(_stats).latency_info[TS_STATS_POST], 0, \
+        _parent, TS_ANY_R, _pubsub), \
+    TS_NODE_ARRAY((_first_id) + 18, "LatencyDELETE", &(_stats).latency_info[TS_STATS_DELETE], \
+        0, _parent, TS_ANY_R, _pubsub)
+#endif
+
 /**
  * Main ThingSet class
  *
@@ -255,16 +683,46 @@ public:
      * @param req_len Length of the data in the request buffer
      * @param response Pointer to the buffer where the ThingSet response should be stored
      * @param resp_size Size of the response buffer, i.e. maximum allowed length of the response
-
+     * @param ctx Pointer to the context used to store the state of this request or NULL to
+     *            use the internal context (not re-entrant)
+     *
      * @returns Actual length of the response written to the buffer or 0 in case of error
      */
-    int process(uint8_t *request, size_t req_len, uint8_t *response, size_t resp_size);
+    int process(uint8_t *request, size_t req_len, uint8_t *response, size_t resp_size,
+        ThingSetContext *ctx = NULL);
 
     /**
-     * Print all data nodes as a structured JSON text to stdout
+     * Start processing of a ThingSet request in multiple steps
+     *
+     * Same parameters as process(), but the request is only assigned to the context. It is
+     * processed by subsequent calls of process_step(), so that cooperative schedulers can run
+     * other tasks in between.
+     *
+     * The buffers and the context must stay valid until the request is finished.
+     */
+    void process_start(uint8_t *request, size_t req_len, uint8_t *response, size_t resp_size,
+        ThingSetContext *ctx = NULL);
+
+    /**
+     * Continue processing of a request started with process_start()
      *
-     * WARNING: This is a recursive function and might cause stack overflows if run in constrained
-     *          devices with large data node tree. Use with care and for testing only!
+     * GET requests of paths and FETCH requests yield after max_nodes nodes were added to the
+     * response. All other requests are finished in the first step.
+     *
+     * With TS_SEQLOCK or TS_DOUBLE_BUFFER, the values are only consistent within a step. A step
+     * of a read request is repeated if the values were updated in the meantime, and the request
+     * is answered with Service Unavailable if no consistent snapshot is found.
+     *
+     * @param max_nodes Maximum number of nodes processed in this step (at least 1)
+     * @param ctx Pointer to the context passed to process_start()
+     *
+     * @returns Actual length of the response if the request is finished or TS_PROCESS_PENDING
+     *          if further steps are needed
+     */
+    int process_step(int max_nodes, ThingSetContext *ctx = NULL);
+
+    /**
+     * Print all data nodes as a structured JSON text to stdout
      *
      * @param node_id Root node ID where to start with printing
      * @param level Indentation level (=depth inside the data node tree)
@@ -272,28 +730,136 @@ public:
     void dump_json(node_id_t node_id = 0, int level = 0);
 
     /**
-     * Sets current authentication level
+     * Write all data nodes as a structured JSON text using an output function
+     *
+     * The tree is traversed iteratively up to a depth of TS_DUMP_JSON_MAX_DEPTH, so the stack
+     * usage does not depend on the tree. The output is collected in a buffer of
+     * TS_DUMP_JSON_BUF_SIZE bytes before it is passed to the output function. Values which don't
+     * fit into this buffer (e.g. long strings or arrays) are printed as null, so the buffer size
+     * has to be increased if such nodes should be dumped.
+     *
+     * @param write Function called with each chunk of output data
+     * @param arg Argument passed to the write function (e.g. a FILE pointer for write_file)
+     * @param node_id Root node ID where to start with printing
+     * @param level Indentation level (=depth inside the data node tree)
+     */
+    void dump_json(void (*write)(const char *buf, size_t len, void *arg), void *arg,
+        node_id_t node_id = 0, int level = 0);
+
+    /**
+     * Output function for dump_json to write into a FILE stream
+     *
+     * @param buf Pointer to the data to be written
+     * @param len Length of the data
+     * @param file FILE pointer of the stream
+     */
+    static void write_file(const char *buf, size_t len, void *file);
+
+    /**
+     * Sets current authentication level of a session
      *
      * The authentication flags must match with access flags specified in DataNode to allow
      * read/write access to a data node.
      *
+     * If no context is specified, the authentication level is changed for the request whose
+     * callback is currently executed (e.g. the callback of an auth node) or for the internal
+     * context if called outside of a callback. The callback context is stored per thread (see
+     * TS_THREAD_LOCAL), so callbacks may be executed by different threads at the same time.
+     *
      * @param flags Flags to define authentication level (1 = access allowed)
+     * @param ctx Context of the session or NULL (see above)
+     */
+    void set_authentication(uint16_t flags, ThingSetContext *ctx = NULL)
+    {
+        if (ctx == NULL) {
+            ctx = (_callback_ctx != NULL) ? _callback_ctx : &_ctx;
+        }
+        ctx->auth_flags = flags;
+    }
+
+    /**
+     * Mark the start of an update of node values by the application
+     *
+     * Publication messages serialized until end_update is called are discarded and generated
+     * again, so that they only contain values from a consistent snapshot. Updates may be
+     * performed by different threads (e.g. PATCH requests and the application) at the same
+     * time.
+     *
+     * Does nothing if TS_SEQLOCK is not enabled.
+     */
+    void begin_update()
+    {
+#if TS_SEQLOCK
+        _seq.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+#endif
+    }
+
+    /**
+     * Mark the end of an update of node values by the application
+     */
+    void end_update()
+    {
+#if TS_SEQLOCK
+        // one writer less, one more finished update
+        _seq.fetch_add(TS_SEQ_UPDATE - 1, std::memory_order_release);
+#endif
+    }
+
+#if TS_DOUBLE_BUFFER
+    /**
+     * Store node values in a double buffer
+     *
+     * The data nodes reference the variables in the front buffer, which must be a struct or
+     * array containing all values updated by the producer. The back buffer and the spare buffer
+     * are further instances of the same type. The spare buffer is needed so that the producer
+     * never overwrites a buffer which is still used by a reader. Nodes in the double buffer
+     * should be read-only and must not be arrays.
+     *
+     * @param front Pointer to the buffer referenced by the data nodes (NULL to disable)
+     * @param back Pointer to the second buffer of the same size
+     * @param spare Pointer to the third buffer of the same size
+     * @param size Size of each buffer
+     */
+    void set_double_buffer(void *front, void *back, void *spare, size_t size);
+
+    /**
+     * Get the buffer where the producer should write new values
+     *
+     * @returns Pointer to the back buffer
      */
-    void set_authentication(uint16_t flags)
+    void *get_back_buffer()
     {
-        _auth_flags = flags;
+        return _buf[_buf_back];
     }
 
+    /**
+     * Make the values written to the back buffer visible for readers
+     *
+     * The new back buffer is initialized with the current values, so the producer may update
+     * only some of the values in the next cycle. Must only be called by the producer.
+     *
+     * @returns True if the buffers were swapped, false if the spare buffer is still used by a
+     *          reader (the producer keeps writing to the same back buffer and swaps later)
+     */
+    bool swap_buffers();
+#endif
+
     /**
      * Generate publication message in JSON format
      *
+     * If delta is specified, only nodes with changed values since the last call are included
+     * in the message, except for full refreshes as configured in delta.
+     *
      * @param buf Pointer to the buffer where the publication message should be stored
      * @param size Size of the message buffer, i.e. maximum allowed length of the message
      * @param pub_ch Flag to select publication channel (must match pubsub of data node)
+     * @param delta Pointer to state of the channel for delta mode or NULL to publish all nodes
      *
-     * @returns Actual length of the message written to the buffer or 0 in case of error
+     * @returns Actual length of the message written to the buffer or 0 in case of error or if
+     *          no value changed in delta mode
      */
-    int txt_pub(char *buf, size_t size, const uint16_t pub_ch);
+    int txt_pub(char *buf, size_t size, const uint16_t pub_ch, PubDelta *delta = NULL);
 
     /**
      * Generate publication message in CBOR format
@@ -325,12 +891,156 @@ public:
     int bin_pub_can(int &start_pos, uint16_t pub_ch, uint8_t can_dev_id, uint32_t &msg_id,
         uint8_t (&msg_data)[8]);
 
+#if TS_DEFERRED_CALLBACKS
+    /**
+     * Call the functions of exec nodes and path callbacks queued by process()
+     *
+     * Must be called regularly by a worker thread or the main loop (e.g. after the response of
+     * a request was sent). The functions are called without request context, so they can't
+     * change the authentication of a session (see TS_NODE_EXEC_IMMEDIATE).
+     *
+     * @returns Number of functions called
+     */
+    int run_deferred_callbacks();
+#endif
+
+#if TS_UPDATE_QUEUE
+    /**
+     * Queue a new value for a data node
+     *
+     * Lock-free and interrupt-safe, but all updates must be queued by the same producer (e.g.
+     * a single ISR). The value is converted to the type of the data node in apply_updates().
+     *
+     * @param id ID of the data node
+     * @param value New value
+     *
+     * @returns True if the update was queued, false if the queue is full
+     */
+    bool queue_update_f32(node_id_t id, float value)
+    {
+        NodeUpdateValue v;
+        v.f32 = value;
+        return queue_update(id, TS_T_FLOAT32, v);
+    }
+
+    /**
+     * Queue a new value for a data node (see queue_update_f32)
+     */
+    bool queue_update_i32(node_id_t id, int32_t value)
+    {
+        NodeUpdateValue v;
+        v.i32 = value;
+        return queue_update(id, TS_T_INT32, v);
+    }
+
+    /**
+     * Queue a new value for a data node (see queue_update_f32)
+     */
+    bool queue_update_u32(node_id_t id, uint32_t value)
+    {
+        NodeUpdateValue v;
+        v.u32 = value;
+        return queue_update(id, TS_T_UINT32, v);
+    }
+
+    /**
+     * Queue a new value for a data node (see queue_update_f32)
+     */
+    bool queue_update_bool(node_id_t id, bool value)
+    {
+        NodeUpdateValue v;
+        v.b = value;
+        return queue_update(id, TS_T_BOOL, v);
+    }
+
+    /**
+     * Write the queued updates to the data nodes
+     *
+     * Must always be called by the same thread, usually the one processing requests and
+     * publishing messages, before processing a request or generating a publication message.
+     *
+     * @returns Number of data nodes updated (updates for unknown nodes are dropped)
+     */
+    int apply_updates();
+#endif
+
+#if TS_STATS
+    /**
+     * Collect statistics of all requests processed by this object
+     *
+     * The statistics can be exposed as data nodes using TS_STATS_NODES.
+     *
+     * @param stats Pointer to the statistics or NULL to stop collecting them
+     * @param cycle_counter Function returning a free-running counter (e.g. the DWT cycle counter
+     *                      of Cortex-M or a microsecond timer) to measure the latency, or NULL
+     *                      to count requests and errors only
+     */
+    void set_stats(ThingSetStats *stats, uint32_t (*cycle_counter)(void) = NULL)
+    {
+        _stats_cycle_counter = cycle_counter;
+        _stats = stats;
+    }
+#endif
+
+#if TS_NODE_PROFILING
+    /**
+     * Count the accesses of each data node via get_node
+     *
+     * The counters are updated without locking by the thread processing requests. If several
+     * threads process requests at the same time, single counts may get lost.
+     *
+     * @param counters Buffer with one counter per data node (same order as the data_nodes
+     *                 array) or NULL to stop profiling
+     */
+    void set_node_profile(uint32_t *counters)
+    {
+        _node_profile = counters;
+    }
+#endif
+
+#if TS_HOT_NODES > 0
+    /**
+     * Set the nodes searched first by get_node (lookaside list)
+     *
+     * The most frequently accessed nodes can be determined from captured traffic with the
+     * program of the native-profile environment. Must not be called while requests are
+     * processed.
+     *
+     * @param ids Array of node IDs ordered by access frequency or NULL to clear the list
+     * @param num_ids Number of node IDs (only the first TS_HOT_NODES are used)
+     *
+     * @returns Number of nodes in the lookaside list (unknown IDs are skipped)
+     */
+    int set_hot_nodes(const node_id_t *ids, size_t num_ids);
+#endif
+
+#if TS_NODE_INDEX
+    /**
+     * Set the lookup structures for the data nodes array
+     *
+     * With an index, nodes are found by ID and by name (with known parent) with a single hash
+     * lookup, and the child nodes of a path and the nodes of a publication channel are
+     * iterated without searching the entire data nodes array. The index is generated together
+     * with the data nodes array from a schema by tools/ts_codegen.py. Must not be called while
+     * requests are processed.
+     *
+     * If nodes are added to or removed from a publication channel at runtime, the nodes of
+     * all channels are searched in the data nodes array again.
+     *
+     * @param index Lookup structures generated for the data nodes array or NULL to search the
+     *              data nodes array linearly
+     *
+     * @returns 0 for success or -1 if the index does not match the data nodes array
+     */
+    int set_index(const ThingSetIndex *index);
+#endif
+
     /**
      * Update data nodes based on values provided in payload data (e.g. from other pub msg)
      *
      * @param cbor_data Buffer containing key/value map that should be written to the data nodes
      * @param len Length of the data in the buffer
-     * @param auth_flags Authentication flags to be used in this function (to override _auth_flags)
+     * @param auth_flags Authentication flags to be used in this function (no session is used)
      * @param sub_ch Subscribe channel (as bitfield)
      *
      * @returns ThingSet status code
@@ -359,6 +1069,20 @@ public:
      */
     DataNode *const get_node(const char *name, size_t len, int32_t parent = -1);
 
+    /**
+     * Get data node by its position in the data nodes array
+     *
+     * Can be used to iterate over all nodes.
+     *
+     * @param index Position in the array
+     *
+     * @returns Pointer to data node or NULL if index is out of range
+     */
+    DataNode *const get_node_by_index(size_t index)
+    {
+        return (index < num_nodes) ? &data_nodes[index] : NULL;
+    }
+
     /**
      * Get the endpoint node of a provided path
      *
@@ -370,51 +1094,95 @@ public:
     DataNode *const get_endpoint(const char *path, size_t len);
 
 private:
+    /**
+     * Handlers which can be continued in a further step (stored in ctx->step_handler)
+     */
+    enum StepHandler {
+        TS_STEP_NONE,
+        TS_STEP_TXT_GET_NAMES,
+        TS_STEP_TXT_GET_VALUES,
+        TS_STEP_TXT_FETCH,
+        TS_STEP_BIN_GET_NAMES,
+        TS_STEP_BIN_GET_VALUES,
+        TS_STEP_BIN_GET_IDS,
+        TS_STEP_BIN_FETCH,
+    };
+
+    /**
+     * Detects text or binary mode and calls the according process function
+     */
+    int process_request(ThingSetContext *ctx);
+
+    /**
+     * Continues the handler of a request processed in steps (or dispatches it in the first step)
+     */
+    int process_step_handler(ThingSetContext *ctx);
+
+    /**
+     * Checks if the next node has to be processed in a further step
+     *
+     * @returns True if the node budget of the current step is used up, otherwise the budget is
+     *          decreased by one node and false is returned
+     */
+    bool step_yield(ThingSetContext *ctx)
+    {
+        if (ctx->step_budget == 0) {
+            return true;
+        }
+        else if (ctx->step_budget > 0) {
+            ctx->step_budget--;
+        }
+        return false;
+    }
+
     /**
      * Prepares JSMN parser, performs initial check of payload data and calls get/fetch/patch
      * functions
      */
-    int txt_process();
+    int txt_process(ThingSetContext *ctx);
 
     /**
      * Performs initial check of payload data and calls get/fetch/patch functions
      */
-    int bin_process();
+    int bin_process(ThingSetContext *ctx);
 
     /**
      * GET request (text mode)
      *
      * List child data nodes (function called without content / parameters)
      */
-    int txt_get(const DataNode *parent, bool include_values = false);
+    int txt_get(ThingSetContext *ctx, const DataNode *parent, bool include_values = false);
 
     /**
      * GET request (binary mode)
      *
      * List child data nodes (function called without content)
      */
-    int bin_get(const DataNode *parent, bool values = false, bool ids_only = true);
+    int bin_get(ThingSetContext *ctx, const DataNode *parent, bool values = false,
+        bool ids_only = true);
 
     /**
      * FETCH request (text mode)
      *
      * Read data node values (function called with an array as argument)
      */
-    int txt_fetch(node_id_t parent_id);
+    int txt_fetch(ThingSetContext *ctx, node_id_t parent_id);
 
     /**
      * FETCH request (binary mode)
      *
      * Read data node values (function called with an array as argument)
      */
-    int bin_fetch(const DataNode *parent, unsigned int pos_payload);
+    int bin_fetch(ThingSetContext *ctx, const DataNode *parent, unsigned int pos_payload);
 
     /**
      * PATCH request (text mode)
      *
      * Write data node values in text mode (function called with a map as argument)
+     *
+     * @returns Status code for the response (TS_STATUS_CHANGED if the values were written)
      */
-    int txt_patch(node_id_t parent_id);
+    uint8_t txt_patch(ThingSetContext *ctx, node_id_t parent_id);
 
     /**
      * PATCH request (binary mode)
@@ -424,52 +1192,56 @@ private:
      * If sub_ch is specified, nodes not found are silently ignored. Otherwise, a NOT_FOUND
      * error is raised.
      *
+     * @param ctx Context of the currently processed request
      * @param parent Pointer to path / parent node or NULL to consider any node
      * @param pos_payload Position of payload in req buffer
      * @param auth_flags Bitset to specify authentication status for different roles
      * @param sub_ch Bitset to specifiy subscribe channel to be considered, 0 to ignore
      */
-    int bin_patch(const DataNode *parent, unsigned int pos_payload, uint16_t auth_flags,
-        uint16_t sub_ch);
+    int bin_patch(ThingSetContext *ctx, const DataNode *parent, unsigned int pos_payload,
+        uint16_t auth_flags, uint16_t sub_ch);
 
     /**
      * POST request to append data
      */
-    int txt_create(const DataNode *node);
+    int txt_create(ThingSetContext *ctx, const DataNode *node);
 
     /**
      * DELETE request to delete data from node
      */
-    int txt_delete(const DataNode *node);
+    int txt_delete(ThingSetContext *ctx, const DataNode *node);
 
     /**
      * Execute command in text mode (function called with a single data node name as argument)
      */
-    int txt_exec(const DataNode *node);
+    int txt_exec(ThingSetContext *ctx, const DataNode *node);
 
     /**
      * Execute command in binary mode (function called with a single data node name/id as argument)
      *
+     * @param ctx Context of the currently processed request
      * @param parent Pointer to executable node
      * @param pos_payload Position of payload in req buffer
      */
-    int bin_exec(const DataNode *node, unsigned int pos_payload);
+    int bin_exec(ThingSetContext *ctx, const DataNode *node, unsigned int pos_payload);
 
     /**
      * Fill the resp buffer with a JSON response status message
      *
+     * @param ctx Context of the currently processed request
      * @param code Status code
      * @returns length of status message in buffer or 0 in case of error
      */
-    int txt_response(int code);
+    int txt_response(ThingSetContext *ctx, int code);
 
     /**
      * Fill the resp buffer with a CBOR response status message
      *
+     * @param ctx Context of the currently processed request
      * @param code Status code
      * @returns length of status message in buffer or 0 in case of error
      */
-    int bin_response(uint8_t code);
+    int bin_response(ThingSetContext *ctx, uint8_t code);
 
     /**
      * Serialize a node value into a JSON string
@@ -477,17 +1249,20 @@ private:
      * @param buf Pointer to the buffer where the JSON value should be stored
      * @param size Size of the buffer, i.e. maximum allowed length of the value
      * @param node Pointer to node which should be serialized
+     * @param front Front buffer acquired by the reader (see node_data)
      *
      * @returns Length of data written to buffer or 0 in case of error
      */
-    int json_serialize_value(char *buf, size_t size, const DataNode *node);
+    int json_serialize_value(char *buf, size_t size, const DataNode *node,
+        const uint8_t *front);
 
     /**
      * Serialize node name and value as JSON object
      *
      * same as json_serialize_value, just that the node name is also serialized
      */
-    int json_serialize_name_value(char *buf, size_t size, const DataNode *node);
+    int json_serialize_name_value(char *buf, size_t size, const DataNode *node,
+        const uint8_t *front);
 
     /**
      * Deserialize a node value from a JSON string
@@ -501,6 +1276,181 @@ private:
      */
     int json_deserialize_value(char *buf, size_t len, jsmntype_t type, const DataNode *node);
 
+    /**
+     * Deserialize a JSON array into the buffer of an array node
+     *
+     * @param ctx Context of the currently processed request
+     * @param tok Index of the token containing the array
+     * @param node Pointer to array node where the deserialized elements should be stored
+     * @param check_only Only check if all elements can be deserialized without storing them
+     *
+     * @returns Number of tokens processed (array and its elements), 0 in case of an invalid
+     *          format or -1 if the array has more elements than the node can store
+     */
+    int json_deserialize_array(ThingSetContext *ctx, int tok, const DataNode *node,
+        bool check_only);
+
+    /**
+     * Get JSON token of the request payload
+     *
+     * In streaming mode, the tokens are parsed on demand. Accessing the tokens in ascending
+     * order is cheap, going back to a previous token requires parsing from the beginning.
+     *
+     * @param ctx Context of the currently processed request
+     * @param index Index of the token (same order as in JSMN token array)
+     *
+     * @returns Copy of the token (type JSMN_UNDEFINED if not found or invalid)
+     */
+    jsmntok_t json_token(ThingSetContext *ctx, int index);
+
+    /**
+     * Generate publication message in JSON format without checking for consistency
+     */
+    int txt_pub_nodes(char *buf, size_t size, const uint16_t pub_ch, PubDelta *delta,
+        const uint8_t *front);
+
+    /**
+     * Generate publication message in CBOR format without checking for consistency
+     */
+    int bin_pub_nodes(uint8_t *buf, size_t size, const uint16_t pub_ch, const uint8_t *front);
+
+    /**
+     * Reserve a position in the callback queue for the function of an exec node or path
+     *
+     * Must be called before any value is changed by the request, so that the request can be
+     * rejected without side effects if the queue is full. Each successful reservation must be
+     * followed by a call of run_callback.
+     *
+     * @param ctx Context of the request
+     * @param node Exec node or path whose function will be called
+     *
+     * @returns False if the queue is full
+     */
+    bool reserve_callback(ThingSetContext *ctx, const DataNode *node);
+
+    /**
+     * Call the function of an exec node or path callback (or queue it for deferred execution)
+     *
+     * @param ctx Context of the request causing the call
+     * @param node Exec node or path passed to reserve_callback
+     * @param call False to release the reserved position without calling the function (e.g.
+     *             because the request failed)
+     */
+    void run_callback(ThingSetContext *ctx, const DataNode *node, bool call);
+
+    /**
+     * Get pointer to the current value of a data node
+     *
+     * @param node Pointer to the data node
+     * @param front Front buffer acquired by read_begin (ignored without double buffer)
+     *
+     * @returns Pointer to the value in the front buffer for double-buffered nodes, otherwise
+     *          node->data
+     */
+    void *node_data(const DataNode *node, const uint8_t *front)
+    {
+#if TS_DOUBLE_BUFFER
+        uint8_t *data = (uint8_t *)node->data;
+        if (front != NULL && data >= _buf[0] && data < _buf[0] + _buf_size) {
+            return (uint8_t *)front + (data - _buf[0]);
+        }
+#endif
+        return node->data;
+    }
+
+    /**
+     * Get the front buffer acquired for a request (NULL without double buffer)
+     */
+    const uint8_t *read_buf(const ThingSetContext *ctx)
+    {
+#if TS_DOUBLE_BUFFER
+        return ctx->read_buf;
+#else
+        return NULL;
+#endif
+    }
+
+#if TS_SEQLOCK || TS_DOUBLE_BUFFER
+    /**
+     * State of the node values at the beginning of a read operation
+     */
+    typedef struct {
+        uint32_t seq;       ///< Sequence counter of the seqlock
+        uint32_t buf;       ///< Index of the front buffer acquired by the reader
+        uint8_t *front;     ///< Front buffer acquired by the reader (NULL without double buffer)
+    } ReadState;
+
+    /**
+     * Start reading a consistent snapshot of node values
+     *
+     * With double buffer, the current front buffer is acquired until read_end is called, so
+     * that the producer doesn't write to it. Values must be read via node_data with
+     * state->front (or the read_buf of the request context).
+     *
+     * @param state Pointer to the state to be passed to read_validate and read_end
+     * @param ctx Context of a request reading the values or NULL
+     */
+    void read_begin(ReadState *state, ThingSetContext *ctx = NULL)
+    {
+        state->front = NULL;
+#if TS_SEQLOCK
+        state->seq = _seq.load(std::memory_order_acquire);
+#endif
+#if TS_DOUBLE_BUFFER
+        while (true) {
+            uint32_t front = _buf_front.load();
+            _buf_readers[front].fetch_add(1);
+            // the producer may have swapped the buffers before the reader count was increased
+            if (_buf_front.load() == front) {
+                state->buf = front;
+                state->front = _buf[front];
+                break;
+            }
+            _buf_readers[front].fetch_sub(1);
+        }
+        if (ctx != NULL) {
+            ctx->read_buf = state->front;
+        }
+#endif
+    }
+
+    /**
+     * Check if node values read since read_begin are consistent
+     *
+     * @param state Pointer to the state filled by read_begin
+     *
+     * @returns True if no update happened in the meantime
+     */
+    bool read_validate(const ReadState *state)
+    {
+#if TS_SEQLOCK
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((state->seq & TS_SEQ_WRITERS_MASK) ||
+            _seq.load(std::memory_order_relaxed) != state->seq)
+        {
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    /**
+     * Release the buffer acquired by read_begin
+     *
+     * @param state Pointer to the state filled by read_begin
+     * @param ctx Context passed to read_begin
+     */
+    void read_end(const ReadState *state, ThingSetContext *ctx = NULL)
+    {
+#if TS_DOUBLE_BUFFER
+        if (ctx != NULL) {
+            ctx->read_buf = NULL;
+        }
+        _buf_readers[state->buf].fetch_sub(1, std::memory_order_release);
+#endif
+    }
+#endif
+
     /**
      * Array of nodes database provided during initialization
      */
@@ -512,44 +1462,245 @@ private:
     size_t num_nodes;
 
     /**
-     * Pointer to request buffer (provided in process function)
+     * Context used if process() is called without a context
      */
-    uint8_t *req;
+    ThingSetContext _ctx;
 
     /**
-     * Length of the request
+     * Context of the request whose callback is currently executed by this thread (NULL outside
+     * of callbacks)
      */
-    size_t req_len;
+    static TS_THREAD_LOCAL ThingSetContext *_callback_ctx;
 
+#if TS_DEFERRED_CALLBACKS
     /**
-     * Pointer to response buffer (provided in process function)
+     * Function call waiting in the callback queue
+     *
+     * The request context is not stored, as it may not exist anymore when the function is
+     * called.
      */
-    uint8_t *resp;
+    typedef struct {
+        std::atomic<uint32_t> seq;  ///< Queue position for which the slot is free or filled
+        void (*fn)(void);           ///< Function to be called (NULL if the request failed)
+    } DeferredCall;
 
     /**
-     * Size of response buffer (i.e. maximum length)
+     * Bounded ring buffer for deferred callbacks
+     *
+     * Slots are reserved and released with compare-and-swap, so requests may be processed and
+     * callbacks executed by multiple threads at the same time.
      */
-    size_t resp_size;
+    DeferredCall _call_queue[TS_CALLBACK_QUEUE_SIZE];
 
     /**
-     * Pointer to the start of JSON payload in the request
+     * Number of positions reserved by requests
      */
-    char *json_str;
+    std::atomic<uint32_t> _call_head{0};
 
     /**
-     * JSON tokes in json_str parsed by JSMN
+     * Number of calls removed from the queue
      */
-    jsmntok_t tokens[TS_NUM_JSON_TOKENS];
+    std::atomic<uint32_t> _call_tail{0};
+#endif
 
+#if TS_UPDATE_QUEUE
     /**
-     * Number of JSON tokens parsed by JSMN
+     * Add an update to the queue (producer side)
      */
-    int tok_count;
+    bool queue_update(node_id_t id, uint8_t type, NodeUpdateValue value)
+    {
+        uint32_t head = _update_head.load(std::memory_order_relaxed);
+        if (head - _update_tail.load(std::memory_order_acquire) >= TS_UPDATE_QUEUE_SIZE) {
+            return false;
+        }
+        NodeUpdate *update = &_update_queue[head % TS_UPDATE_QUEUE_SIZE];
+        update->id = id;
+        update->type = type;
+        update->value = value;
+        _update_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Ring buffer for node updates (single producer, single consumer)
+     */
+    NodeUpdate _update_queue[TS_UPDATE_QUEUE_SIZE];
+
+    /**
+     * Number of updates added to the queue (only written by the producer)
+     */
+    std::atomic<uint32_t> _update_head{0};
+
+    /**
+     * Number of updates removed from the queue (only written by apply_updates)
+     */
+    std::atomic<uint32_t> _update_tail{0};
+#endif
+
+    /**
+     * Count the access of a node if profiling is enabled
+     *
+     * @returns Pointer to the node
+     */
+    DataNode *count_access(DataNode *node)
+    {
+#if TS_NODE_PROFILING
+        if (_node_profile != NULL) {
+            _node_profile[node - data_nodes]++;
+        }
+#endif
+        return node;
+    }
+
+    /**
+     * Find the next child node of a parent in the data nodes array
+     *
+     * @param parent_id Node ID of the parent (0 for the root node)
+     * @param start Position in data_nodes array to start searching
+     *
+     * @returns Position of the child node or num_nodes if no more child nodes were found
+     */
+    unsigned int next_child(node_id_t parent_id, unsigned int start);
+
+    /**
+     * Find the next node of a publication channel in the data nodes array
+     *
+     * @param pub_ch Publication channel (as bitfield)
+     * @param start Position in data_nodes array to start searching
+     *
+     * @returns Position of the node or num_nodes if no more nodes were found
+     */
+    unsigned int next_pub_node(uint16_t pub_ch, unsigned int start);
+
+    /**
+     * Serialize the ID of a node as CBOR (copied from the pre-encoded keys of the index if
+     * available)
+     *
+     * @param buf Buffer to store the ID
+     * @param size Size of the buffer
+     * @param pos Position of the node in the data nodes array
+     *
+     * @returns Number of bytes added to the buffer or 0 if it is too small
+     */
+    int bin_serialize_id(uint8_t *buf, size_t size, unsigned int pos);
+
+    /**
+     * Serialize the name of a node as CBOR (copied from the pre-encoded keys of the index if
+     * available)
+     *
+     * @param buf Buffer to store the name
+     * @param size Size of the buffer
+     * @param pos Position of the node in the data nodes array
+     *
+     * @returns Number of bytes added to the buffer or 0 if it is too small
+     */
+    int bin_serialize_name(uint8_t *buf, size_t size, unsigned int pos);
+
+#if TS_STATS
+    /**
+     * Update the statistics after a request was processed
+     *
+     * @param ctx Context of the finished request
+     * @param len Length of the response
+     * @param cycles Number of cycles spent to process the request
+     */
+    void update_stats(ThingSetContext *ctx, int len, uint32_t cycles);
+
+    /**
+     * Statistics of processed requests (NULL if disabled)
+     */
+    ThingSetStats *_stats = NULL;
+
+    /**
+     * Counter to measure the latency of requests (NULL if disabled)
+     */
+    uint32_t (*_stats_cycle_counter)(void) = NULL;
+#endif
+
+#if TS_NODE_PROFILING
+    /**
+     * Access counters of the data nodes (NULL if disabled)
+     */
+    uint32_t *_node_profile = NULL;
+#endif
+
+#if TS_HOT_NODES > 0
+    /**
+     * Lookaside list of frequently accessed nodes
+     */
+    DataNode *_hot_nodes[TS_HOT_NODES];
+
+    size_t _num_hot_nodes = 0;
+#endif
+
+#if TS_NODE_INDEX
+    /**
+     * Find the position of a node in the data nodes array via the index
+     *
+     * @returns Position of the node or num_nodes if the ID is not found
+     */
+    unsigned int index_find(node_id_t id)
+    {
+        unsigned int bucket = ts_id_hash_range(ts_id_hash(id, 0), _index->num_id_buckets);
+        unsigned int first = _index->id_offsets[bucket];
+        unsigned int num_slots = _index->id_offsets[bucket + 1] - first;
+        if (num_slots == 0) {
+            return num_nodes;
+        }
+        unsigned int pos = _index->id_slots[first +
+            ts_id_hash_range(ts_id_hash(id, _index->id_seeds[bucket]), num_slots)];
+        return (data_nodes[pos].id == id) ? pos : num_nodes;
+    }
+
+    /**
+     * Lookup structures for the data nodes array (NULL if disabled)
+     */
+    const ThingSetIndex *_index = NULL;
+
+    /**
+     * False if publication channels were changed at runtime, so that the publication lists
+     * of the index are outdated
+     */
+    bool _index_pub_valid = false;
+#endif
+
+#if TS_SEQLOCK
+    /**
+     * Sequence counter of the seqlock
+     *
+     * The lower bits count the writers currently updating node values, the upper bits count
+     * the finished updates (see TS_SEQ_UPDATE), so that multiple writers can be tracked with a
+     * single atomic counter.
+     */
+    std::atomic<uint32_t> _seq{0};
+#endif
+
+#if TS_DOUBLE_BUFFER
+    /**
+     * Front, back and spare buffer (nodes reference _buf[0])
+     */
+    uint8_t *_buf[3] = {};
+
+    /**
+     * Size of each of the buffers
+     */
+    size_t _buf_size = 0;
+
+    /**
+     * Index of the buffer with the latest values published by swap_buffers
+     */
+    std::atomic<uint32_t> _buf_front{0};
+
+    /**
+     * Index of the buffer written by the producer (only accessed by the producer)
+     */
+    uint32_t _buf_back = 1;
 
     /**
-     * Stores current authentication status (authentication as "normal" user as default)
+     * Number of readers currently using each of the buffers
      */
-    uint16_t _auth_flags = TS_USR_MASK;
+    std::atomic<uint32_t> _buf_readers[3] = {};
+#endif
 };
 
 #endif /* THINGSET_H_ */
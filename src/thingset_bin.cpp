@@ -22,20 +22,20 @@ static int cbor_deserialize_data_node(uint8_t *buf, const DataNode *data_node)
     switch (data_node->type) {
 #if (TS_64BIT_TYPES_SUPPORT == 1)
     case TS_T_UINT64:
-        return cbor_deserialize_uint64(buf, (uint64_t *)data_node->data);
+        return cbor_deserialize_uint64_fast(buf, (uint64_t *)data_node->data);
     case TS_T_INT64:
-        return cbor_deserialize_int64(buf, (int64_t *)data_node->data);
+        return cbor_deserialize_int64_fast(buf, (int64_t *)data_node->data);
 #endif
     case TS_T_UINT32:
-        return cbor_deserialize_uint32(buf, (uint32_t *)data_node->data);
+        return cbor_deserialize_uint32_fast(buf, (uint32_t *)data_node->data);
     case TS_T_INT32:
-        return cbor_deserialize_int32(buf, (int32_t *)data_node->data);
+        return cbor_deserialize_int32_fast(buf, (int32_t *)data_node->data);
     case TS_T_UINT16:
-        return cbor_deserialize_uint16(buf, (uint16_t *)data_node->data);
+        return cbor_deserialize_uint16_fast(buf, (uint16_t *)data_node->data);
     case TS_T_INT16:
-        return cbor_deserialize_int16(buf, (int16_t *)data_node->data);
+        return cbor_deserialize_int16_fast(buf, (int16_t *)data_node->data);
     case TS_T_FLOAT32:
-        return cbor_deserialize_float(buf, (float *)data_node->data);
+        return cbor_deserialize_float_fast(buf, (float *)data_node->data);
     case TS_T_BOOL:
         return cbor_deserialize_bool(buf, (bool *)data_node->data);
     case TS_T_STRING:
@@ -69,26 +69,26 @@ int cbor_deserialize_array_type(uint8_t *buf, const DataNode *data_node)
         switch (array_info->type) {
 #if (TS_64BIT_TYPES_SUPPORT == 1)
         case TS_T_UINT64:
-            pos += cbor_deserialize_uint64(&(buf[pos]), &(((uint64_t *)array_info->ptr)[i]));
+            pos += cbor_deserialize_uint64_fast(&(buf[pos]), &(((uint64_t *)array_info->ptr)[i]));
             break;
         case TS_T_INT64:
-            pos += cbor_deserialize_int64(&(buf[pos]), &(((int64_t *)array_info->ptr)[i]));
+            pos += cbor_deserialize_int64_fast(&(buf[pos]), &(((int64_t *)array_info->ptr)[i]));
             break;
 #endif
         case TS_T_UINT32:
-            pos += cbor_deserialize_uint32(&(buf[pos]), &(((uint32_t *)array_info->ptr)[i]));
+            pos += cbor_deserialize_uint32_fast(&(buf[pos]), &(((uint32_t *)array_info->ptr)[i]));
             break;
         case TS_T_INT32:
-            pos += cbor_deserialize_int32(&(buf[pos]), &(((int32_t *)array_info->ptr)[i]));
+            pos += cbor_deserialize_int32_fast(&(buf[pos]), &(((int32_t *)array_info->ptr)[i]));
             break;
         case TS_T_UINT16:
-            pos += cbor_deserialize_uint16(&(buf[pos]), &(((uint16_t *)array_info->ptr)[i]));
+            pos += cbor_deserialize_uint16_fast(&(buf[pos]), &(((uint16_t *)array_info->ptr)[i]));
             break;
         case TS_T_INT16:
-            pos += cbor_deserialize_int16(&(buf[pos]), &(((int16_t *)array_info->ptr)[i]));
+            pos += cbor_deserialize_int16_fast(&(buf[pos]), &(((int16_t *)array_info->ptr)[i]));
             break;
         case TS_T_FLOAT32:
-            pos += cbor_deserialize_float(&(buf[pos]), &(((float *)array_info->ptr)[i]));
+            pos += cbor_deserialize_float_fast(&(buf[pos]), &(((float *)array_info->ptr)[i]));
             break;
         default:
             break;
@@ -97,38 +97,45 @@ int cbor_deserialize_array_type(uint8_t *buf, const DataNode *data_node)
     return pos;
 }
 
-static int cbor_serialize_data_node(uint8_t *buf, size_t size, const DataNode *data_node)
+/*
+ * Serialize the value of a data node
+ *
+ * The value is read from data instead of data_node->data (except for arrays) so that
+ * double-buffered values can be read from the front buffer.
+ */
+static int cbor_serialize_data_node(uint8_t *buf, size_t size, const DataNode *data_node,
+    const void *data)
 {
     switch (data_node->type) {
 #ifdef TS_64BIT_TYPES_SUPPORT
     case TS_T_UINT64:
-        return cbor_serialize_uint(buf, *((uint64_t *)data_node->data), size);
+        return cbor_serialize_uint(buf, *((uint64_t *)data), size);
     case TS_T_INT64:
-        return cbor_serialize_int(buf, *((int64_t *)data_node->data), size);
+        return cbor_serialize_int(buf, *((int64_t *)data), size);
 #endif
     case TS_T_UINT32:
-        return cbor_serialize_uint(buf, *((uint32_t *)data_node->data), size);
+        return cbor_serialize_uint(buf, *((uint32_t *)data), size);
     case TS_T_INT32:
-        return cbor_serialize_int(buf, *((int32_t *)data_node->data), size);
+        return cbor_serialize_int(buf, *((int32_t *)data), size);
     case TS_T_UINT16:
-        return cbor_serialize_uint(buf, *((uint16_t *)data_node->data), size);
+        return cbor_serialize_uint(buf, *((uint16_t *)data), size);
     case TS_T_INT16:
-        return cbor_serialize_int(buf, *((int16_t *)data_node->data), size);
+        return cbor_serialize_int(buf, *((int16_t *)data), size);
     case TS_T_FLOAT32:
         if (data_node->detail == 0) { // round to 0 digits: use int
 #ifdef TS_64BIT_TYPES_SUPPORT
-            return cbor_serialize_int(buf, llroundf(*((float *)data_node->data)), size);
+            return cbor_serialize_int(buf, llroundf(*((float *)data)), size);
 #else
-            return cbor_serialize_int(buf, lroundf(*((float *)data_node->data)), size);
+            return cbor_serialize_int(buf, lroundf(*((float *)data)), size);
 #endif
         }
         else {
-            return cbor_serialize_float(buf, *((float *)data_node->data), size);
+            return cbor_serialize_float_fast(buf, *((float *)data), size);
         }
     case TS_T_BOOL:
-        return cbor_serialize_bool(buf, *((bool *)data_node->data), size);
+        return cbor_serialize_bool(buf, *((bool *)data), size);
     case TS_T_STRING:
-        return cbor_serialize_string(buf, (char *)data_node->data, size);
+        return cbor_serialize_string(buf, (char *)data, size);
     case TS_T_ARRAY:
         return cbor_serialize_array_type(buf, size, data_node);
     default:
@@ -148,54 +155,164 @@ int cbor_serialize_array_type(uint8_t *buf, size_t size, const DataNode *data_no
 
     // Add the length field to the beginning of the CBOR buffer and update the CBOR buffer index
     pos = cbor_serialize_array(buf, array_info->num_elements, size);
+    if (pos == 0) {
+        return 0;
+    }
 
     for (int i = 0; i < array_info->num_elements; i++) {
+        int num_bytes = 0;
         switch (array_info->type) {
 #ifdef TS_64BIT_TYPES_SUPPORT
         case TS_T_UINT64:
-            pos += cbor_serialize_uint(&(buf[pos]), ((uint64_t *)array_info->ptr)[i], size);
+            num_bytes = cbor_serialize_uint(&(buf[pos]), ((uint64_t *)array_info->ptr)[i],
+                size - pos);
             break;
         case TS_T_INT64:
-            pos += cbor_serialize_int(&(buf[pos]), ((int64_t *)array_info->ptr)[i], size);
+            num_bytes = cbor_serialize_int(&(buf[pos]), ((int64_t *)array_info->ptr)[i],
+                size - pos);
             break;
 #endif
         case TS_T_UINT32:
-            pos += cbor_serialize_uint(&(buf[pos]), ((uint32_t *)array_info->ptr)[i], size);
+            num_bytes = cbor_serialize_uint(&(buf[pos]), ((uint32_t *)array_info->ptr)[i],
+                size - pos);
             break;
         case TS_T_INT32:
-            pos += cbor_serialize_int(&(buf[pos]), ((int32_t *)array_info->ptr)[i], size);
+            num_bytes = cbor_serialize_int(&(buf[pos]), ((int32_t *)array_info->ptr)[i],
+                size - pos);
             break;
         case TS_T_UINT16:
-            pos += cbor_serialize_uint(&(buf[pos]), ((uint16_t *)array_info->ptr)[i], size);
+            num_bytes = cbor_serialize_uint(&(buf[pos]), ((uint16_t *)array_info->ptr)[i],
+                size - pos);
             break;
         case TS_T_INT16:
-            pos += cbor_serialize_int(&(buf[pos]), ((int16_t *)array_info->ptr)[i], size);
+            num_bytes = cbor_serialize_int(&(buf[pos]), ((int16_t *)array_info->ptr)[i],
+                size - pos);
             break;
         case TS_T_FLOAT32:
             if (data_node->detail == 0) { // round to 0 digits: use int
 #ifdef TS_64BIT_TYPES_SUPPORT
-                pos += cbor_serialize_int(&(buf[pos]),
-                    llroundf(((float *)array_info->ptr)[i]), size);
+                num_bytes = cbor_serialize_int(&(buf[pos]),
+                    llroundf(((float *)array_info->ptr)[i]), size - pos);
 #else
-                pos += cbor_serialize_int(&(buf[pos]),
-                    lroundf(((float *)array_info->ptr)[i]), size);
+                num_bytes = cbor_serialize_int(&(buf[pos]),
+                    lroundf(((float *)array_info->ptr)[i]), size - pos);
 #endif
             }
             else {
-                pos += cbor_serialize_float(&(buf[pos]), ((float *)array_info->ptr)[i], size);
+                num_bytes = cbor_serialize_float_fast(&(buf[pos]), ((float *)array_info->ptr)[i],
+                    size - pos);
             }
             break;
         default:
-            break;
+            continue;
         }
+        if (num_bytes == 0) {
+            return 0;   // buffer too small
+        }
+        pos += num_bytes;
     }
     return pos;
 }
 
-int ThingSet::bin_response(uint8_t code)
+/*
+ * Length of a node ID encoded as CBOR uint, determined from its first byte
+ */
+static inline size_t cbor_id_len(uint8_t first_byte)
+{
+    return (first_byte < CBOR_UINT8_FOLLOWS) ? 1 : (first_byte == CBOR_UINT8_FOLLOWS) ? 2 : 3;
+}
+
+int ts_encode_cbor_keys(ThingSetIndex *index, const DataNode *nodes, size_t num_nodes,
+    uint16_t *offsets, uint8_t *keys, size_t size)
 {
-    if (resp_size > 0) {
-        resp[0] = code;
+    size_t pos = 0;
+
+    for (size_t i = 0; i < num_nodes; i++) {
+        size_t id_len = (nodes[i].id < 24) ? 1 : (nodes[i].id <= 0xFF) ? 2 : 3;
+        size_t name_len = strlen(nodes[i].name);
+        // same header lengths as used by cbor_serialize_string
+        size_t header_len = (name_len < 24) ? 1 : (name_len < 0xFF) ? 2 : 3;
+
+        if (keys != NULL) {
+            if (pos + id_len + header_len + name_len > size) {
+                return -1;
+            }
+            offsets[i] = pos;
+            cbor_serialize_uint(&keys[pos], nodes[i].id, id_len);
+            uint8_t *name = &keys[pos + id_len];
+            if (header_len == 1) {
+                name[0] = CBOR_TEXT | (uint8_t)name_len;
+            }
+            else if (header_len == 2) {
+                name[0] = CBOR_TEXT | CBOR_UINT8_FOLLOWS;
+                name[1] = (uint8_t)name_len;
+            }
+            else {
+                name[0] = CBOR_TEXT | CBOR_UINT16_FOLLOWS;
+                name[1] = (uint8_t)(name_len >> 8);
+                name[2] = (uint8_t)name_len;
+            }
+            memcpy(&name[header_len], nodes[i].name, name_len);
+        }
+
+        pos += id_len + header_len + name_len;
+        if (pos > UINT16_MAX) {
+            return -1;      // offsets are limited to 16 bits
+        }
+    }
+
+    if (keys != NULL) {
+        offsets[num_nodes] = pos;
+        index->cbor_keys = keys;
+        index->cbor_key_offsets = offsets;
+    }
+    return pos;
+}
+
+int ThingSet::bin_serialize_id(uint8_t *buf, size_t size, unsigned int pos)
+{
+#if TS_NODE_INDEX
+    if (_index && _index->cbor_keys != NULL) {
+        const uint8_t *key = &_index->cbor_keys[_index->cbor_key_offsets[pos]];
+        size_t len = cbor_id_len(key[0]);
+        if (len > size) {
+            return 0;
+        }
+        // max. 3 bytes: copying them directly is faster than calling memcpy
+        buf[0] = key[0];
+        if (len > 1) {
+            buf[1] = key[1];
+            if (len > 2) {
+                buf[2] = key[2];
+            }
+        }
+        return len;
+    }
+#endif
+    return cbor_serialize_uint(buf, data_nodes[pos].id, size);
+}
+
+int ThingSet::bin_serialize_name(uint8_t *buf, size_t size, unsigned int pos)
+{
+#if TS_NODE_INDEX
+    if (_index && _index->cbor_keys != NULL) {
+        const uint8_t *key = &_index->cbor_keys[_index->cbor_key_offsets[pos]];
+        size_t id_len = cbor_id_len(key[0]);
+        size_t len = _index->cbor_key_offsets[pos + 1] - _index->cbor_key_offsets[pos] - id_len;
+        if (len > size) {
+            return 0;
+        }
+        memcpy(buf, key + id_len, len);
+        return len;
+    }
+#endif
+    return cbor_serialize_string(buf, data_nodes[pos].name, size);
+}
+
+int ThingSet::bin_response(ThingSetContext *ctx, uint8_t code)
+{
+    if (ctx->resp_size > 0) {
+        ctx->resp[0] = code;
         return 1;
     }
     else {
@@ -203,54 +320,56 @@ int ThingSet::bin_response(uint8_t code)
     }
 }
 
-int ThingSet::bin_process()
+int ThingSet::bin_process(ThingSetContext *ctx)
 {
     int pos = 1;    // current position during data processing
 
     // get endpoint (first parameter of the request)
     const DataNode *endpoint = NULL;
-    if ((req[pos] & CBOR_TYPE_MASK) == CBOR_TEXT) {
+    if ((ctx->req[pos] & CBOR_TYPE_MASK) == CBOR_TEXT) {
         uint16_t path_len;
-        pos += cbor_num_elements(&req[pos], &path_len);
-        endpoint = get_endpoint((char *)req + pos, path_len);
+        pos += cbor_num_elements(&ctx->req[pos], &path_len);
+        endpoint = get_endpoint((char *)ctx->req + pos, path_len);
     }
-    else if ((req[pos] & CBOR_TYPE_MASK) == CBOR_UINT) {
+    else if ((ctx->req[pos] & CBOR_TYPE_MASK) == CBOR_UINT) {
         node_id_t id = 0;
-        pos += cbor_deserialize_uint16(&req[pos], &id);
+        pos += cbor_deserialize_uint16_fast(&ctx->req[pos], &id);
         endpoint = get_node(id);
     }
-    else if (req[pos] == CBOR_UNDEFINED) {
+    else if (ctx->req[pos] == CBOR_UNDEFINED) {
         pos++;
     }
     else {
-        return bin_response(TS_STATUS_BAD_REQUEST);
+        return bin_response(ctx, TS_STATUS_BAD_REQUEST);
     }
 
+    ctx->step_node = endpoint;
+
     // process data
-    if (req[0] == TS_GET && endpoint) {
-        return bin_get(endpoint, req[pos] == 0xA0, req[pos] == 0xF7);
+    if (ctx->req[0] == TS_GET && endpoint) {
+        return bin_get(ctx, endpoint, ctx->req[pos] == 0xA0, ctx->req[pos] == 0xF7);
     }
-    else if (req[0] == TS_FETCH) {
-        return bin_fetch(endpoint, pos);
+    else if (ctx->req[0] == TS_FETCH) {
+        return bin_fetch(ctx, endpoint, pos);
     }
-    else if (req[0] == TS_PATCH && endpoint) {
-        int response = bin_patch(endpoint, pos, _auth_flags, 0);
-
-        // check if endpoint has a callback assigned
-        if (endpoint->data != NULL && resp[0] == TS_STATUS_CHANGED) {
-            // create function pointer and call function
-            void (*fun)(void) = reinterpret_cast<void(*)()>(endpoint->data);
-            fun();
+    else if (ctx->req[0] == TS_PATCH && endpoint) {
+        // the callback of the endpoint (if assigned) must not be lost after values changed
+        if (!reserve_callback(ctx, endpoint)) {
+            return bin_response(ctx, TS_STATUS_SERVICE_UNAVAILABLE);
         }
+        begin_update();
+        int response = bin_patch(ctx, endpoint, pos, ctx->auth_flags, 0);
+        end_update();
+        run_callback(ctx, endpoint, ctx->resp[0] == TS_STATUS_CHANGED);
         return response;
     }
-    else if (req[0] == TS_POST) {
-        return bin_exec(endpoint, pos);
+    else if (ctx->req[0] == TS_POST) {
+        return bin_exec(ctx, endpoint, pos);
     }
-    return bin_response(TS_STATUS_BAD_REQUEST);
+    return bin_response(ctx, TS_STATUS_BAD_REQUEST);
 }
 
-int ThingSet::bin_fetch(const DataNode *parent, unsigned int pos_payload)
+int ThingSet::bin_fetch(ThingSetContext *ctx, const DataNode *parent, unsigned int pos_payload)
 {
     /*
      * Remark: the parent node is currently still ignored. Any found data object is fetched.
@@ -260,43 +379,63 @@ int ThingSet::bin_fetch(const DataNode *parent, unsigned int pos_payload)
     unsigned int pos_resp = 0;
     uint16_t num_elements, element = 0;
 
-    pos_resp += bin_response(TS_STATUS_CONTENT);   // init response buffer
-
-    pos_req += cbor_num_elements(&req[pos_req], &num_elements);
-    if (num_elements != 1 && (req[pos_payload] & CBOR_TYPE_MASK) != CBOR_ARRAY) {
-        return bin_response(TS_STATUS_BAD_REQUEST);
+    if (ctx->step_handler != TS_STEP_NONE) {
+        // continue request from previous step
+        pos_req = ctx->step_index;
+        pos_resp = ctx->step_pos;
+        element = ctx->step_count;
+        num_elements = ctx->step_total;
     }
+    else {
+        pos_resp += bin_response(ctx, TS_STATUS_CONTENT);   // init response buffer
 
-    //printf("fetch request, elements: %d, hex data: %x %x %x %x %x %x %x %x\n", num_elements,
-    //    req[pos_req], req[pos_req+1], req[pos_req+2], req[pos_req+3],
-    //    req[pos_req+4], req[pos_req+5], req[pos_req+6], req[pos_req+7]);
+        pos_req += cbor_num_elements(&ctx->req[pos_req], &num_elements);
+        if (num_elements != 1 && (ctx->req[pos_payload] & CBOR_TYPE_MASK) != CBOR_ARRAY) {
+            return bin_response(ctx, TS_STATUS_BAD_REQUEST);
+        }
 
-    if (num_elements > 1) {
-        pos_resp += cbor_serialize_array(&resp[pos_resp], num_elements, resp_size - pos_resp);
+        //printf("fetch request, elements: %d, hex data: %x %x %x %x %x %x %x %x\n", num_elements,
+        //    req[pos_req], req[pos_req+1], req[pos_req+2], req[pos_req+3],
+        //    req[pos_req+4], req[pos_req+5], req[pos_req+6], req[pos_req+7]);
+
+        if (num_elements > 1) {
+            pos_resp += cbor_serialize_array(&ctx->resp[pos_resp], num_elements,
+                ctx->resp_size - pos_resp);
+        }
     }
 
-    while (pos_req + 1 < req_len && element < num_elements) {
+    while (pos_req + 1 < ctx->req_len && element < num_elements) {
+
+        if (step_yield(ctx)) {
+            ctx->step_handler = TS_STEP_BIN_FETCH;
+            ctx->step_index = pos_req;
+            ctx->step_pos = pos_resp;
+            ctx->step_count = element;
+            ctx->step_total = num_elements;
+            return TS_PROCESS_PENDING;
+        }
 
         size_t num_bytes = 0;       // temporary storage of cbor data length (req and resp)
 
         node_id_t id;
-        num_bytes = cbor_deserialize_uint16(&req[pos_req], &id);
+        num_bytes = cbor_deserialize_uint16_fast(&ctx->req[pos_req], &id);
         if (num_bytes == 0) {
-            return bin_response(TS_STATUS_BAD_REQUEST);
+            return bin_response(ctx, TS_STATUS_BAD_REQUEST);
         }
         pos_req += num_bytes;
 
         const DataNode* data_node = get_node(id);
         if (data_node == NULL) {
-            return bin_response(TS_STATUS_NOT_FOUND);
+            return bin_response(ctx, TS_STATUS_NOT_FOUND);
         }
         if (!(data_node->access & TS_READ_MASK)) {
-            return bin_response(TS_STATUS_UNAUTHORIZED);
+            return bin_response(ctx, TS_STATUS_UNAUTHORIZED);
         }
 
-        num_bytes = cbor_serialize_data_node(&resp[pos_resp], resp_size - pos_resp, data_node);
+        num_bytes = cbor_serialize_data_node(&ctx->resp[pos_resp], ctx->resp_size - pos_resp,
+            data_node, node_data(data_node, read_buf(ctx)));
         if (num_bytes == 0) {
-            return bin_response(TS_STATUS_RESPONSE_TOO_LARGE);
+            return bin_response(ctx, TS_STATUS_RESPONSE_TOO_LARGE);
         }
         pos_resp += num_bytes;
         element++;
@@ -306,44 +445,47 @@ int ThingSet::bin_fetch(const DataNode *parent, unsigned int pos_payload)
         return pos_resp;
     }
     else {
-        return bin_response(TS_STATUS_BAD_REQUEST);
+        return bin_response(ctx, TS_STATUS_BAD_REQUEST);
     }
 }
 
 int ThingSet::bin_sub(uint8_t *cbor_data, size_t len, uint16_t auth_flags, uint16_t sub_ch)
 {
     uint8_t resp_tmp[1] = {};   // only one character as response expected
-    req = cbor_data;
-    req_len = len;
-    resp = resp_tmp;
-    resp_size = sizeof(resp_tmp);
-    bin_patch(NULL, 1, auth_flags, sub_ch);
-    return resp[0];
+    ThingSetContext ctx;
+    ctx.req = cbor_data;
+    ctx.req_len = len;
+    ctx.resp = resp_tmp;
+    ctx.resp_size = sizeof(resp_tmp);
+    begin_update();
+    bin_patch(&ctx, NULL, 1, auth_flags, sub_ch);
+    end_update();
+    return resp_tmp[0];
 }
 
-int ThingSet::bin_patch(const DataNode *parent, unsigned int pos_payload, uint16_t auth_flags,
-    uint16_t sub_ch)
+int ThingSet::bin_patch(ThingSetContext *ctx, const DataNode *parent, unsigned int pos_payload,
+    uint16_t auth_flags, uint16_t sub_ch)
 {
     unsigned int pos_req = pos_payload;
     uint16_t num_elements, element = 0;
 
-    if ((req[pos_req] & CBOR_TYPE_MASK) != CBOR_MAP) {
-        return bin_response(TS_STATUS_BAD_REQUEST);
+    if ((ctx->req[pos_req] & CBOR_TYPE_MASK) != CBOR_MAP) {
+        return bin_response(ctx, TS_STATUS_BAD_REQUEST);
     }
-    pos_req += cbor_num_elements(&req[pos_req], &num_elements);
+    pos_req += cbor_num_elements(&ctx->req[pos_req], &num_elements);
 
     //printf("patch request, elements: %d, hex data: %x %x %x %x %x %x %x %x\n", num_elements,
     //    req[pos_req], req[pos_req+1], req[pos_req+2], req[pos_req+3],
     //    req[pos_req+4], req[pos_req+5], req[pos_req+6], req[pos_req+7]);
 
-    while (pos_req < req_len && element < num_elements) {
+    while (pos_req < ctx->req_len && element < num_elements) {
 
         size_t num_bytes = 0;       // temporary storage of cbor data length (req and resp)
 
         node_id_t id;
-        num_bytes = cbor_deserialize_uint16(&req[pos_req], &id);
+        num_bytes = cbor_deserialize_uint16_fast(&ctx->req[pos_req], &id);
         if (num_bytes == 0) {
-            return bin_response(TS_STATUS_BAD_REQUEST);
+            return bin_response(ctx, TS_STATUS_BAD_REQUEST);
         }
         pos_req += num_bytes;
 
@@ -351,37 +493,37 @@ int ThingSet::bin_patch(const DataNode *parent, unsigned int pos_payload, uint16
         if (node) {
             if ((node->access & TS_WRITE_MASK & auth_flags) == 0) {
                 if (node->access & TS_WRITE_MASK) {
-                    return bin_response(TS_STATUS_UNAUTHORIZED);
+                    return bin_response(ctx, TS_STATUS_UNAUTHORIZED);
                 }
                 else {
-                    return bin_response(TS_STATUS_FORBIDDEN);
+                    return bin_response(ctx, TS_STATUS_FORBIDDEN);
                 }
             }
             else if (parent && node->parent != parent->id) {
-                return bin_response(TS_STATUS_NOT_FOUND);
+                return bin_response(ctx, TS_STATUS_NOT_FOUND);
             }
             else if (sub_ch && !(node->pubsub & sub_ch)) {
                 // ignore element
-                num_bytes = cbor_size(&req[pos_req]);
+                num_bytes = cbor_size(&ctx->req[pos_req]);
             }
             else {
                 // actually deserialize the data and update node
-                num_bytes = cbor_deserialize_data_node(&req[pos_req], node);
+                num_bytes = cbor_deserialize_data_node(&ctx->req[pos_req], node);
             }
         }
         else {
             // node not found
             if (sub_ch) {
                 // ignore element
-                num_bytes = cbor_size(&req[pos_req]);
+                num_bytes = cbor_size(&ctx->req[pos_req]);
             }
             else {
-                return bin_response(TS_STATUS_NOT_FOUND);
+                return bin_response(ctx, TS_STATUS_NOT_FOUND);
             }
         }
 
         if (num_bytes == 0) {
-            return bin_response(TS_STATUS_BAD_REQUEST);
+            return bin_response(ctx, TS_STATUS_BAD_REQUEST);
         }
         pos_req += num_bytes;
 
@@ -389,85 +531,113 @@ int ThingSet::bin_patch(const DataNode *parent, unsigned int pos_payload, uint16
     }
 
     if (element == num_elements) {
-        return bin_response(TS_STATUS_CHANGED);
+        return bin_response(ctx, TS_STATUS_CHANGED);
     } else {
-        return bin_response(TS_STATUS_BAD_REQUEST);
+        return bin_response(ctx, TS_STATUS_BAD_REQUEST);
     }
 }
 
-int ThingSet::bin_exec(const DataNode *node, unsigned int pos_payload)
+int ThingSet::bin_exec(ThingSetContext *ctx, const DataNode *node, unsigned int pos_payload)
 {
     unsigned int pos_req = pos_payload;
     uint16_t num_elements, element = 0;
 
-    if ((req[pos_req] & CBOR_TYPE_MASK) != CBOR_ARRAY) {
-        return bin_response(TS_STATUS_BAD_REQUEST);
+    if ((ctx->req[pos_req] & CBOR_TYPE_MASK) != CBOR_ARRAY) {
+        return bin_response(ctx, TS_STATUS_BAD_REQUEST);
     }
-    pos_req += cbor_num_elements(&req[pos_req], &num_elements);
+    pos_req += cbor_num_elements(&ctx->req[pos_req], &num_elements);
 
     if ((node->access & TS_WRITE_MASK) && (node->type == TS_T_EXEC)) {
         // node is generally executable, but are we authorized?
-        if ((node->access & TS_WRITE_MASK & _auth_flags) == 0) {
-            return bin_response(TS_STATUS_UNAUTHORIZED);
+        if ((node->access & TS_WRITE_MASK & ctx->auth_flags) == 0) {
+            return bin_response(ctx, TS_STATUS_UNAUTHORIZED);
         }
     }
     else {
-        return bin_response(TS_STATUS_FORBIDDEN);
+        return bin_response(ctx, TS_STATUS_FORBIDDEN);
     }
 
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].parent == node->id) {
-            if (element >= num_elements) {
-                // more child nodes found than parameters were passed
-                return bin_response(TS_STATUS_BAD_REQUEST);
-            }
-            int num_bytes = cbor_deserialize_data_node(&req[pos_req], &data_nodes[i]);
-            if (num_bytes == 0) {
-                // deserializing the value was not successful
-                return bin_response(TS_STATUS_UNSUPPORTED_FORMAT);
-            }
-            pos_req += num_bytes;
-            element++;
+    // parameters are written to the child nodes, so the call must not fail afterwards
+    if (!reserve_callback(ctx, node)) {
+        return bin_response(ctx, TS_STATUS_SERVICE_UNAVAILABLE);
+    }
+
+    uint8_t status = TS_STATUS_VALID;
+    for (unsigned int i = next_child(node->id, 0); i < num_nodes;
+        i = next_child(node->id, i + 1))
+    {
+        if (element >= num_elements) {
+            // more child nodes found than parameters were passed
+            status = TS_STATUS_BAD_REQUEST;
+            break;
+        }
+        int num_bytes = cbor_deserialize_data_node(&ctx->req[pos_req], &data_nodes[i]);
+        if (num_bytes == 0) {
+            // deserializing the value was not successful
+            status = TS_STATUS_UNSUPPORTED_FORMAT;
+            break;
         }
+        pos_req += num_bytes;
+        element++;
     }
 
-    if (num_elements > element) {
+    if (status == TS_STATUS_VALID && num_elements > element) {
         // more parameters passed than child nodes found
-        return bin_response(TS_STATUS_BAD_REQUEST);
+        status = TS_STATUS_BAD_REQUEST;
     }
 
-    // if we got here, finally create function pointer and call function
-    void (*fun)(void) = reinterpret_cast<void(*)()>(node->data);
-    fun();
+    // if we got here without error, finally call the function
+    run_callback(ctx, node, status == TS_STATUS_VALID);
 
-    return bin_response(TS_STATUS_VALID);
+    return bin_response(ctx, status);
 }
 
 int ThingSet::bin_pub(uint8_t *buf, size_t buf_size, const uint16_t pub_ch)
+{
+#if TS_SEQLOCK || TS_DOUBLE_BUFFER
+    for (int i = 0; i < TS_SNAPSHOT_MAX_ATTEMPTS; i++) {
+        ReadState state;
+        read_begin(&state);
+        int len = bin_pub_nodes(buf, buf_size, pub_ch, state.front);
+        bool valid = read_validate(&state);
+        read_end(&state);
+        if (valid) {
+            return len;
+        }
+    }
+    return 0;
+#else
+    return bin_pub_nodes(buf, buf_size, pub_ch, NULL);
+#endif
+}
+
+int ThingSet::bin_pub_nodes(uint8_t *buf, size_t buf_size, const uint16_t pub_ch,
+    const uint8_t *front)
 {
     buf[0] = TS_PUBMSG;
     int len = 1;
 
     // find out number of elements to be published
     int num_ids = 0;
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].pubsub & pub_ch) {
-            num_ids++;
-        }
+    for (unsigned int i = next_pub_node(pub_ch, 0); i < num_nodes;
+        i = next_pub_node(pub_ch, i + 1))
+    {
+        num_ids++;
     }
 
     len += cbor_serialize_map(&buf[len], num_ids, buf_size - len);
 
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].pubsub & pub_ch) {
-            len += cbor_serialize_uint(&buf[len], data_nodes[i].id, buf_size - len);
-            size_t num_bytes = cbor_serialize_data_node(&buf[len], buf_size - len, &data_nodes[i]);
-            if (num_bytes == 0) {
-                return 0;
-            }
-            else {
-                len += num_bytes;
-            }
+    for (unsigned int i = next_pub_node(pub_ch, 0); i < num_nodes;
+        i = next_pub_node(pub_ch, i + 1))
+    {
+        len += bin_serialize_id(&buf[len], buf_size - len, i);
+        size_t num_bytes = cbor_serialize_data_node(&buf[len], buf_size - len, &data_nodes[i],
+            node_data(&data_nodes[i], front));
+        if (num_bytes == 0) {
+            return 0;
+        }
+        else {
+            len += num_bytes;
         }
     }
     return len;
@@ -479,22 +649,38 @@ int ThingSet::bin_pub_can(int &start_pos, uint16_t pub_ch, uint8_t can_dev_id,
     int msg_len = -1;
     const int msg_priority = 6;
 
-    for (unsigned int i = start_pos; i < num_nodes; i++) {
-        if (data_nodes[i].pubsub & pub_ch) {
-            msg_id = msg_priority << 26
-                | (1U << 24) | (1U << 25)   // identify as publication message
-                | data_nodes[i].id << 8
-                | can_dev_id;
-
-            msg_len = cbor_serialize_data_node(msg_data, 8, &data_nodes[i]);
-
-            if (msg_len > 0) {
-                // node found and successfully encoded, increase start pos for next run
-                start_pos = i + 1;
+    for (unsigned int i = next_pub_node(pub_ch, start_pos); i < num_nodes;
+        i = next_pub_node(pub_ch, i + 1))
+    {
+        msg_id = msg_priority << 26
+            | (1U << 24) | (1U << 25)   // identify as publication message
+            | data_nodes[i].id << 8
+            | can_dev_id;
+
+#if TS_SEQLOCK || TS_DOUBLE_BUFFER
+        for (int attempt = 0; attempt < TS_SNAPSHOT_MAX_ATTEMPTS; attempt++) {
+            ReadState state;
+            read_begin(&state);
+            msg_len = cbor_serialize_data_node(msg_data, 8, &data_nodes[i],
+                node_data(&data_nodes[i], state.front));
+            bool valid = read_validate(&state);
+            read_end(&state);
+            if (valid) {
                 break;
             }
-            // else: data too long, take next node
+            msg_len = 0;    // no consistent value: skip node
         }
+#else
+        msg_len = cbor_serialize_data_node(msg_data, 8, &data_nodes[i],
+            node_data(&data_nodes[i], NULL));
+#endif
+
+        if (msg_len > 0) {
+            // node found and successfully encoded, increase start pos for next run
+            start_pos = i + 1;
+            break;
+        }
+        // else: data too long, take next node
     }
 
     if (msg_len <= 0) {
@@ -537,47 +723,64 @@ int ThingSet::name_cbor(void)
 }
 */
 
-int ThingSet::bin_get(const DataNode *parent, bool values, bool ids_only)
+int ThingSet::bin_get(ThingSetContext *ctx, const DataNode *parent, bool values, bool ids_only)
 {
     unsigned int len = 0;       // current length of response
-    len += bin_response(TS_STATUS_CONTENT);   // init response buffer
+    unsigned int start = 0;
 
-    // find out number of elements
-    int num_elements = 0;
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].access & TS_READ_MASK
-            && (data_nodes[i].parent == parent->id))
+    if (ctx->step_handler != TS_STEP_NONE) {
+        // continue request from previous step
+        len = ctx->step_pos;
+        start = ctx->step_index;
+    }
+    else {
+        len += bin_response(ctx, TS_STATUS_CONTENT);   // init response buffer
+
+        // find out number of elements
+        int num_elements = 0;
+        for (unsigned int i = next_child(parent->id, 0); i < num_nodes;
+            i = next_child(parent->id, i + 1))
         {
-            num_elements++;
+            if (data_nodes[i].access & TS_READ_MASK) {
+                num_elements++;
+            }
         }
-    }
 
-    if (values && !ids_only) {
-        len += cbor_serialize_map(&resp[len], num_elements, resp_size - len);
-    }
-    else {
-        len += cbor_serialize_array(&resp[len], num_elements, resp_size - len);
+        if (values && !ids_only) {
+            len += cbor_serialize_map(&ctx->resp[len], num_elements, ctx->resp_size - len);
+        }
+        else {
+            len += cbor_serialize_array(&ctx->resp[len], num_elements, ctx->resp_size - len);
+        }
     }
 
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].access & TS_READ_MASK
-            && (data_nodes[i].parent == parent->id))
-        {
+    for (unsigned int i = next_child(parent->id, start); i < num_nodes;
+        i = next_child(parent->id, i + 1))
+    {
+        if (data_nodes[i].access & TS_READ_MASK) {
+            if (step_yield(ctx)) {
+                ctx->step_handler = ids_only ? TS_STEP_BIN_GET_IDS :
+                    (values ? TS_STEP_BIN_GET_VALUES : TS_STEP_BIN_GET_NAMES);
+                ctx->step_index = i;
+                ctx->step_pos = len;
+                return TS_PROCESS_PENDING;
+            }
+
             int num_bytes = 0;
             if (ids_only) {
-                num_bytes = cbor_serialize_uint(&resp[len], data_nodes[i].id, resp_size - len);
+                num_bytes = bin_serialize_id(&ctx->resp[len], ctx->resp_size - len, i);
             }
             else {
-                num_bytes = cbor_serialize_string(&resp[len], data_nodes[i].name,
-                    resp_size - len);
+                num_bytes = bin_serialize_name(&ctx->resp[len], ctx->resp_size - len, i);
                 if (values) {
-                    num_bytes += cbor_serialize_data_node(&resp[len + num_bytes],
-                        resp_size - len - num_bytes, &data_nodes[i]);
+                    num_bytes += cbor_serialize_data_node(&ctx->resp[len + num_bytes],
+                        ctx->resp_size - len - num_bytes, &data_nodes[i],
+                        node_data(&data_nodes[i], read_buf(ctx)));
                 }
             }
 
             if (num_bytes == 0) {
-                return bin_response(TS_STATUS_RESPONSE_TOO_LARGE);
+                return bin_response(ctx, TS_STATUS_RESPONSE_TOO_LARGE);
             } else {
                 len += num_bytes;
             }
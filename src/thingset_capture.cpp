@@ -0,0 +1,179 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifdef __linux__
+
+#include "thingset_capture.h"
+
+#include <string.h>
+
+/*
+ * Stores an integer of num_bytes in little-endian byte order
+ */
+static void _put_le(uint8_t *buf, uint64_t value, int num_bytes)
+{
+    for (int i = 0; i < num_bytes; i++) {
+        buf[i] = value >> (8 * i);
+    }
+}
+
+static uint64_t _get_le(const uint8_t *buf, int num_bytes)
+{
+    uint64_t value = 0;
+    for (int i = num_bytes - 1; i >= 0; i--) {
+        value = (value << 8) | buf[i];
+    }
+    return value;
+}
+
+ThingSetRecorder::ThingSetRecorder(ThingSet *ts) : ts(ts)
+{
+}
+
+ThingSetRecorder::~ThingSetRecorder()
+{
+    close();
+}
+
+int ThingSetRecorder::open(const char *path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (file != NULL) {
+        fclose(file);
+    }
+
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    uint8_t header[TS_CAPTURE_HEADER_SIZE] = {};
+    memcpy(header, TS_CAPTURE_MAGIC, 4);
+    header[4] = TS_CAPTURE_VERSION;
+    if (fwrite(header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        file = NULL;
+        return -1;
+    }
+
+    start = std::chrono::steady_clock::now();
+    num_records = 0;
+    return 0;
+}
+
+void ThingSetRecorder::close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (file != NULL) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+int ThingSetRecorder::process(uint8_t *req, size_t req_len, uint8_t *resp, size_t resp_size,
+    ThingSetContext *ctx, uint32_t conn_id)
+{
+    std::chrono::steady_clock::time_point t_start = std::chrono::steady_clock::now();
+
+    int resp_len = ts->process(req, req_len, resp, resp_size, ctx);
+
+    std::chrono::steady_clock::time_point t_end = std::chrono::steady_clock::now();
+
+    uint64_t latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        t_end - t_start).count();
+
+    write_record(std::chrono::duration_cast<std::chrono::nanoseconds>(t_start - start).count(),
+        (latency_ns > UINT32_MAX) ? UINT32_MAX : latency_ns, conn_id, req, req_len, resp,
+        resp_len);
+
+    return resp_len;
+}
+
+void ThingSetRecorder::write_record(uint64_t timestamp_ns, uint32_t latency_ns, uint32_t conn_id,
+    const uint8_t *req, size_t req_len, const uint8_t *resp, int resp_len)
+{
+    // frames longer than the 16-bit length fields are truncated
+    if (req_len > UINT16_MAX) {
+        req_len = UINT16_MAX;
+    }
+    if (resp_len < 0) {
+        resp_len = 0;
+    }
+    else if (resp_len > UINT16_MAX) {
+        resp_len = UINT16_MAX;
+    }
+
+    uint8_t head[TS_CAPTURE_RECORD_SIZE];
+    _put_le(&head[0], timestamp_ns, 8);
+    _put_le(&head[8], latency_ns, 4);
+    _put_le(&head[12], conn_id, 4);
+    _put_le(&head[16], req_len, 2);
+    _put_le(&head[18], resp_len, 2);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (file == NULL) {
+        return;
+    }
+
+    fwrite(head, sizeof(head), 1, file);
+    fwrite(req, 1, req_len, file);
+    fwrite(resp, 1, resp_len, file);
+    num_records++;
+}
+
+ThingSetCaptureReader::~ThingSetCaptureReader()
+{
+    close();
+}
+
+int ThingSetCaptureReader::open(const char *path)
+{
+    close();
+
+    file = fopen(path, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    uint8_t header[TS_CAPTURE_HEADER_SIZE];
+    if (fread(header, sizeof(header), 1, file) != 1 || memcmp(header, TS_CAPTURE_MAGIC, 4) != 0
+        || header[4] != TS_CAPTURE_VERSION)
+    {
+        close();
+        return -1;
+    }
+    return 0;
+}
+
+void ThingSetCaptureReader::close()
+{
+    if (file != NULL) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+bool ThingSetCaptureReader::read(CaptureRecord *rec)
+{
+    uint8_t head[TS_CAPTURE_RECORD_SIZE];
+    if (file == NULL || fread(head, sizeof(head), 1, file) != 1) {
+        return false;
+    }
+
+    rec->timestamp_ns = _get_le(&head[0], 8);
+    rec->latency_ns = _get_le(&head[8], 4);
+    rec->conn_id = _get_le(&head[12], 4);
+    rec->req.resize(_get_le(&head[16], 2));
+    rec->resp.resize(_get_le(&head[18], 2));
+
+    return fread(rec->req.data(), 1, rec->req.size(), file) == rec->req.size()
+        && fread(rec->resp.data(), 1, rec->resp.size(), file) == rec->resp.size();
+}
+
+#endif /* __linux__ */
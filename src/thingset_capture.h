@@ -0,0 +1,150 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifndef THINGSET_CAPTURE_H_
+#define THINGSET_CAPTURE_H_
+
+#ifdef __linux__
+
+#include "thingset.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+/*
+ * Capture file format (all integers little-endian):
+ *
+ * Header:  "TSCP" (4 bytes), version (1 byte), reserved (3 bytes)
+ * Records: timestamp in ns since start of capture (8 bytes), processing time in ns (4 bytes),
+ *          connection ID (4 bytes), request length (2 bytes), response length (2 bytes),
+ *          request, response
+ */
+#define TS_CAPTURE_MAGIC        "TSCP"
+#define TS_CAPTURE_VERSION      2
+#define TS_CAPTURE_HEADER_SIZE  8
+#define TS_CAPTURE_RECORD_SIZE  20
+
+/**
+ * Request and response frame stored in a capture file
+ */
+struct CaptureRecord {
+    uint64_t timestamp_ns;          ///< Start of processing relative to start of capture
+    uint32_t latency_ns;            ///< Processing time of the request
+    uint32_t conn_id;               ///< Connection (session) the request was received from
+    std::vector<uint8_t> req;
+    std::vector<uint8_t> resp;
+};
+
+/**
+ * Capture of request traffic to a file (Linux only)
+ *
+ * Requests are processed by the ThingSet object as usual. The request and response frames are
+ * written to the capture file together with the timestamp and the processing time.
+ *
+ * The recorder can be used from several threads at the same time.
+ */
+class ThingSetRecorder
+{
+public:
+    /**
+     * Initialize the recorder
+     *
+     * @param ts Pointer to ThingSet object processing the requests
+     */
+    ThingSetRecorder(ThingSet *ts);
+
+    ~ThingSetRecorder();
+
+    /**
+     * Create the capture file (an existing file is overwritten)
+     *
+     * Timestamps of the records are relative to the time when the file was opened.
+     *
+     * @returns 0 for success or -1 in case of error (errno is set)
+     */
+    int open(const char *path);
+
+    /**
+     * Flush and close the capture file
+     */
+    void close();
+
+    /**
+     * Process a request and record it
+     *
+     * Same parameters as ThingSet::process. Requests are only processed but not recorded if
+     * no capture file is open.
+     *
+     * @param conn_id ID of the connection (session) using ctx, so that the requests can be
+     *                replayed with one context per connection
+     *
+     * @returns Length of the response
+     */
+    int process(uint8_t *req, size_t req_len, uint8_t *resp, size_t resp_size,
+        ThingSetContext *ctx = NULL, uint32_t conn_id = 0);
+
+    /**
+     * Number of records written since the capture file was opened
+     */
+    uint32_t get_num_records()
+    {
+        return num_records;
+    }
+
+private:
+    void write_record(uint64_t timestamp_ns, uint32_t latency_ns, uint32_t conn_id,
+        const uint8_t *req, size_t req_len, const uint8_t *resp, int resp_len);
+
+    ThingSet *ts;
+
+    FILE *file = NULL;
+
+    std::mutex mutex;               ///< Protects file and num_records
+
+    std::chrono::steady_clock::time_point start;
+
+    uint32_t num_records = 0;
+};
+
+/**
+ * Reader for capture files created by ThingSetRecorder (Linux only)
+ */
+class ThingSetCaptureReader
+{
+public:
+    ~ThingSetCaptureReader();
+
+    /**
+     * Open a capture file and check the header
+     *
+     * @returns 0 for success or -1 if the file could not be opened or has an invalid format
+     */
+    int open(const char *path);
+
+    /**
+     * Close the capture file
+     */
+    void close();
+
+    /**
+     * Read the next record
+     *
+     * @returns True if a record was read, false at the end of the file or if the file is
+     *          truncated
+     */
+    bool read(CaptureRecord *rec);
+
+private:
+    FILE *file = NULL;
+};
+
+#endif /* __linux__ */
+
+#endif /* THINGSET_CAPTURE_H_ */
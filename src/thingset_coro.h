@@ -0,0 +1,123 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifndef THINGSET_CORO_H_
+#define THINGSET_CORO_H_
+
+/*
+ * C++20 coroutine wrapper around ThingSet::process_start / process_step (header only, ignored
+ * for older C++ standards)
+ */
+#if __cplusplus >= 202002L && defined(__has_include)
+#if __has_include(<coroutine>)
+
+#include "thingset.h"
+
+#include <coroutine>
+#include <exception>
+
+/**
+ * Coroutine processing a ThingSet request
+ *
+ * The coroutine is suspended initially and after each step. It is resumed by the scheduler
+ * (e.g. an event loop) until done() returns true.
+ */
+class ThingSetTask
+{
+public:
+    struct promise_type {
+        int resp_len = 0;
+
+        ThingSetTask get_return_object()
+        {
+            return ThingSetTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        void return_value(int len) { resp_len = len; }
+
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    ThingSetTask(ThingSetTask &&other) noexcept : handle(other.handle)
+    {
+        other.handle = nullptr;
+    }
+
+    ThingSetTask(const ThingSetTask &) = delete;
+
+    ~ThingSetTask()
+    {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    /**
+     * Process the next step of the request
+     */
+    void resume()
+    {
+        if (!handle.done()) {
+            handle.resume();
+        }
+    }
+
+    /**
+     * Check if the request is finished
+     */
+    bool done()
+    {
+        return handle.done();
+    }
+
+    /**
+     * Length of the response (only valid if done() returns true)
+     */
+    int result()
+    {
+        return handle.promise().resp_len;
+    }
+
+    /**
+     * Coroutine handle to be scheduled by custom executors
+     */
+    std::coroutine_handle<promise_type> get_handle()
+    {
+        return handle;
+    }
+
+private:
+    explicit ThingSetTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * Process a ThingSet request in a coroutine, suspending after every max_nodes nodes
+ *
+ * Parameters are the same as for ThingSet::process_start and ThingSet::process_step. All
+ * buffers, the context and the ThingSet object must stay valid until the task is finished.
+ */
+inline ThingSetTask thingset_process_async(ThingSet *ts, uint8_t *req, size_t req_len,
+    uint8_t *resp, size_t resp_size, ThingSetContext *ctx, int max_nodes)
+{
+    ts->process_start(req, req_len, resp, resp_size, ctx);
+
+    int len;
+    while ((len = ts->process_step(max_nodes, ctx)) == TS_PROCESS_PENDING) {
+        co_await std::suspend_always{};
+    }
+    co_return len;
+}
+
+#endif /* __has_include(<coroutine>) */
+#endif /* __cplusplus >= 202002L */
+
+#endif /* THINGSET_CORO_H_ */
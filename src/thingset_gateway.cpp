@@ -0,0 +1,172 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifdef __linux__
+
+#include "thingset_gateway.h"
+
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+ThingSetGateway::ThingSetGateway(int num_shards)
+{
+    if (num_shards <= 0) {
+        num_shards = std::thread::hardware_concurrency();
+    }
+    this->num_shards = (num_shards > 0) ? num_shards : 1;
+    shards = new Shard[this->num_shards];
+
+    for (int i = 0; i < 256; i++) {
+        routes[i].ts = NULL;
+        routes[i].shard = NULL;
+    }
+}
+
+ThingSetGateway::~ThingSetGateway()
+{
+    stop();
+    delete[] shards;
+}
+
+int ThingSetGateway::add_device(uint8_t dev_id, ThingSet *ts)
+{
+    if (routes[dev_id].ts != NULL || running) {
+        return -1;
+    }
+
+    int shard_index = num_devices++ % num_shards;
+    routes[dev_id].ts = ts;
+    routes[dev_id].shard = &shards[shard_index];
+    return shard_index;
+}
+
+void ThingSetGateway::start()
+{
+    if (running) {
+        return;
+    }
+
+    int num_cpus = std::thread::hardware_concurrency();
+    for (int i = 0; i < num_shards; i++) {
+        {
+            std::lock_guard<std::mutex> lock(shards[i].mutex);
+            shards[i].stopping = false;
+        }
+        shards[i].thread = std::thread(&ThingSetGateway::worker, this, &shards[i],
+            (num_cpus > 0) ? i % num_cpus : -1);
+    }
+    running = true;
+}
+
+void ThingSetGateway::stop()
+{
+    if (!running) {
+        return;
+    }
+
+    for (int i = 0; i < num_shards; i++) {
+        {
+            std::lock_guard<std::mutex> lock(shards[i].mutex);
+            shards[i].stopping = true;
+        }
+        shards[i].cv.notify_one();
+    }
+    for (int i = 0; i < num_shards; i++) {
+        shards[i].thread.join();
+    }
+    running = false;
+}
+
+bool ThingSetGateway::submit(uint8_t dev_id, const uint8_t *req, size_t req_len,
+    ResponseHandler handler)
+{
+    Route *route = &routes[dev_id];
+    if (route->ts == NULL) {
+        return false;
+    }
+
+    Job job;
+    job.ts = route->ts;
+    job.req.assign(req, req + req_len);
+    job.handler = handler;
+
+    {
+        std::lock_guard<std::mutex> lock(route->shard->mutex);
+        if (route->shard->stopping) {
+            // no worker thread running (anymore) that would process the request
+            return false;
+        }
+        route->shard->jobs.push_back(std::move(job));
+    }
+    route->shard->cv.notify_one();
+    return true;
+}
+
+int ThingSetGateway::process(uint8_t dev_id, const uint8_t *req, size_t req_len, uint8_t *resp,
+    size_t resp_size)
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    int len = 0;
+
+    bool queued = submit(dev_id, req, req_len,
+        [&](const uint8_t *shard_resp, int shard_resp_len) {
+            len = ((size_t)shard_resp_len > resp_size) ? resp_size : shard_resp_len;
+            memcpy(resp, shard_resp, len);
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            cv.notify_one();
+        });
+    if (!queued) {
+        return -1;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]{ return done; });
+    return len;
+}
+
+void ThingSetGateway::worker(Shard *shard, int cpu)
+{
+    if (cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+        // pinning is only an optimization, so errors are ignored
+        pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+    }
+
+    uint8_t resp[TS_GATEWAY_RESP_SIZE];
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(shard->mutex);
+            shard->cv.wait(lock, [shard]{ return shard->stopping || !shard->jobs.empty(); });
+            if (shard->jobs.empty()) {
+                return;     // stopping and all requests processed
+            }
+            job = std::move(shard->jobs.front());
+            shard->jobs.pop_front();
+        }
+
+        // ThingSet objects are only accessed by the thread of their shard
+        int resp_len = job.ts->process(job.req.data(), job.req.size(), resp, sizeof(resp));
+
+        if (job.handler) {
+            job.handler(resp, resp_len);
+        }
+
+#if TS_DEFERRED_CALLBACKS
+        // functions of exec nodes and paths are called after the response was passed on
+        job.ts->run_deferred_callbacks();
+#endif
+    }
+}
+
+#endif /* __linux__ */
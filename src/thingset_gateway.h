@@ -0,0 +1,181 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifndef THINGSET_GATEWAY_H_
+#define THINGSET_GATEWAY_H_
+
+#ifdef __linux__
+
+#include "thingset.h"
+
+#include <stdint.h>
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+/*
+ * Size of the response buffer of each shard
+ */
+#ifndef TS_GATEWAY_RESP_SIZE
+#define TS_GATEWAY_RESP_SIZE 1024
+#endif
+
+/**
+ * Gateway routing requests to many ThingSet instances (Linux only)
+ *
+ * Each device is identified by an 8-bit device ID (same as can_dev_id used for CAN
+ * publication messages) and has its own ThingSet object with its own data nodes.
+ *
+ * The devices are distributed over shards. Each shard has a worker thread pinned to a CPU core
+ * and its own request queue. All requests of a device are processed by the same thread, so the
+ * ThingSet objects don't need any locking and requests for devices in different shards run in
+ * parallel without sharing any locks.
+ */
+class ThingSetGateway
+{
+public:
+    /**
+     * Function called with the response of a request
+     *
+     * The response buffer is only valid during the call.
+     */
+    typedef std::function<void(const uint8_t *resp, int resp_len)> ResponseHandler;
+
+    /**
+     * Initialize the gateway
+     *
+     * @param num_shards Number of shards (worker threads), 0 for one shard per CPU core
+     */
+    ThingSetGateway(int num_shards = 0);
+
+    ~ThingSetGateway();
+
+    /**
+     * Add a device to the routing table
+     *
+     * Devices must be added before start() is called. They are assigned to the shards in a
+     * round-robin fashion.
+     *
+     * @param dev_id Device ID used to route requests
+     * @param ts Pointer to ThingSet object of the device (must stay valid while the gateway
+     *           is running)
+     *
+     * @returns Index of the shard processing the requests or -1 if the ID is already used
+     */
+    int add_device(uint8_t dev_id, ThingSet *ts);
+
+    /**
+     * Get ThingSet object of a device
+     *
+     * @returns Pointer to ThingSet object or NULL if the device was not found
+     */
+    ThingSet *get_device(uint8_t dev_id)
+    {
+        return routes[dev_id].ts;
+    }
+
+    /**
+     * Start the worker threads of all shards
+     */
+    void start();
+
+    /**
+     * Process remaining requests and stop the worker threads
+     *
+     * Requests submitted after this call are rejected.
+     */
+    void stop();
+
+    /**
+     * Queue a request for a device
+     *
+     * The response handler is called from the worker thread of the shard.
+     *
+     * @param dev_id Device ID
+     * @param req Pointer to the request (copied internally)
+     * @param req_len Length of the request
+     * @param handler Function to be called with the response
+     *
+     * @returns True if the request was queued, false if the device was not found or the
+     *          gateway is not running
+     */
+    bool submit(uint8_t dev_id, const uint8_t *req, size_t req_len, ResponseHandler handler);
+
+    /**
+     * Process a request for a device and wait for the response
+     *
+     * @param dev_id Device ID
+     * @param req Pointer to the request
+     * @param req_len Length of the request
+     * @param resp Pointer to the buffer where the response should be stored
+     * @param resp_size Size of the response buffer
+     *
+     * @returns Length of the response (truncated to resp_size) or -1 if the device was not found
+     *          or the gateway is not running
+     */
+    int process(uint8_t dev_id, const uint8_t *req, size_t req_len, uint8_t *resp,
+        size_t resp_size);
+
+    /**
+     * Get number of shards
+     */
+    int get_num_shards()
+    {
+        return num_shards;
+    }
+
+private:
+    /**
+     * Request waiting for processing
+     */
+    struct Job {
+        ThingSet *ts;
+        std::vector<uint8_t> req;
+        ResponseHandler handler;
+    };
+
+    /**
+     * Worker thread with its own queue
+     */
+    struct Shard {
+        std::thread thread;
+        std::deque<Job> jobs;
+        std::mutex mutex;               ///< Only protects jobs and stopping of this shard
+        std::condition_variable cv;
+        bool stopping = true;           ///< Set while no worker thread accepts requests
+    };
+
+    /**
+     * Entry of the routing table
+     */
+    struct Route {
+        ThingSet *ts;
+        Shard *shard;
+    };
+
+    void worker(Shard *shard, int cpu);
+
+    int num_shards;
+
+    int num_devices = 0;
+
+    bool running = false;
+
+    /**
+     * Routing table indexed by device ID (not modified while running, so it needs no lock)
+     */
+    Route routes[256];
+
+    Shard *shards;
+};
+
+#endif /* __linux__ */
+
+#endif /* THINGSET_GATEWAY_H_ */
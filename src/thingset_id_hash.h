@@ -0,0 +1,361 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifndef THINGSET_ID_HASH_H_
+#define THINGSET_ID_HASH_H_
+
+/**
+ * @file
+ *
+ * Minimal perfect hash of the node IDs built at compile time
+ *
+ * For fixed node tables, the lookup structures of ThingSet::get_node(id) can be computed by the
+ * compiler from a constexpr array of the node IDs (in the same order as the data nodes array),
+ * so they are stored in flash and nothing has to be searched or sorted at startup:
+ *
+ *     static constexpr node_id_t node_ids[] = { 0x18, 0x19, 0x1A, ... };
+ *
+ *     static constexpr auto id_hash = ts_make_id_hash(node_ids);
+ *     static constexpr ThingSetIndex id_index = ts_id_index(id_hash);
+ *
+ *     ts.set_index(&id_index);     // requires TS_NODE_INDEX = 1
+ *
+ * The tables are the same as the ID tables generated by tools/ts_codegen.py. Only C++11
+ * constexpr functions are used, so all loops are written as recursions, which split the ranges
+ * in halves to keep the recursion depth low. The IDs are grouped by bucket with a merge sort, so
+ * the compile time grows only slightly faster than the number of nodes (about one second for
+ * 1000 nodes with GCC). Above approx. 2000 nodes, the GCC option -fconstexpr-ops-limit has to be
+ * increased or the code generator should be used instead.
+ *
+ * If no hash is found (usually caused by duplicate IDs), compilation fails with an error
+ * mentioning ts_id_hash_failed_check_for_duplicate_ids.
+ */
+
+#include "thingset.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Maximum number of IDs mapped to the same bucket (the used slots of a bucket are stored as
+ * bits of an uint64_t during the search of the seed)
+ */
+#define TS_ID_HASH_MAX_BUCKET_SIZE  32
+
+/**
+ * Tables of the minimal perfect hash of N node IDs (see ThingSetIndex for the layout)
+ */
+template<size_t N>
+struct ThingSetIdHash {
+    static constexpr size_t num_buckets = (N + 1) / 2;
+
+    uint16_t seeds[num_buckets];        ///< Seed of the second-level hash for each bucket
+    uint16_t offsets[num_buckets + 1];  ///< First slot of each bucket
+    uint16_t slots[N];                  ///< Node positions ordered by ID hash
+};
+
+template<size_t N>
+constexpr size_t ThingSetIdHash<N>::num_buckets;
+
+/*
+ * Compile-time sequence of indices 0...N-1 (std::index_sequence is only available in C++14)
+ */
+template<size_t... Is>
+struct ts_index_seq {};
+
+template<typename A, typename B>
+struct _ts_concat_seq;
+
+template<size_t... As, size_t... Bs>
+struct _ts_concat_seq<ts_index_seq<As...>, ts_index_seq<Bs...>> {
+    typedef ts_index_seq<As..., (sizeof...(As) + Bs)...> type;
+};
+
+template<size_t N>
+struct ts_make_index_seq {
+    typedef typename _ts_concat_seq<typename ts_make_index_seq<N / 2>::type,
+        typename ts_make_index_seq<N - N / 2>::type>::type type;
+};
+
+template<>
+struct ts_make_index_seq<0> {
+    typedef ts_index_seq<> type;
+};
+
+template<>
+struct ts_make_index_seq<1> {
+    typedef ts_index_seq<0> type;
+};
+
+/*
+ * Not constexpr: Calling it during compile-time evaluation stops the compilation.
+ */
+uint16_t ts_id_hash_failed_check_for_duplicate_ids();
+
+static constexpr uint64_t _TS_ID_HASH_COLLISION = UINT64_MAX;
+static constexpr uint32_t _TS_ID_HASH_NO_SEED = 0x10000;
+
+/*
+ * Sort key of an ID: bucket in the upper and position in the data nodes array in the lower
+ * 16 bits, so that the sorted keys are grouped by bucket
+ */
+static constexpr uint32_t _ts_id_key(node_id_t id, size_t pos, size_t num_buckets)
+{
+    return ts_id_hash_range(ts_id_hash(id, 0), (uint32_t)num_buckets) << 16 | (uint32_t)pos;
+}
+
+template<size_t N>
+struct _TsIdKeys {
+    uint32_t keys[N];
+};
+
+/*
+ * Smallest number i of elements taken from a (in lo...hi) so that the first k elements of the
+ * merged arrays consist of a[0...i-1] and b[0...k-i-1]
+ */
+static constexpr size_t _ts_id_merge_split(const uint32_t *a, size_t na, const uint32_t *b,
+    size_t k, size_t lo, size_t hi)
+{
+    return (lo == hi) ? lo :
+        (lo + (hi - lo) / 2 == na || k - (lo + (hi - lo) / 2) == 0 ||
+            b[k - (lo + (hi - lo) / 2) - 1] < a[lo + (hi - lo) / 2]) ?
+        _ts_id_merge_split(a, na, b, k, lo, lo + (hi - lo) / 2) :
+        _ts_id_merge_split(a, na, b, k, lo + (hi - lo) / 2 + 1, hi);
+}
+
+static constexpr uint32_t _ts_id_merged_at(const uint32_t *a, size_t na, const uint32_t *b,
+    size_t nb, size_t i, size_t k)
+{
+    return (i < na && (k - i >= nb || a[i] < b[k - i])) ? a[i] : b[k - i];
+}
+
+/*
+ * Element k of the merged sorted arrays a and b
+ */
+static constexpr uint32_t _ts_id_merge_at(const uint32_t *a, size_t na, const uint32_t *b,
+    size_t nb, size_t k)
+{
+    return _ts_id_merged_at(a, na, b, nb, _ts_id_merge_split(a, na, b, k,
+        (k > nb) ? k - nb : 0, (k < na) ? k : na), k);
+}
+
+template<size_t NA, size_t NB, size_t... Ks>
+constexpr _TsIdKeys<NA + NB> _ts_id_merge(const _TsIdKeys<NA> &a, const _TsIdKeys<NB> &b,
+    ts_index_seq<Ks...>)
+{
+    return _TsIdKeys<NA + NB>{ { _ts_id_merge_at(a.keys, NA, b.keys, NB, Ks)... } };
+}
+
+/*
+ * Merge sort of the keys of the IDs at positions first...first+N-1
+ */
+template<size_t N>
+struct _TsIdSort {
+    static constexpr _TsIdKeys<N> sort(const node_id_t *ids, size_t first, size_t num_buckets)
+    {
+        return _ts_id_merge(_TsIdSort<N / 2>::sort(ids, first, num_buckets),
+            _TsIdSort<N - N / 2>::sort(ids, first + N / 2, num_buckets),
+            typename ts_make_index_seq<N>::type());
+    }
+};
+
+template<>
+struct _TsIdSort<1> {
+    static constexpr _TsIdKeys<1> sort(const node_id_t *ids, size_t first, size_t num_buckets)
+    {
+        return _TsIdKeys<1>{ { _ts_id_key(ids[first], first, num_buckets) } };
+    }
+};
+
+/*
+ * Number of sorted keys in lo...hi-1 belonging to buckets before the given bucket
+ */
+static constexpr size_t _ts_id_lower_bound(const uint32_t *keys, size_t lo, size_t hi,
+    size_t bucket)
+{
+    return (lo == hi) ? lo :
+        ((keys[lo + (hi - lo) / 2] >> 16) < bucket) ?
+        _ts_id_lower_bound(keys, lo + (hi - lo) / 2 + 1, hi, bucket) :
+        _ts_id_lower_bound(keys, lo, lo + (hi - lo) / 2, bucket);
+}
+
+static constexpr uint64_t _ts_id_merge_slots(uint64_t a, uint64_t b)
+{
+    return (a == _TS_ID_HASH_COLLISION || b == _TS_ID_HASH_COLLISION || (a & b) != 0) ?
+        _TS_ID_HASH_COLLISION : (a | b);
+}
+
+/*
+ * Slots used by the IDs of the sorted keys first...last-1 as bitmask or _TS_ID_HASH_COLLISION
+ * if two IDs are mapped to the same slot
+ */
+static constexpr uint64_t _ts_id_used_slots(const node_id_t *ids, const uint32_t *keys,
+    size_t first, size_t last, size_t num_slots, uint32_t seed)
+{
+    return (last - first == 1) ?
+        (uint64_t)1 << ts_id_hash_range(ts_id_hash(ids[keys[first] & 0xFFFF], seed),
+            (uint32_t)num_slots) :
+        _ts_id_merge_slots(
+            _ts_id_used_slots(ids, keys, first, first + (last - first) / 2, num_slots, seed),
+            _ts_id_used_slots(ids, keys, first + (last - first) / 2, last, num_slots, seed));
+}
+
+static constexpr uint32_t _ts_id_find_seed(const node_id_t *ids, const uint32_t *keys,
+    size_t first, size_t last, uint32_t seed_lo, uint32_t seed_hi);
+
+static constexpr uint32_t _ts_id_first_seed(uint32_t seed, const node_id_t *ids,
+    const uint32_t *keys, size_t first, size_t last, uint32_t seed_lo, uint32_t seed_hi)
+{
+    return (seed != _TS_ID_HASH_NO_SEED) ? seed :
+        _ts_id_find_seed(ids, keys, first, last, seed_lo, seed_hi);
+}
+
+/*
+ * Smallest seed in seed_lo...seed_hi-1 without collisions in the bucket with the sorted keys
+ * first...last-1
+ */
+static constexpr uint32_t _ts_id_find_seed(const node_id_t *ids, const uint32_t *keys,
+    size_t first, size_t last, uint32_t seed_lo, uint32_t seed_hi)
+{
+    return (seed_hi - seed_lo == 1) ?
+        ((_ts_id_used_slots(ids, keys, first, last, last - first, seed_lo) !=
+            _TS_ID_HASH_COLLISION) ? seed_lo : _TS_ID_HASH_NO_SEED) :
+        _ts_id_first_seed(
+            _ts_id_find_seed(ids, keys, first, last, seed_lo, seed_lo + (seed_hi - seed_lo) / 2),
+            ids, keys, first, last, seed_lo + (seed_hi - seed_lo) / 2, seed_hi);
+}
+
+static constexpr uint16_t _ts_id_check_seed(uint32_t seed)
+{
+    return (seed != _TS_ID_HASH_NO_SEED) ? (uint16_t)seed :
+        ts_id_hash_failed_check_for_duplicate_ids();
+}
+
+static constexpr uint16_t _ts_id_bucket_seed(const node_id_t *ids, const uint32_t *keys,
+    size_t first, size_t last)
+{
+    return (last - first <= 1) ? 0 :
+        (last - first > TS_ID_HASH_MAX_BUCKET_SIZE) ? ts_id_hash_failed_check_for_duplicate_ids() :
+        _ts_id_check_seed(_ts_id_find_seed(ids, keys, first, last, 1, _TS_ID_HASH_NO_SEED));
+}
+
+/*
+ * Seeds and offsets of the buckets (first step, so that the seeds are searched only once)
+ */
+template<size_t N>
+struct _TsIdHashBuckets {
+    uint16_t seeds[ThingSetIdHash<N>::num_buckets];
+    uint16_t offsets[ThingSetIdHash<N>::num_buckets + 1];
+};
+
+template<size_t N, size_t... Bs, size_t... Os>
+constexpr _TsIdHashBuckets<N> _ts_id_hash_buckets(const node_id_t *ids,
+    const _TsIdKeys<N> &sorted, ts_index_seq<Bs...>, ts_index_seq<Os...>)
+{
+    return _TsIdHashBuckets<N>{
+        { _ts_id_bucket_seed(ids, sorted.keys, _ts_id_lower_bound(sorted.keys, 0, N, Bs),
+            _ts_id_lower_bound(sorted.keys, 0, N, Bs + 1))... },
+        { (uint16_t)_ts_id_lower_bound(sorted.keys, 0, N, Os)... }
+    };
+}
+
+/*
+ * Bucket owning a slot: the last bucket in lo...hi-1 with offsets[bucket] <= slot
+ */
+static constexpr size_t _ts_id_slot_bucket(const uint16_t *offsets, size_t lo, size_t hi,
+    size_t slot)
+{
+    return (hi - lo == 1) ? lo :
+        (offsets[lo + (hi - lo) / 2] <= slot) ?
+        _ts_id_slot_bucket(offsets, lo + (hi - lo) / 2, hi, slot) :
+        _ts_id_slot_bucket(offsets, lo, lo + (hi - lo) / 2, slot);
+}
+
+static constexpr uint16_t _ts_id_min(uint16_t a, uint16_t b)
+{
+    return (a < b) ? a : b;
+}
+
+/*
+ * Position of the ID with the sorted keys first...last-1 of a bucket that is mapped to the
+ * given slot of the bucket
+ */
+static constexpr uint16_t _ts_id_slot_pos(const node_id_t *ids, const uint32_t *keys,
+    size_t first, size_t last, size_t num_slots, uint16_t seed, size_t slot)
+{
+    return (last - first == 1) ?
+        ((ts_id_hash_range(ts_id_hash(ids[keys[first] & 0xFFFF], seed), (uint32_t)num_slots) ==
+            slot) ?
+            (uint16_t)(keys[first] & 0xFFFF) : TS_INDEX_EMPTY) :
+        _ts_id_min(
+            _ts_id_slot_pos(ids, keys, first, first + (last - first) / 2, num_slots, seed, slot),
+            _ts_id_slot_pos(ids, keys, first + (last - first) / 2, last, num_slots, seed, slot));
+}
+
+static constexpr uint16_t _ts_id_bucket_slot_pos(const node_id_t *ids, const uint32_t *keys,
+    const uint16_t *seeds, const uint16_t *offsets, size_t bucket, size_t slot)
+{
+    return _ts_id_slot_pos(ids, keys, offsets[bucket], offsets[bucket + 1],
+        offsets[bucket + 1] - offsets[bucket], seeds[bucket], slot - offsets[bucket]);
+}
+
+template<size_t N, size_t... Bs, size_t... Os, size_t... Ss>
+constexpr ThingSetIdHash<N> _ts_id_hash_tables(const node_id_t *ids, const _TsIdKeys<N> &sorted,
+    const _TsIdHashBuckets<N> &buckets, ts_index_seq<Bs...>, ts_index_seq<Os...>,
+    ts_index_seq<Ss...>)
+{
+    return ThingSetIdHash<N>{
+        { buckets.seeds[Bs]... },
+        { buckets.offsets[Os]... },
+        { _ts_id_bucket_slot_pos(ids, sorted.keys, buckets.seeds, buckets.offsets,
+            _ts_id_slot_bucket(buckets.offsets, 0, ThingSetIdHash<N>::num_buckets, Ss), Ss)... }
+    };
+}
+
+template<size_t N>
+constexpr ThingSetIdHash<N> _ts_id_hash_sorted(const node_id_t *ids, const _TsIdKeys<N> &sorted)
+{
+    return _ts_id_hash_tables<N>(ids, sorted,
+        _ts_id_hash_buckets<N>(ids, sorted,
+            typename ts_make_index_seq<ThingSetIdHash<N>::num_buckets>::type(),
+            typename ts_make_index_seq<ThingSetIdHash<N>::num_buckets + 1>::type()),
+        typename ts_make_index_seq<ThingSetIdHash<N>::num_buckets>::type(),
+        typename ts_make_index_seq<ThingSetIdHash<N>::num_buckets + 1>::type(),
+        typename ts_make_index_seq<N>::type());
+}
+
+/**
+ * Build the minimal perfect hash of node IDs at compile time
+ *
+ * @param ids Constexpr array with the IDs of all nodes in the order of the data nodes array
+ *
+ * @returns Tables of the hash, which should be stored in a constexpr variable
+ */
+template<size_t N>
+constexpr ThingSetIdHash<N> ts_make_id_hash(const node_id_t (&ids)[N])
+{
+    static_assert(N > 0 && N < TS_INDEX_EMPTY, "Invalid number of node IDs");
+    return _ts_id_hash_sorted<N>(ids,
+        _TsIdSort<N>::sort(ids, 0, ThingSetIdHash<N>::num_buckets));
+}
+
+/**
+ * Index with only the ID hash (names, child nodes and publication channels are searched in the
+ * data nodes array)
+ *
+ * To use pre-encoded CBOR keys, the index has to be copied to RAM and extended with
+ * ts_encode_cbor_keys.
+ *
+ * @param hash Tables built by ts_make_id_hash, stored in a constexpr variable
+ */
+template<size_t N>
+constexpr ThingSetIndex ts_id_index(const ThingSetIdHash<N> &hash)
+{
+    return ThingSetIndex{ N, ThingSetIdHash<N>::num_buckets, hash.seeds, hash.offsets,
+        hash.slots, 0, NULL, NULL, NULL, 0, NULL, NULL, NULL, NULL, NULL };
+}
+
+#endif /* THINGSET_ID_HASH_H_ */
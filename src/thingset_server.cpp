@@ -0,0 +1,568 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifdef __linux__
+
+#include "thingset_server.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+
+/*
+ * Maximum length of binary mode requests, so that the first byte of the length prefix can't be
+ * confused with whitespace (e.g. blank lines) between text mode requests
+ */
+#define BIN_MAX_REQ_SIZE    0x08FF
+
+/*
+ * Number of whitespace bytes (e.g. blank lines) before the first request in the data
+ */
+static size_t _skip_whitespace(const uint8_t *data, size_t size)
+{
+    size_t pos = 0;
+    while (pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' ||
+        data[pos] == '\n'))
+    {
+        pos++;
+    }
+    return pos;
+}
+
+/*
+ * Checks if the data contains a complete request frame
+ *
+ * Leading whitespace is skipped. Returns the number of bytes of the frame including framing
+ * overhead, 0 if the frame is not yet complete or -1 if the data is invalid. Position and length
+ * of the request inside the frame are stored in start and len.
+ */
+static int _next_frame(const uint8_t *data, size_t size, size_t *start, size_t *len)
+{
+    size_t pos = _skip_whitespace(data, size);
+    if (pos == size) {
+        return (size > TS_SERVER_MAX_REQ_SIZE) ? -1 : 0;
+    }
+
+    if (data[pos] >= 0x20) {
+        // text mode: request terminated by newline
+        const uint8_t *end = (const uint8_t *)memchr(&data[pos], '\n', size - pos);
+        if (end == NULL) {
+            return (size > TS_SERVER_MAX_REQ_SIZE) ? -1 : 0;
+        }
+        *start = pos;
+        *len = end - &data[pos];
+        if (data[pos + *len - 1] == '\r') {
+            (*len)--;
+        }
+        return end - data + 1;
+    }
+    else {
+        // binary mode: request prefixed with 16-bit length
+        if (size < pos + 2) {
+            return 0;
+        }
+        size_t req_len = ((size_t)data[pos] << 8) | data[pos + 1];
+        if (req_len == 0 || req_len > TS_SERVER_MAX_REQ_SIZE || req_len > BIN_MAX_REQ_SIZE) {
+            return -1;
+        }
+        if (size < pos + req_len + 2) {
+            return 0;
+        }
+        *start = pos + 2;
+        *len = req_len;
+        return pos + req_len + 2;
+    }
+}
+
+/*
+ * Checks if a request only reads data (text or binary mode)
+ */
+static bool _is_read_only(const uint8_t *req)
+{
+    return req[0] == '?' || req[0] == TS_GET || req[0] == TS_FETCH;
+}
+
+/*
+ * Checks if a buffer of a connection reached TS_SERVER_MAX_BUF_SIZE
+ */
+static bool _buffer_full(const std::vector<uint8_t> &buf)
+{
+    return buf.size() >= TS_SERVER_MAX_BUF_SIZE;
+}
+
+static int _set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+ThingSetServer::ThingSetServer(ThingSet *ts, int num_workers) :
+    ts(ts),
+    num_workers(num_workers > 0 ? num_workers : 1)
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = stop_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &ev);
+
+    pthread_rwlock_init(&data_lock, NULL);
+}
+
+ThingSetServer::~ThingSetServer()
+{
+    for (size_t i = 0; i < listen_fds.size(); i++) {
+        close(listen_fds[i]);
+    }
+    for (auto it = connections.begin(); it != connections.end(); ++it) {
+        close(it->first);
+    }
+    close(stop_fd);
+    close(epoll_fd);
+    pthread_rwlock_destroy(&data_lock);
+}
+
+int ThingSetServer::listen_tcp(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0 ||
+        _set_nonblocking(fd) < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    listen_fds.push_back(fd);
+    return 0;
+}
+
+int ThingSetServer::listen_unix(const char *path)
+{
+    struct sockaddr_un addr = {};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    unlink(path);
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0 ||
+        _set_nonblocking(fd) < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    listen_fds.push_back(fd);
+    return 0;
+}
+
+void ThingSetServer::run()
+{
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_workers; i++) {
+        workers.push_back(std::thread(&ThingSetServer::worker, this));
+    }
+
+    struct epoll_event events[64];
+    bool running = true;
+
+    while (running) {
+        int num_events = epoll_wait(epoll_fd, events, sizeof(events) / sizeof(events[0]), -1);
+        if (num_events < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (int i = 0; i < num_events; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == stop_fd) {
+                running = false;
+                break;
+            }
+
+            bool listener = false;
+            for (size_t j = 0; j < listen_fds.size(); j++) {
+                if (listen_fds[j] == fd) {
+                    listener = true;
+                    break;
+                }
+            }
+            if (listener) {
+                accept_connections(fd);
+                continue;
+            }
+
+            std::shared_ptr<Connection> conn;
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex);
+                auto it = connections.find(fd);
+                if (it == connections.end()) {
+                    continue;
+                }
+                conn = it->second;
+            }
+
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                receive(conn, events[i].events & (EPOLLHUP | EPOLLERR));
+            }
+            if (events[i].events & EPOLLOUT) {
+                bool finished = false;
+                bool new_job = false;
+                {
+                    std::lock_guard<std::mutex> lock(conn->mutex);
+                    if (!conn->closed) {
+                        send_pending(conn.get());
+                        // requests may have been held back because of the full send buffer
+                        new_job = start_job(conn.get());
+                        finished = conn->eof && !conn->busy && conn->out.empty();
+                    }
+                }
+                if (finished) {
+                    close_connection(conn);
+                }
+                else if (new_job) {
+                    queue_job(conn);
+                }
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        stopping = true;
+    }
+    jobs_cv.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    std::vector<std::shared_ptr<Connection>> conns;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        for (auto it = connections.begin(); it != connections.end(); ++it) {
+            conns.push_back(it->second);
+        }
+    }
+    for (size_t i = 0; i < conns.size(); i++) {
+        close_connection(conns[i]);
+    }
+}
+
+void ThingSetServer::stop()
+{
+    uint64_t value = 1;
+    if (write(stop_fd, &value, sizeof(value)) < 0) {
+        // nothing we can do
+    }
+}
+
+size_t ThingSetServer::get_num_connections()
+{
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    return connections.size();
+}
+
+void ThingSetServer::accept_connections(int listen_fd)
+{
+    while (true) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // EAGAIN: no more pending connections, other errors: try again with next event
+            return;
+        }
+
+        std::shared_ptr<Connection> conn(new Connection());
+        conn->fd = fd;
+        conn->id = next_conn_id++;
+
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            connections[fd] = conn;
+        }
+
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close_connection(conn);
+        }
+    }
+}
+
+void ThingSetServer::receive(std::shared_ptr<Connection> conn, bool hangup)
+{
+    uint8_t buf[4096];
+    bool close_conn = false;
+    bool new_job = false;
+
+    {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        // after a hangup the peer can't send more data, so the remaining data is read anyway
+        while (hangup || !_buffer_full(conn->in)) {
+            ssize_t len = recv(conn->fd, buf, sizeof(buf), 0);
+            if (len > 0) {
+                conn->in.insert(conn->in.end(), buf, buf + len);
+                // blank lines between requests (e.g. keep-alives) are not kept in the buffer
+                conn->in.erase(conn->in.begin(),
+                    conn->in.begin() + _skip_whitespace(conn->in.data(), conn->in.size()));
+            }
+            else if (len < 0 && errno == EINTR) {
+                continue;
+            }
+            else if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            else if (len == 0) {
+                // peer finished sending: answer pending requests before closing
+                conn->eof = true;
+                break;
+            }
+            else {
+                close_conn = true;
+                break;
+            }
+        }
+
+        size_t start, req_len;
+        if (_next_frame(conn->in.data(), conn->in.size(), &start, &req_len) < 0) {
+            close_conn = true;
+        }
+        else if (!close_conn) {
+            new_job = start_job(conn.get());
+            if (conn->eof && !conn->busy && conn->out.empty()) {
+                close_conn = true;
+            }
+        }
+
+        if ((conn->eof || _buffer_full(conn->in)) && !close_conn) {
+            send_pending(conn.get());     // stop polling for EPOLLIN
+        }
+    }
+
+    if (close_conn) {
+        close_connection(conn);
+    }
+    else if (new_job) {
+        queue_job(conn);
+    }
+}
+
+bool ThingSetServer::start_job(Connection *conn)
+{
+    size_t start, req_len;
+    if (conn->busy || _buffer_full(conn->out) ||
+        _next_frame(conn->in.data(), conn->in.size(), &start, &req_len) <= 0)
+    {
+        return false;
+    }
+    conn->busy = true;
+    return true;
+}
+
+void ThingSetServer::queue_job(std::shared_ptr<Connection> conn)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        jobs.push_back(conn);
+    }
+    jobs_cv.notify_one();
+}
+
+void ThingSetServer::send_pending(Connection *conn)
+{
+    size_t pos = 0;
+    while (pos < conn->out.size()) {
+        ssize_t len = send(conn->fd, &conn->out[pos], conn->out.size() - pos, MSG_NOSIGNAL);
+        if (len > 0) {
+            pos += len;
+        }
+        else if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        else if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        else {
+            // broken connection: reported to the epoll loop via EPOLLHUP/EPOLLERR
+            pos = conn->out.size();
+            shutdown(conn->fd, SHUT_RDWR);
+        }
+    }
+    conn->out.erase(conn->out.begin(), conn->out.begin() + pos);
+
+    // get notified when more data can be sent
+    struct epoll_event ev = {};
+    ev.events = ((conn->eof || _buffer_full(conn->in) || _buffer_full(conn->out)) ? 0 : EPOLLIN) |
+        (conn->out.empty() ? 0 : EPOLLOUT);
+    ev.data.fd = conn->fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+void ThingSetServer::close_connection(std::shared_ptr<Connection> conn)
+{
+    {
+        // the fd may already be closed and reused by a new connection
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        auto it = connections.find(conn->fd);
+        if (it == connections.end() || it->second != conn) {
+            return;
+        }
+        connections.erase(it);
+    }
+
+    std::lock_guard<std::mutex> lock(conn->mutex);
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->closed = true;
+}
+
+int ThingSetServer::process_frame(uint8_t *req, size_t len, uint8_t *resp, size_t resp_size,
+    Connection *conn)
+{
+    if (_is_read_only(req)) {
+        pthread_rwlock_rdlock(&data_lock);
+    }
+    else {
+        pthread_rwlock_wrlock(&data_lock);
+    }
+
+    int resp_len = (recorder != NULL) ?
+        recorder->process(req, len, resp, resp_size, &conn->ctx, conn->id) :
+        ts->process(req, len, resp, resp_size, &conn->ctx);
+
+    pthread_rwlock_unlock(&data_lock);
+
+    return resp_len;
+}
+
+void ThingSetServer::worker()
+{
+    std::vector<uint8_t> req;
+    uint8_t resp[TS_SERVER_RESP_SIZE];
+
+    while (true) {
+        std::shared_ptr<Connection> conn;
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex);
+            jobs_cv.wait(lock, [this]{ return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            conn = jobs.front();
+            jobs.pop_front();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            size_t start, req_len;
+            int frame_len = _next_frame(conn->in.data(), conn->in.size(), &start, &req_len);
+            if (conn->closed || frame_len <= 0) {
+                conn->busy = false;
+                continue;
+            }
+            req.assign(conn->in.begin() + start, conn->in.begin() + start + req_len);
+            conn->in.erase(conn->in.begin(), conn->in.begin() + frame_len);
+        }
+
+        // only one worker processes requests of a connection, so ctx needs no lock
+        int resp_len = 0;
+        bool text_mode = (req.size() == 0 || req[0] >= 0x20);
+        if (req.size() > 0) {
+            resp_len = process_frame(req.data(), req.size(), resp, sizeof(resp), conn.get());
+        }
+
+        bool requeue = false;
+        bool finished = false;
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            if (conn->closed) {
+                conn->busy = false;
+            }
+            else {
+                if (text_mode) {
+                    conn->out.insert(conn->out.end(), resp, resp + resp_len);
+                    conn->out.push_back('\n');
+                }
+                else {
+                    conn->out.push_back(resp_len >> 8);
+                    conn->out.push_back(resp_len & 0xFF);
+                    conn->out.insert(conn->out.end(), resp, resp + resp_len);
+                }
+                send_pending(conn.get());
+
+                // process further requests of this connection after other pending jobs (or
+                // after the responses were sent if the send buffer is full)
+                conn->busy = false;
+                requeue = start_job(conn.get());
+                finished = !requeue && conn->eof && conn->out.empty();
+            }
+        }
+
+#if TS_DEFERRED_CALLBACKS
+        // functions of exec nodes and paths are called after the response was sent
+        if (req.size() > 0 && !_is_read_only(req.data())) {
+            pthread_rwlock_wrlock(&data_lock);
+            ts->run_deferred_callbacks();
+            pthread_rwlock_unlock(&data_lock);
+        }
+#endif
+
+        if (finished) {
+            close_connection(conn);
+        }
+        else if (requeue) {
+            queue_job(conn);
+        }
+    }
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,196 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifndef THINGSET_SERVER_H_
+#define THINGSET_SERVER_H_
+
+#ifdef __linux__
+
+#include "thingset.h"
+#include "thingset_capture.h"
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+/*
+ * Maximum length of a single request (longer requests close the connection)
+ *
+ * Binary mode requests are additionally limited to 2303 bytes (0x08FF), as the first byte of
+ * their length prefix must not be confused with whitespace between text mode requests.
+ */
+#ifndef TS_SERVER_MAX_REQ_SIZE
+#define TS_SERVER_MAX_REQ_SIZE 4096
+#endif
+
+/*
+ * Maximum amount of received or unsent data buffered per connection
+ *
+ * While either buffer of a connection is above this limit, no further data is read from the
+ * socket and no further requests are processed, so clients sending requests without reading
+ * the responses are throttled by TCP flow control.
+ */
+#ifndef TS_SERVER_MAX_BUF_SIZE
+#define TS_SERVER_MAX_BUF_SIZE 16384
+#endif
+
+/*
+ * Size of the response buffer of each worker
+ */
+#ifndef TS_SERVER_RESP_SIZE
+#define TS_SERVER_RESP_SIZE 4096
+#endif
+
+/**
+ * Server exposing a ThingSet object via TCP and Unix domain sockets (Linux only)
+ *
+ * Requests starting with a printable character are text mode requests terminated by a
+ * newline. The response is sent back followed by a newline. All other requests are binary
+ * mode requests prefixed with their length as 16-bit big-endian integer. The response uses the
+ * same framing.
+ *
+ * The sockets are handled by a single thread using epoll, the requests are processed by a pool
+ * of worker threads. Each connection has its own ThingSetContext, so the authentication status
+ * is stored per connection. Requests modifying data are serialized, read-only requests (GET and
+ * FETCH) are processed in parallel.
+ */
+class ThingSetServer
+{
+public:
+    /**
+     * Initialize the server
+     *
+     * @param ts Pointer to ThingSet object to be served
+     * @param num_workers Number of worker threads processing requests
+     */
+    ThingSetServer(ThingSet *ts, int num_workers = 4);
+
+    ~ThingSetServer();
+
+    /**
+     * Listen for TCP connections on all interfaces
+     *
+     * @param port TCP port number
+     *
+     * @returns 0 for success or -1 in case of error (errno is set)
+     */
+    int listen_tcp(uint16_t port);
+
+    /**
+     * Listen for connections on a Unix domain socket
+     *
+     * @param path Path of the socket file (an existing file is removed)
+     *
+     * @returns 0 for success or -1 in case of error (errno is set)
+     */
+    int listen_unix(const char *path);
+
+    /**
+     * Serve requests until stop() is called
+     */
+    void run();
+
+    /**
+     * Stop the server (can be called from any thread)
+     */
+    void stop();
+
+    /**
+     * Get number of currently open client connections
+     */
+    size_t get_num_connections();
+
+    /**
+     * Record all requests and responses (must be set before run() is called)
+     *
+     * @param recorder Pointer to recorder processing the requests with the same ThingSet
+     *                 object as the server or NULL to disable recording
+     */
+    void set_recorder(ThingSetRecorder *recorder)
+    {
+        this->recorder = recorder;
+    }
+
+private:
+    /**
+     * Client connection
+     */
+    struct Connection {
+        int fd;
+        uint32_t id;                    ///< Unique ID (fds are reused after a connection closed)
+        ThingSetContext ctx;            ///< Session of this client
+        std::vector<uint8_t> in;        ///< Received data not yet processed
+        std::vector<uint8_t> out;       ///< Response data not yet sent
+        std::mutex mutex;               ///< Protects all other members
+        bool busy = false;              ///< Queued or processed by a worker
+        bool eof = false;               ///< Peer finished sending requests
+        bool closed = false;
+    };
+
+    void accept_connections(int listen_fd);
+
+    void receive(std::shared_ptr<Connection> conn, bool hangup);
+
+    void send_pending(Connection *conn);
+
+    /**
+     * Mark the connection as busy if a request can be processed (conn->mutex must be locked)
+     *
+     * @returns True if the connection has to be queued for the workers
+     */
+    bool start_job(Connection *conn);
+
+    void queue_job(std::shared_ptr<Connection> conn);
+
+    void close_connection(std::shared_ptr<Connection> conn);
+
+    void worker();
+
+    int process_frame(uint8_t *req, size_t len, uint8_t *resp, size_t resp_size,
+        Connection *conn);
+
+    ThingSet *ts;
+
+    ThingSetRecorder *recorder = NULL;
+
+    int num_workers;
+
+    int epoll_fd;
+
+    int stop_fd;    ///< eventfd to wake up the epoll loop
+
+    std::vector<int> listen_fds;
+
+    uint32_t next_conn_id = 0;      ///< Only accessed by the thread accepting connections
+
+    std::unordered_map<int, std::shared_ptr<Connection>> connections;
+
+    std::mutex connections_mutex;
+
+    std::deque<std::shared_ptr<Connection>> jobs;
+
+    std::mutex jobs_mutex;
+
+    std::condition_variable jobs_cv;
+
+    bool stopping = false;
+
+    /**
+     * Lock to serialize requests modifying data (read-only requests run in parallel)
+     */
+    pthread_rwlock_t data_lock;
+};
+
+#endif /* __linux__ */
+
+#endif /* THINGSET_SERVER_H_ */
@@ -15,124 +15,380 @@
 #include <errno.h>
 #include <cinttypes>
 
+/*
+ * Checks if any of the 4 bytes in a word is a control character, a quotation mark or a backslash
+ *
+ * SWAR (SIMD within a register) bit hacks are used, so that runs of safe characters can be
+ * checked word by word also on MCUs without vector instructions.
+ */
+static inline bool _json_word_needs_escape(uint32_t w)
+{
+    const uint32_t ones = 0x01010101U;
+    const uint32_t highs = 0x80808080U;
+    uint32_t quote = w ^ (ones * '"');
+    uint32_t backslash = w ^ (ones * '\\');
+    return (((w - ones * 0x20) & ~w) |
+        ((quote - ones) & ~quote) |
+        ((backslash - ones) & ~backslash)) & highs;
+}
+
+static inline bool _json_char_needs_escape(char c)
+{
+    return (uint8_t)c < 0x20 || c == '"' || c == '\\';
+}
+
+/*
+ * Serializes a string including quotation marks and escapes special characters
+ *
+ * Returns length of the serialized string or 0 if it does not fit into the buffer
+ */
+static int _json_serialize_string(char *buf, size_t size, const char *str)
+{
+    size_t pos = 0;
+    size_t len = strlen(str);
+    size_t i = 0;
+
+    if (size < len + 2) {
+        return 0;
+    }
+    buf[pos++] = '"';
+
+    while (i < len) {
+        // find run of characters which can be copied without escaping
+        size_t run = i;
+        while (run + 4 <= len) {
+            uint32_t w;
+            memcpy(&w, &str[run], 4);
+            if (_json_word_needs_escape(w)) {
+                break;
+            }
+            run += 4;
+        }
+        while (run < len && !_json_char_needs_escape(str[run])) {
+            run++;
+        }
+
+        if (pos + (run - i) + 1 >= size) {
+            return 0;
+        }
+        memcpy(&buf[pos], &str[i], run - i);
+        pos += run - i;
+        i = run;
+
+        if (i < len) {
+            char esc = 0;
+            switch (str[i]) {
+                case '"':  esc = '"';  break;
+                case '\\': esc = '\\'; break;
+                case '\b': esc = 'b';  break;
+                case '\f': esc = 'f';  break;
+                case '\n': esc = 'n';  break;
+                case '\r': esc = 'r';  break;
+                case '\t': esc = 't';  break;
+            }
+            if (esc != 0 && pos + 2 < size) {
+                buf[pos++] = '\\';
+                buf[pos++] = esc;
+            }
+            else if (esc == 0 && pos + 6 < size) {
+                pos += snprintf(&buf[pos], size - pos, "\\u%.4X", (uint8_t)str[i]);
+            }
+            else {
+                return 0;
+            }
+            i++;
+        }
+    }
+
+    if (pos + 1 >= size) {
+        return 0;
+    }
+    buf[pos++] = '"';
+    buf[pos] = '\0';
+    return pos;
+}
+
+/*
+ * 32-bit FNV-1a hash used to detect changes of published values
+ */
+static uint32_t _fnv1a_hash(const char *data, size_t len)
+{
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static int _hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static long _parse_unicode_escape(const char *str, size_t len)
+{
+    long cp = 0;
+    if (len < 6 || str[0] != '\\' || str[1] != 'u') {
+        return -1;
+    }
+    for (int i = 2; i < 6; i++) {
+        int digit = _hex_value(str[i]);
+        if (digit < 0) {
+            return -1;
+        }
+        cp = (cp << 4) | digit;
+    }
+    return cp;
+}
+
+/*
+ * Resolves escape sequences of a JSON string (without quotation marks) and stores the result
+ * as null-terminated string in buf
+ *
+ * If buf is NULL, the string is only checked for validity.
+ *
+ * Returns length of the unescaped string or -1 if the string is invalid or too long
+ */
+static int _json_deserialize_string(char *buf, size_t size, const char *str, size_t len)
+{
+    size_t pos = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        // copy runs without escape sequences at once (memchr is optimized in most libc's)
+        const char *bs = (const char *)memchr(&str[i], '\\', len - i);
+        size_t run = (bs == NULL) ? len - i : bs - &str[i];
+        if (pos + run >= size) {
+            return -1;
+        }
+        if (buf) {
+            memcpy(&buf[pos], &str[i], run);
+        }
+        pos += run;
+        i += run;
+
+        if (i < len) {
+            char c[4];
+            int c_len = 1;
+            if (i + 1 >= len) {
+                return -1;
+            }
+            switch (str[i + 1]) {
+                case '"':  c[0] = '"';  break;
+                case '\\': c[0] = '\\'; break;
+                case '/':  c[0] = '/';  break;
+                case 'b':  c[0] = '\b'; break;
+                case 'f':  c[0] = '\f'; break;
+                case 'n':  c[0] = '\n'; break;
+                case 'r':  c[0] = '\r'; break;
+                case 't':  c[0] = '\t'; break;
+                case 'u': {
+                    long cp = _parse_unicode_escape(&str[i], len - i);
+                    if (cp <= 0 || (cp >= 0xDC00 && cp <= 0xDFFF)) {
+                        // NUL can't be stored in a C string, low surrogate without high one
+                        return -1;
+                    }
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        // surrogate pair
+                        long low = _parse_unicode_escape(&str[i + 6], len - i - 6);
+                        if (low < 0xDC00 || low > 0xDFFF) {
+                            return -1;
+                        }
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    }
+                    // encode as UTF-8
+                    if (cp < 0x80) {
+                        c[0] = cp;
+                    }
+                    else if (cp < 0x800) {
+                        c[0] = 0xC0 | (cp >> 6);
+                        c[1] = 0x80 | (cp & 0x3F);
+                        c_len = 2;
+                    }
+                    else if (cp < 0x10000) {
+                        c[0] = 0xE0 | (cp >> 12);
+                        c[1] = 0x80 | ((cp >> 6) & 0x3F);
+                        c[2] = 0x80 | (cp & 0x3F);
+                        c_len = 3;
+                    }
+                    else {
+                        c[0] = 0xF0 | (cp >> 18);
+                        c[1] = 0x80 | ((cp >> 12) & 0x3F);
+                        c[2] = 0x80 | ((cp >> 6) & 0x3F);
+                        c[3] = 0x80 | (cp & 0x3F);
+                        c_len = 4;
+                    }
+                    i += 4;
+                    break;
+                }
+                default:
+                    return -1;
+            }
+            if (pos + c_len >= size) {
+                return -1;
+            }
+            if (buf) {
+                memcpy(&buf[pos], c, c_len);
+            }
+            pos += c_len;
+            i += 2;
+        }
+    }
 
-int ThingSet::txt_response(int code)
+    if (buf) {
+        buf[pos] = '\0';
+    }
+    return pos;
+}
+
+
+int ThingSet::txt_response(ThingSetContext *ctx, int code)
 {
+    char *buf = (char *)ctx->resp;
+    size_t size = ctx->resp_size;
     size_t pos = 0;
 #ifdef TS_VERBOSE_STATUS_MESSAGES
     switch(code) {
         // success
         case TS_STATUS_CREATED:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Created.", code);
+            pos = snprintf(buf, size, ":%.2X Created.", code);
             break;
         case TS_STATUS_DELETED:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Deleted.", code);
+            pos = snprintf(buf, size, ":%.2X Deleted.", code);
             break;
         case TS_STATUS_VALID:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Valid.", code);
+            pos = snprintf(buf, size, ":%.2X Valid.", code);
             break;
         case TS_STATUS_CHANGED:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Changed.", code);
+            pos = snprintf(buf, size, ":%.2X Changed.", code);
             break;
         case TS_STATUS_CONTENT:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Content.", code);
+            pos = snprintf(buf, size, ":%.2X Content.", code);
             break;
         // client errors
         case TS_STATUS_BAD_REQUEST:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Bad Request.", code);
+            pos = snprintf(buf, size, ":%.2X Bad Request.", code);
             break;
         case TS_STATUS_UNAUTHORIZED:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Unauthorized.", code);
+            pos = snprintf(buf, size, ":%.2X Unauthorized.", code);
             break;
         case TS_STATUS_FORBIDDEN:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Forbidden.", code);
+            pos = snprintf(buf, size, ":%.2X Forbidden.", code);
             break;
         case TS_STATUS_NOT_FOUND:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Not Found.", code);
+            pos = snprintf(buf, size, ":%.2X Not Found.", code);
             break;
         case TS_STATUS_METHOD_NOT_ALLOWED:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Method Not Allowed.", code);
+            pos = snprintf(buf, size, ":%.2X Method Not Allowed.", code);
             break;
         case TS_STATUS_REQUEST_INCOMPLETE:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Request Entity Incomplete.", code);
+            pos = snprintf(buf, size, ":%.2X Request Entity Incomplete.", code);
             break;
         case TS_STATUS_CONFLICT:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Conflict.", code);
+            pos = snprintf(buf, size, ":%.2X Conflict.", code);
             break;
         case TS_STATUS_REQUEST_TOO_LARGE:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Request Entity Too Large.", code);
+            pos = snprintf(buf, size, ":%.2X Request Entity Too Large.", code);
             break;
         case TS_STATUS_UNSUPPORTED_FORMAT:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Unsupported Content-Format.", code);
+            pos = snprintf(buf, size, ":%.2X Unsupported Content-Format.", code);
             break;
         // server errors
         case TS_STATUS_INTERNAL_SERVER_ERR:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Internal Server Error.", code);
+            pos = snprintf(buf, size, ":%.2X Internal Server Error.", code);
             break;
         case TS_STATUS_NOT_IMPLEMENTED:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Not Implemented.", code);
+            pos = snprintf(buf, size, ":%.2X Not Implemented.", code);
+            break;
+        case TS_STATUS_SERVICE_UNAVAILABLE:
+            pos = snprintf(buf, size, ":%.2X Service Unavailable.", code);
             break;
         default:
-            pos = snprintf((char *)resp, resp_size, ":%.2X Error.", code);
+            pos = snprintf(buf, size, ":%.2X Error.", code);
             break;
     };
 #else
-    pos = snprintf((char *)resp, resp_size, ":%.2X.", code);
+    pos = snprintf(buf, size, ":%.2X.", code);
 #endif
-    if (pos < resp_size)
+    if (pos < size)
         return pos;
     else
         return 0;
 }
 
-int ThingSet::json_serialize_value(char *buf, size_t size, const DataNode *node)
+int ThingSet::json_serialize_value(char *buf, size_t size, const DataNode *node,
+    const uint8_t *front)
 {
     size_t pos = 0;
     const DataNode *sub_node;
+    void *data = node_data(node, front);
 
     switch (node->type) {
 #ifdef TS_64BIT_TYPES_SUPPORT
     case TS_T_UINT64:
-        pos = snprintf(&buf[pos], size - pos, "%" PRIu64 ",", *((uint64_t *)node->data));
+        pos = snprintf(&buf[pos], size - pos, "%" PRIu64 ",", *((uint64_t *)data));
         break;
     case TS_T_INT64:
-        pos = snprintf(&buf[pos], size - pos, "%" PRIi64 ",", *((int64_t *)node->data));
+        pos = snprintf(&buf[pos], size - pos, "%" PRIi64 ",", *((int64_t *)data));
         break;
 #endif
     case TS_T_UINT32:
-        pos = snprintf(&buf[pos], size - pos, "%" PRIu32 ",", *((uint32_t *)node->data));
+        pos = snprintf(&buf[pos], size - pos, "%" PRIu32 ",", *((uint32_t *)data));
         break;
     case TS_T_INT32:
-        pos = snprintf(&buf[pos], size - pos, "%" PRIi32 ",", *((int32_t *)node->data));
+        pos = snprintf(&buf[pos], size - pos, "%" PRIi32 ",", *((int32_t *)data));
         break;
     case TS_T_UINT16:
-        pos = snprintf(&buf[pos], size - pos, "%" PRIu16 ",", *((uint16_t *)node->data));
+        pos = snprintf(&buf[pos], size - pos, "%" PRIu16 ",", *((uint16_t *)data));
         break;
     case TS_T_INT16:
-        pos = snprintf(&buf[pos], size - pos, "%" PRIi16 ",", *((int16_t *)node->data));
+        pos = snprintf(&buf[pos], size - pos, "%" PRIi16 ",", *((int16_t *)data));
         break;
     case TS_T_FLOAT32:
         pos = snprintf(&buf[pos], size - pos, "%.*f,", node->detail,
-                *((float *)node->data));
+                *((float *)data));
         break;
     case TS_T_BOOL:
         pos = snprintf(&buf[pos], size - pos, "%s,",
-                (*((bool *)node->data) == true ? "true" : "false"));
+                (*((bool *)data) == true ? "true" : "false"));
         break;
     case TS_T_EXEC:
         pos = snprintf(&buf[pos], size - pos, "null,");
         break;
     case TS_T_STRING:
-        pos = snprintf(&buf[pos], size - pos, "\"%s\",", (char *)node->data);
+        pos = _json_serialize_string(&buf[pos], size - pos, (char *)data);
+        if (pos == 0) {
+            return 0;
+        }
+        pos += snprintf(&buf[pos], size - pos, ",");
         break;
     case TS_T_PUBSUB:
-        pos = snprintf(&buf[pos], size - pos, "[]") - 1;
-        for (unsigned int i = 0; i < num_nodes; i++) {
-            if (data_nodes[i].pubsub & (uint16_t)node->detail) {
-                pos += snprintf(&buf[pos], size - pos, "\"%s\",", data_nodes[i].name);
+        pos = snprintf(&buf[pos], size - pos, "[");
+        for (unsigned int i = next_pub_node((uint16_t)node->detail, 0); i < num_nodes;
+            i = next_pub_node((uint16_t)node->detail, i + 1))
+        {
+            if (pos >= size) {
+                return 0;
             }
+            pos += snprintf(&buf[pos], size - pos, "\"%s\",", data_nodes[i].name);
+        }
+        if (pos >= size) {
+            return 0;
+        }
+        if (buf[pos - 1] == ',') {
+            pos--; // remove trailing comma
         }
-        pos--; // remove trailing comma
         pos += snprintf(&buf[pos], size - pos, "],");
         break;
     case TS_T_ARRAY:
@@ -142,6 +398,9 @@ int ThingSet::json_serialize_value(char *buf, size_t size, const DataNode *node)
         }
         pos += snprintf(&buf[pos], size - pos, "[");
         for (int i = 0; i < array_info->num_elements; i++) {
+            if (pos >= size) {
+                return 0;
+            }
             switch (array_info->type) {
             case TS_T_UINT64:
                 pos += snprintf(&buf[pos], size - pos, "%" PRIu64 ",",
@@ -181,7 +440,10 @@ int ThingSet::json_serialize_value(char *buf, size_t size, const DataNode *node)
                 break;
             }
         }
-        if (array_info->num_elements > 0) {
+        if (pos >= size) {
+            return 0;
+        }
+        if (buf[pos - 1] == ',') {
             pos--; // remove trailing comma
         }
         pos += snprintf(&buf[pos], size - pos, "],");
@@ -196,185 +458,357 @@ int ThingSet::json_serialize_value(char *buf, size_t size, const DataNode *node)
     }
 }
 
-int ThingSet::json_serialize_name_value(char *buf, size_t size, const DataNode* node)
+int ThingSet::json_serialize_name_value(char *buf, size_t size, const DataNode* node,
+    const uint8_t *front)
 {
     size_t pos = snprintf(buf, size, "\"%s\":", node->name);
 
     if (pos < size) {
-        return pos + json_serialize_value(&buf[pos], size - pos, node);
+        return pos + json_serialize_value(&buf[pos], size - pos, node, front);
     }
     else {
         return 0;
     }
 }
 
+/*
+ * Buffer to collect small pieces of output before passing them to the output function
+ */
+typedef struct {
+    char buf[TS_DUMP_JSON_BUF_SIZE];
+    size_t len;
+    void (*write)(const char *buf, size_t len, void *arg);
+    void *arg;
+} OutputBuffer;
+
+static void _output_flush(OutputBuffer *out)
+{
+    if (out->len > 0) {
+        out->write(out->buf, out->len, out->arg);
+        out->len = 0;
+    }
+}
+
+static void _output_str(OutputBuffer *out, const char *str, size_t len)
+{
+    while (len > 0) {
+        if (out->len == sizeof(out->buf)) {
+            _output_flush(out);
+        }
+        size_t chunk = sizeof(out->buf) - out->len;
+        if (chunk > len) {
+            chunk = len;
+        }
+        memcpy(&out->buf[out->len], str, chunk);
+        out->len += chunk;
+        str += chunk;
+        len -= chunk;
+    }
+}
+
+static void _output_indent(OutputBuffer *out, int level)
+{
+    static const char spaces[] = "        ";
+    for (int i = 0; i < level; i++) {
+        _output_str(out, spaces, 4);
+    }
+}
+
+void ThingSet::write_file(const char *buf, size_t len, void *file)
+{
+    fwrite(buf, 1, len, (FILE *)file);
+}
+
 void ThingSet::dump_json(node_id_t node_id, int level)
 {
-    uint8_t buf[100];
-    bool first = true;
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].parent == node_id) {
-            if (!first) {
-                printf(",\n");
+    dump_json(write_file, stdout, node_id, level);
+}
+
+void ThingSet::dump_json(void (*write)(const char *buf, size_t len, void *arg), void *arg,
+    node_id_t node_id, int level)
+{
+    // explicit stack instead of recursion to limit the stack usage
+    struct {
+        node_id_t parent;       // parent node ID of this level
+        unsigned int pos;       // position in data_nodes to continue searching for children
+        bool first;             // no child node printed yet
+    } stack[TS_DUMP_JSON_MAX_DEPTH];
+    int depth = 0;
+
+    OutputBuffer out;
+    out.len = 0;
+    out.write = write;
+    out.arg = arg;
+
+    _output_indent(&out, level);
+    _output_str(&out, "{", 1);
+    stack[0].parent = node_id;
+    stack[0].pos = 0;
+    stack[0].first = true;
+
+    while (depth >= 0) {
+        unsigned int i = stack[depth].pos;
+        while (i < num_nodes && data_nodes[i].parent != stack[depth].parent) {
+            i++;
+        }
+
+        if (i >= num_nodes) {
+            // all children of this level printed
+            _output_str(&out, "\n", 1);
+            _output_indent(&out, level + depth);
+            _output_str(&out, "}", 1);
+            depth--;
+            continue;
+        }
+
+        stack[depth].pos = i + 1;
+        if (stack[depth].first) {
+            _output_str(&out, "\n", 1);
+            stack[depth].first = false;
+        }
+        else {
+            _output_str(&out, ",\n", 2);
+        }
+        _output_indent(&out, level + depth + 1);
+
+        const DataNode *node = &data_nodes[i];
+        _output_str(&out, "\"", 1);
+        _output_str(&out, node->name, strlen(node->name));
+        _output_str(&out, "\":", 2);
+
+        if (node->type == TS_T_PATH) {
+            if (depth + 1 < TS_DUMP_JSON_MAX_DEPTH) {
+                _output_str(&out, " {", 2);
+                depth++;
+                stack[depth].parent = node->id;
+                stack[depth].pos = 0;
+                stack[depth].first = true;
             }
             else {
-                printf("\n");
-                first = false;
+                _output_str(&out, " {}", 3);  // maximum depth reached: skip children
+            }
+        }
+        else {
+            const uint8_t *front = NULL;
+#if TS_SEQLOCK || TS_DOUBLE_BUFFER
+            ReadState state;
+            read_begin(&state);
+            front = state.front;
+#endif
+            // serialize directly into the output buffer, flush first if space is not sufficient
+            int len = json_serialize_value(&out.buf[out.len], sizeof(out.buf) - out.len, node,
+                front);
+            if (len == 0 && out.len > 0) {
+                _output_flush(&out);
+                len = json_serialize_value(out.buf, sizeof(out.buf), node, front);
             }
-            if (data_nodes[i].type == TS_T_PATH) {
-                printf("%*s\"%s\" {", 4 * level, "", data_nodes[i].name);
-                dump_json(data_nodes[i].id, level + 1);
-                printf("\n%*s}", 4 * level, "");
+#if TS_SEQLOCK || TS_DOUBLE_BUFFER
+            read_end(&state);
+#endif
+            if (len > 0) {
+                out.len += len - 1;     // without trailing comma
             }
             else {
-                int pos = json_serialize_name_value((char *)buf, sizeof(buf), &data_nodes[i]);
-                if (pos > 0) {
-                    buf[pos-1] = '\0';  // remove trailing comma
-                    printf("%*s%s", 4 * level, "", (char *)buf);
-                }
+                _output_str(&out, "null", 4);   // value too long for the buffer
             }
         }
     }
-    if (node_id == 0) {
-        printf("\n");
-    }
+
+    _output_str(&out, "\n", 1);
+    _output_flush(&out);
 }
 
-int ThingSet::txt_process()
+int ThingSet::txt_process(ThingSetContext *ctx)
 {
-    int path_len = req_len - 1;
-    char *path_end = strchr((char *)req + 1, ' ');
+    int path_len = ctx->req_len - 1;
+    // request is not necessarily null-terminated
+    char *path_end = (char *)memchr(ctx->req + 1, ' ', ctx->req_len - 1);
     if (path_end) {
-        path_len = (uint8_t *)path_end - req - 1;
+        path_len = (uint8_t *)path_end - ctx->req - 1;
     }
 
-    const DataNode *endpoint = get_endpoint((char *)req + 1, path_len);
+    const DataNode *endpoint = get_endpoint((char *)ctx->req + 1, path_len);
+    ctx->step_node = endpoint;
     if (!endpoint) {
-        if (req[0] == '?' && req[1] == '/' && path_len == 1) {
-            return txt_get(NULL, false);
+        if (ctx->req[0] == '?' && ctx->req[1] == '/' && path_len == 1) {
+            return txt_get(ctx, NULL, false);
         }
         else {
-            return txt_response(TS_STATUS_NOT_FOUND);
+            return txt_response(ctx, TS_STATUS_NOT_FOUND);
         }
     }
 
     jsmn_parser parser;
     jsmn_init(&parser);
 
-    json_str = (char *)req + 1 + path_len;
-    tok_count = jsmn_parse(&parser, json_str, req_len - path_len - 1, tokens, sizeof(tokens));
+    ctx->json_str = (char *)ctx->req + 1 + path_len;
+    ctx->json_len = ctx->req_len - path_len - 1;
+#if TS_JSON_STREAMING
+    // only count and validate the tokens, they are parsed again on demand by the handlers
+    ctx->tok_count = jsmn_parse(&parser, ctx->json_str, ctx->json_len, NULL, 0);
+    jsmn_init(&ctx->json_parser);
+    ctx->json_tok_index = -1;
+#else
+    ctx->tok_count = jsmn_parse(&parser, ctx->json_str, ctx->json_len, ctx->tokens,
+        sizeof(ctx->tokens) / sizeof(jsmntok_t));
+#endif
 
-    if (tok_count == JSMN_ERROR_NOMEM) {
-        return txt_response(TS_STATUS_REQUEST_TOO_LARGE);
+    if (ctx->tok_count == JSMN_ERROR_NOMEM) {
+        return txt_response(ctx, TS_STATUS_REQUEST_TOO_LARGE);
     }
-    else if (tok_count < 0) {
+    else if (ctx->tok_count < 0) {
         // other parsing error
-        return txt_response(TS_STATUS_BAD_REQUEST);
+        return txt_response(ctx, TS_STATUS_BAD_REQUEST);
     }
-    else if (tok_count == 0) {
-        if (req[0] == '?') {
+    else if (ctx->tok_count == 0) {
+        if (ctx->req[0] == '?') {
             // no payload data
-            if ((char)req[path_len] == '/') {
+            if ((char)ctx->req[path_len] == '/') {
                 if (endpoint->type == TS_T_PATH || endpoint->type == TS_T_EXEC) {
-                    return txt_get(endpoint, false);
+                    return txt_get(ctx, endpoint, false);
                 }
                 else {
                     // device discovery is only allowed for internal nodes
-                    return txt_response(TS_STATUS_BAD_REQUEST);
+                    return txt_response(ctx, TS_STATUS_BAD_REQUEST);
                 }
             }
             else {
-                return txt_get(endpoint, true);
+                return txt_get(ctx, endpoint, true);
             }
         }
-        else if (req[0] == '!') {
-            return txt_exec(endpoint);
+        else if (ctx->req[0] == '!') {
+            return txt_exec(ctx, endpoint);
         }
     }
     else {
-        if (req[0] == '?') {
-            return txt_fetch(endpoint->id);
+        if (ctx->req[0] == '?') {
+            return txt_fetch(ctx, endpoint->id);
         }
-        else if (req[0] == '=') {
-            int len = txt_patch(endpoint->id);
-
-            // check if endpoint has a callback assigned
-            if (endpoint->data != NULL && strncmp((char *)resp, ":84", 3) == 0) {
-                // create function pointer and call function
-                void (*fun)(void) = reinterpret_cast<void(*)()>(endpoint->data);
-                fun();
+        else if (ctx->req[0] == '=') {
+            // the callback of the endpoint (if assigned) must not be lost after values changed
+            if (!reserve_callback(ctx, endpoint)) {
+                return txt_response(ctx, TS_STATUS_SERVICE_UNAVAILABLE);
             }
-            return len;
+            uint8_t status = txt_patch(ctx, endpoint->id);
+            run_callback(ctx, endpoint, status == TS_STATUS_CHANGED);
+            return txt_response(ctx, status);
         }
-        else if (req[0] == '!' && endpoint->type == TS_T_EXEC) {
-            return txt_exec(endpoint);
+        else if (ctx->req[0] == '!' && endpoint->type == TS_T_EXEC) {
+            return txt_exec(ctx, endpoint);
         }
-        else if (req[0] == '+') {
-            return txt_create(endpoint);
+        else if (ctx->req[0] == '+') {
+            return txt_create(ctx, endpoint);
         }
-        else if (req[0] == '-') {
-            return txt_delete(endpoint);
+        else if (ctx->req[0] == '-') {
+            return txt_delete(ctx, endpoint);
         }
     }
-    return txt_response(TS_STATUS_BAD_REQUEST);
+    return txt_response(ctx, TS_STATUS_BAD_REQUEST);
 }
 
-int ThingSet::txt_fetch(node_id_t parent_id)
+jsmntok_t ThingSet::json_token(ThingSetContext *ctx, int index)
+{
+#if TS_JSON_STREAMING
+    if (index < ctx->json_tok_index) {
+        // restart parsing from the beginning of the payload
+        jsmn_init(&ctx->json_parser);
+        ctx->json_tok_index = -1;
+    }
+    while (ctx->json_tok_index < index) {
+        jsmntok_t next;
+        if (jsmn_next(&ctx->json_parser, ctx->json_str, ctx->json_len, &next) != 1) {
+            jsmntok_t invalid = { JSMN_UNDEFINED, -1, -1, 0 };
+            return invalid;
+        }
+        ctx->json_tok = next;
+        ctx->json_tok_index++;
+    }
+    return ctx->json_tok;
+#else
+    if (index < 0 || index >= ctx->tok_count) {
+        jsmntok_t invalid = { JSMN_UNDEFINED, -1, -1, 0 };
+        return invalid;
+    }
+    return ctx->tokens[index];
+#endif
+}
+
+int ThingSet::txt_fetch(ThingSetContext *ctx, node_id_t parent_id)
 {
     size_t pos = 0;
     int tok = 0;       // current token
+    bool array;
 
-    // initialize response with success message
-    pos += txt_response(TS_STATUS_CONTENT);
+    if (ctx->step_handler != TS_STEP_NONE) {
+        // continue request from previous step
+        pos = ctx->step_pos;
+        tok = ctx->step_index;
+        array = ctx->step_total;
+    }
+    else {
+        array = (json_token(ctx, 0).type == JSMN_ARRAY);
 
-    if (tokens[0].type == JSMN_ARRAY) {
-        pos += snprintf((char *)&resp[pos], resp_size - pos, " [");
-        tok++;
-    } else {
-        pos += snprintf((char *)&resp[pos], resp_size - pos, " ");
+        // initialize response with success message
+        pos += txt_response(ctx, TS_STATUS_CONTENT);
+
+        if (array) {
+            pos += snprintf((char *)&ctx->resp[pos], ctx->resp_size - pos, " [");
+            tok++;
+        } else {
+            pos += snprintf((char *)&ctx->resp[pos], ctx->resp_size - pos, " ");
+        }
     }
 
-    while (tok < tok_count) {
+    while (tok < ctx->tok_count) {
+
+        if (step_yield(ctx)) {
+            ctx->step_handler = TS_STEP_TXT_FETCH;
+            ctx->step_index = tok;
+            ctx->step_pos = pos;
+            ctx->step_total = array;
+            return TS_PROCESS_PENDING;
+        }
 
-        if (tokens[tok].type != JSMN_STRING) {
-            return txt_response(TS_STATUS_BAD_REQUEST);
+        jsmntok_t name = json_token(ctx, tok);
+        if (name.type != JSMN_STRING) {
+            return txt_response(ctx, TS_STATUS_BAD_REQUEST);
         }
 
-        const DataNode *node = get_node(
-            json_str + tokens[tok].start,
-            tokens[tok].end - tokens[tok].start, parent_id);
+        const DataNode *node = get_node(ctx->json_str + name.start, name.end - name.start,
+            parent_id);
 
         if (node == NULL) {
-            return txt_response(TS_STATUS_NOT_FOUND);
+            return txt_response(ctx, TS_STATUS_NOT_FOUND);
         }
         else if (node->type == TS_T_PATH) {
             // bad request, as we can't read internal path node's values
-            return txt_response(TS_STATUS_BAD_REQUEST);
+            return txt_response(ctx, TS_STATUS_BAD_REQUEST);
         }
 
-        if ((node->access & TS_READ_MASK & _auth_flags) == 0) {
+        if ((node->access & TS_READ_MASK & ctx->auth_flags) == 0) {
             if (node->access & TS_READ_MASK) {
-                return txt_response(TS_STATUS_UNAUTHORIZED);
+                return txt_response(ctx, TS_STATUS_UNAUTHORIZED);
             }
             else {
-                return txt_response(TS_STATUS_FORBIDDEN);
+                return txt_response(ctx, TS_STATUS_FORBIDDEN);
             }
         }
 
-        pos += json_serialize_value((char *)&resp[pos], resp_size - pos, node);
+        pos += json_serialize_value((char *)&ctx->resp[pos], ctx->resp_size - pos, node,
+            read_buf(ctx));
 
-        if (pos >= resp_size - 2) {
-            return txt_response(TS_STATUS_RESPONSE_TOO_LARGE);
+        if (pos >= ctx->resp_size - 2) {
+            return txt_response(ctx, TS_STATUS_RESPONSE_TOO_LARGE);
         }
         tok++;
     }
 
     pos--;  // remove trailing comma
-    if (tokens[0].type == JSMN_ARRAY) {
+    if (array) {
         // buffer will be long enough as we dropped last 2 characters --> sprintf allowed
-        pos += sprintf((char *)&resp[pos], "]");
+        pos += sprintf((char *)&ctx->resp[pos], "]");
     } else {
-        resp[pos] = '\0';    // terminate string
+        ctx->resp[pos] = '\0';    // terminate string
     }
 
     return pos;
@@ -421,12 +855,13 @@ int ThingSet::json_deserialize_value(char *buf, size_t len, jsmntype_t type, con
             }
             break;
         case TS_T_STRING:
-            if (type != JSMN_STRING || (unsigned int)node->detail <= len) {
+            if (type != JSMN_STRING) {
                 return 0;
             }
-            else if (node->id != 0) {     // dummy node has id = 0
-                strncpy((char*)node->data, buf, len);
-                ((char*)node->data)[len] = '\0';
+            else if (_json_deserialize_string((node->id != 0) ? (char*)node->data : NULL,
+                (size_t)node->detail, buf, len) < 0)    // dummy node has id = 0 --> only check string
+            {
+                return 0;
             }
             break;
     }
@@ -438,77 +873,152 @@ int ThingSet::json_deserialize_value(char *buf, size_t len, jsmntype_t type, con
     return 1;   // value always contained in one token (arrays not yet supported)
 }
 
-int ThingSet::txt_patch(node_id_t parent_id)
+static size_t _type_size(uint8_t type)
+{
+    switch (type) {
+        case TS_T_UINT64:
+        case TS_T_INT64:
+            return 8;
+        case TS_T_UINT32:
+        case TS_T_INT32:
+        case TS_T_FLOAT32:
+            return 4;
+        case TS_T_UINT16:
+        case TS_T_INT16:
+            return 2;
+        case TS_T_BOOL:
+            return sizeof(bool);
+        default:
+            return 0;   // variable length or not supported in arrays
+    }
+}
+
+int ThingSet::json_deserialize_array(ThingSetContext *ctx, int tok, const DataNode *node,
+    bool check_only)
+{
+    ArrayInfo *array_info = (ArrayInfo *)node->data;
+    jsmntok_t array = json_token(ctx, tok);
+    size_t elem_size = _type_size(array_info->type);
+    uint8_t dummy_data[8];          // enough to fit also 64-bit values
+
+    if (array.type != JSMN_ARRAY || elem_size == 0) {
+        return 0;
+    }
+    else if (array.size > array_info->max_elements) {
+        return -1;
+    }
+
+    for (int i = 0; i < array.size; i++) {
+        jsmntok_t elem = json_token(ctx, tok + 1 + i);
+        if (elem.type != JSMN_PRIMITIVE) {
+            return 0;
+        }
+        void *elem_data = check_only ? (void *)dummy_data :
+            (void *)((uint8_t *)array_info->ptr + i * elem_size);
+        DataNode elem_node = {0, 0, "Dummy", elem_data, array_info->type, node->detail};
+
+        // elements are terminated by comma, bracket or whitespace, so no need to copy them
+        if (json_deserialize_value(ctx->json_str + elem.start, elem.end - elem.start, elem.type,
+            &elem_node) == 0)
+        {
+            return 0;
+        }
+    }
+
+    if (!check_only) {
+        array_info->num_elements = array.size;
+    }
+
+    return 1 + array.size;
+}
+
+uint8_t ThingSet::txt_patch(ThingSetContext *ctx, node_id_t parent_id)
 {
     int tok = 0;       // current token
+    jsmntype_t first_type = json_token(ctx, 0).type;
 
     // buffer for data node value (largest negative 64bit integer has 20 digits)
     char value_buf[21];
     size_t value_len;   // length of value in buffer
 
-    if (tok_count < 2) {
-        if (tok_count == JSMN_ERROR_NOMEM) {
-            return txt_response(TS_STATUS_REQUEST_TOO_LARGE);
+    if (ctx->tok_count < 2) {
+        if (ctx->tok_count == JSMN_ERROR_NOMEM) {
+            return TS_STATUS_REQUEST_TOO_LARGE;
         } else {
-            return txt_response(TS_STATUS_BAD_REQUEST);
+            return TS_STATUS_BAD_REQUEST;
         }
     }
 
-    if (tokens[0].type == JSMN_OBJECT) {    // object = map
+    if (first_type == JSMN_OBJECT) {    // object = map
         tok++;
     }
 
     // loop through all elements to check if request is valid
-    while (tok + 1 < tok_count) {
+    while (tok + 1 < ctx->tok_count) {
 
-        if (tokens[tok].type != JSMN_STRING ||
-            (tokens[tok+1].type != JSMN_PRIMITIVE && tokens[tok+1].type != JSMN_STRING)) {
-            return txt_response(TS_STATUS_BAD_REQUEST);
+        jsmntok_t key = json_token(ctx, tok);
+        jsmntok_t value = json_token(ctx, tok + 1);
+        if (key.type != JSMN_STRING || (value.type != JSMN_PRIMITIVE &&
+            value.type != JSMN_STRING && value.type != JSMN_ARRAY)) {
+            return TS_STATUS_BAD_REQUEST;
         }
 
-        const DataNode* node = get_node(
-            json_str + tokens[tok].start,
-            tokens[tok].end - tokens[tok].start, parent_id);
+        const DataNode* node = get_node(ctx->json_str + key.start, key.end - key.start, parent_id);
 
         if (node == NULL) {
-            return txt_response(TS_STATUS_NOT_FOUND);
+            return TS_STATUS_NOT_FOUND;
         }
 
-        if ((node->access & TS_WRITE_MASK & _auth_flags) == 0) {
+        if ((node->access & TS_WRITE_MASK & ctx->auth_flags) == 0) {
             if (node->access & TS_WRITE_MASK) {
-                return txt_response(TS_STATUS_UNAUTHORIZED);
+                return TS_STATUS_UNAUTHORIZED;
             }
             else {
-                return txt_response(TS_STATUS_FORBIDDEN);
+                return TS_STATUS_FORBIDDEN;
             }
         }
 
         tok++;
 
-        // extract the value and check buffer lengths
-        value_len = tokens[tok].end - tokens[tok].start;
-        if ((node->type != TS_T_STRING && value_len >= sizeof(value_buf)) ||
-            (node->type == TS_T_STRING && value_len >= (size_t)node->detail))
-        {
-            return txt_response(TS_STATUS_UNSUPPORTED_FORMAT);
+        if (node->type == TS_T_ARRAY || value.type == JSMN_ARRAY) {
+            if (node->type != TS_T_ARRAY || value.type != JSMN_ARRAY) {
+                return TS_STATUS_UNSUPPORTED_FORMAT;
+            }
+            int res = json_deserialize_array(ctx, tok, node, true);
+            if (res < 0) {
+                return TS_STATUS_REQUEST_TOO_LARGE;
+            }
+            else if (res == 0) {
+                return TS_STATUS_UNSUPPORTED_FORMAT;
+            }
+            tok += res;
+            continue;
         }
-        else {
-            strncpy(value_buf, &json_str[tokens[tok].start], value_len);
+
+        // extract the value and check buffer lengths (strings are checked during deserialization)
+        value_len = value.end - value.start;
+        char *value_str = &ctx->json_str[value.start];
+        if (node->type != TS_T_STRING) {
+            if (value_len >= sizeof(value_buf)) {
+                return TS_STATUS_UNSUPPORTED_FORMAT;
+            }
+            strncpy(value_buf, value_str, value_len);
             value_buf[value_len] = '\0';
+            value_str = value_buf;
         }
 
         // create dummy node to test formats
         uint8_t dummy_data[8];          // enough to fit also 64-bit values
         DataNode dummy_node = {0, 0, "Dummy", (void *)dummy_data, node->type, node->detail};
 
-        int res = json_deserialize_value(value_buf, value_len, tokens[tok].type, &dummy_node);
+        int res = json_deserialize_value(value_str, value_len, value.type, &dummy_node);
         if (res == 0) {
-            return txt_response(TS_STATUS_UNSUPPORTED_FORMAT);
+            return TS_STATUS_UNSUPPORTED_FORMAT;
         }
         tok += res;
     }
 
-    if (tokens[0].type == JSMN_OBJECT) {
+    if (first_type == JSMN_OBJECT) {
         tok = 1;
     }
     else {
@@ -516,72 +1026,103 @@ int ThingSet::txt_patch(node_id_t parent_id)
     }
 
     // actually write data
-    while (tok + 1 < tok_count) {
+    begin_update();
+    while (tok + 1 < ctx->tok_count) {
 
-        const DataNode *node = get_node(json_str + tokens[tok].start,
-            tokens[tok].end - tokens[tok].start, parent_id);
+        jsmntok_t key = json_token(ctx, tok);
+        const DataNode *node = get_node(ctx->json_str + key.start, key.end - key.start, parent_id);
 
         tok++;
 
+        if (node->type == TS_T_ARRAY) {
+            tok += json_deserialize_array(ctx, tok, node, false);
+            continue;
+        }
+
         // extract the value again (max. size was checked before)
-        value_len = tokens[tok].end - tokens[tok].start;
-        if (value_len < sizeof(value_buf)) {
-            strncpy(value_buf, &json_str[tokens[tok].start], value_len);
+        jsmntok_t value = json_token(ctx, tok);
+        value_len = value.end - value.start;
+        char *value_str = &ctx->json_str[value.start];
+        if (node->type != TS_T_STRING) {
+            strncpy(value_buf, value_str, value_len);
             value_buf[value_len] = '\0';
+            value_str = value_buf;
         }
 
-        tok += json_deserialize_value(&json_str[tokens[tok].start], value_len, tokens[tok].type,
-            node);
+        tok += json_deserialize_value(value_str, value_len, value.type, node);
     }
+    end_update();
 
-    return txt_response(TS_STATUS_CHANGED);
+    return TS_STATUS_CHANGED;
 }
 
-int ThingSet::txt_get(const DataNode *parent_node, bool include_values)
+int ThingSet::txt_get(ThingSetContext *ctx, const DataNode *parent_node, bool include_values)
 {
-    // initialize response with success message
-    size_t len = txt_response(TS_STATUS_CONTENT);
+    size_t len;
+    unsigned int start = 0;
+    int nodes_found = 0;
 
     node_id_t parent_node_id = (parent_node == NULL) ? 0 : parent_node->id;
 
-    if (parent_node != NULL && parent_node->type != TS_T_PATH &&
-        parent_node->type != TS_T_EXEC)
-    {
-        // get value of data node
-        resp[len++] = ' ';
-        len += json_serialize_value((char *)&resp[len], resp_size - len, parent_node);
-        resp[--len] = '\0';     // remove trailing comma again
-        return len;
+    if (ctx->step_handler != TS_STEP_NONE) {
+        // continue request from previous step
+        len = ctx->step_pos;
+        start = ctx->step_index;
+        nodes_found = ctx->step_count;
     }
+    else {
+        // initialize response with success message
+        len = txt_response(ctx, TS_STATUS_CONTENT);
 
-    if (parent_node != NULL && parent_node->type == TS_T_EXEC && include_values) {
-        // bad request, as we can't read exec node's values
-        return txt_response(TS_STATUS_BAD_REQUEST);
+        if (parent_node != NULL && parent_node->type != TS_T_PATH &&
+            parent_node->type != TS_T_EXEC)
+        {
+            // get value of data node
+            ctx->resp[len++] = ' ';
+            len += json_serialize_value((char *)&ctx->resp[len], ctx->resp_size - len,
+                parent_node, read_buf(ctx));
+            ctx->resp[--len] = '\0';     // remove trailing comma again
+            return len;
+        }
+
+        if (parent_node != NULL && parent_node->type == TS_T_EXEC && include_values) {
+            // bad request, as we can't read exec node's values
+            return txt_response(ctx, TS_STATUS_BAD_REQUEST);
+        }
+
+        len += sprintf((char *)&ctx->resp[len], include_values ? " {" : " [");
     }
 
-    len += sprintf((char *)&resp[len], include_values ? " {" : " [");
-    int nodes_found = 0;
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if ((data_nodes[i].access & TS_READ_MASK) &&
-            (data_nodes[i].parent == parent_node_id))
-        {
+    for (unsigned int i = next_child(parent_node_id, start); i < num_nodes;
+        i = next_child(parent_node_id, i + 1))
+    {
+        if (data_nodes[i].access & TS_READ_MASK) {
+            if (step_yield(ctx)) {
+                ctx->step_handler = include_values ? TS_STEP_TXT_GET_VALUES :
+                    TS_STEP_TXT_GET_NAMES;
+                ctx->step_index = i;
+                ctx->step_pos = len;
+                ctx->step_count = nodes_found;
+                return TS_PROCESS_PENDING;
+            }
+
             if (include_values) {
                 if (data_nodes[i].type == TS_T_PATH) {
                     // bad request, as we can't read nternal path node's values
-                    return txt_response(TS_STATUS_BAD_REQUEST);
+                    return txt_response(ctx, TS_STATUS_BAD_REQUEST);
                 }
-                len += json_serialize_name_value((char *)&resp[len], resp_size - len,
-                    &data_nodes[i]);
+                len += json_serialize_name_value((char *)&ctx->resp[len], ctx->resp_size - len,
+                    &data_nodes[i], read_buf(ctx));
             }
             else {
-                len += snprintf((char *)&resp[len],
-                    resp_size - len,
+                len += snprintf((char *)&ctx->resp[len],
+                    ctx->resp_size - len,
                     "\"%s\",", data_nodes[i].name);
             }
             nodes_found++;
 
-            if (len >= resp_size - 1) {
-                return txt_response(TS_STATUS_RESPONSE_TOO_LARGE);
+            if (len >= ctx->resp_size - 1) {
+                return txt_response(ctx, TS_STATUS_RESPONSE_TOO_LARGE);
             }
         }
     }
@@ -590,79 +1131,85 @@ int ThingSet::txt_get(const DataNode *parent_node, bool include_values)
     if (nodes_found == 0) {
         len++;
     }
-    resp[len-1] = include_values ? '}' : ']';
-    resp[len] = '\0';
+    ctx->resp[len-1] = include_values ? '}' : ']';
+    ctx->resp[len] = '\0';
 
     return len;
 }
 
-int ThingSet::txt_create(const DataNode *node)
+int ThingSet::txt_create(ThingSetContext *ctx, const DataNode *node)
 {
-    if (tok_count > 1) {
+    if (ctx->tok_count > 1) {
         // only single JSON primitive supported at the moment
-        return txt_response(TS_STATUS_NOT_IMPLEMENTED);
+        return txt_response(ctx, TS_STATUS_NOT_IMPLEMENTED);
     }
 
+    jsmntok_t value = json_token(ctx, 0);
+
     if (node->type == TS_T_ARRAY) {
         ArrayInfo *arr_info = (ArrayInfo *)node->data;
         if (arr_info->num_elements < arr_info->max_elements) {
 
-            if (arr_info->type == TS_T_NODE_ID && tokens[0].type == JSMN_STRING) {
+            if (arr_info->type == TS_T_NODE_ID && value.type == JSMN_STRING) {
 
-                const DataNode *new_node = get_node(json_str + tokens[0].start,
-                    tokens[0].end - tokens[0].start);
+                const DataNode *new_node = get_node(ctx->json_str + value.start,
+                    value.end - value.start);
 
                 if (new_node != NULL) {
                     node_id_t *node_ids = (node_id_t *)arr_info->ptr;
                     // check if node is already existing in array
                     for (int i = 0; i < arr_info->num_elements; i++) {
                         if (node_ids[i] == new_node->id) {
-                            return txt_response(TS_STATUS_CONFLICT);
+                            return txt_response(ctx, TS_STATUS_CONFLICT);
                         }
                     }
                     // otherwise append it
                     node_ids[arr_info->num_elements] = new_node->id;
                     arr_info->num_elements++;
-                    return txt_response(TS_STATUS_CREATED);
+                    return txt_response(ctx, TS_STATUS_CREATED);
                 }
                 else {
-                    return txt_response(TS_STATUS_NOT_FOUND);
+                    return txt_response(ctx, TS_STATUS_NOT_FOUND);
                 }
             }
             else {
-                return txt_response(TS_STATUS_NOT_IMPLEMENTED);
+                return txt_response(ctx, TS_STATUS_NOT_IMPLEMENTED);
             }
         }
         else {
-            return txt_response(TS_STATUS_INTERNAL_SERVER_ERR);
+            return txt_response(ctx, TS_STATUS_INTERNAL_SERVER_ERR);
         }
     }
     else if (node->type == TS_T_PUBSUB) {
-        if (tokens[0].type == JSMN_STRING) {
-            DataNode *del_node = get_node(json_str + tokens[0].start,
-                tokens[0].end - tokens[0].start);
+        if (value.type == JSMN_STRING) {
+            DataNode *del_node = get_node(ctx->json_str + value.start, value.end - value.start);
             if (del_node != NULL) {
                 del_node->pubsub |= (uint16_t)node->detail;
-                return txt_response(TS_STATUS_CREATED);
+#if TS_NODE_INDEX
+                _index_pub_valid = false;
+#endif
+                return txt_response(ctx, TS_STATUS_CREATED);
             }
-            return txt_response(TS_STATUS_NOT_FOUND);
+            return txt_response(ctx, TS_STATUS_NOT_FOUND);
         }
     }
-    return txt_response(TS_STATUS_METHOD_NOT_ALLOWED);
+    return txt_response(ctx, TS_STATUS_METHOD_NOT_ALLOWED);
 }
 
-int ThingSet::txt_delete(const DataNode *node)
+int ThingSet::txt_delete(ThingSetContext *ctx, const DataNode *node)
 {
-    if (tok_count > 1) {
+    if (ctx->tok_count > 1) {
         // only single JSON primitive supported at the moment
-        return txt_response(TS_STATUS_NOT_IMPLEMENTED);
+        return txt_response(ctx, TS_STATUS_NOT_IMPLEMENTED);
     }
 
+    jsmntok_t value = json_token(ctx, 0);
+
     if (node->type == TS_T_ARRAY) {
         ArrayInfo *arr_info = (ArrayInfo *)node->data;
-        if (arr_info->type == TS_T_NODE_ID && tokens[0].type == JSMN_STRING) {
-            const DataNode *del_node = get_node(json_str + tokens[0].start,
-                tokens[0].end - tokens[0].start);
+        if (arr_info->type == TS_T_NODE_ID && value.type == JSMN_STRING) {
+            const DataNode *del_node = get_node(ctx->json_str + value.start,
+                value.end - value.start);
             if (del_node != NULL) {
                 // node found in node database, now look for same ID in the array
                 node_id_t *node_ids = (node_id_t *)arr_info->ptr;
@@ -673,91 +1220,155 @@ int ThingSet::txt_delete(const DataNode *node)
                             node_ids[j] = node_ids[j+1];
                         }
                         arr_info->num_elements--;
-                        return txt_response(TS_STATUS_DELETED);
+                        return txt_response(ctx, TS_STATUS_DELETED);
                     }
                 }
             }
-            return txt_response(TS_STATUS_NOT_FOUND);
+            return txt_response(ctx, TS_STATUS_NOT_FOUND);
         }
         else {
-            return txt_response(TS_STATUS_NOT_IMPLEMENTED);
+            return txt_response(ctx, TS_STATUS_NOT_IMPLEMENTED);
         }
     }
     else if (node->type == TS_T_PUBSUB) {
-        if (tokens[0].type == JSMN_STRING) {
-            DataNode *del_node = get_node(json_str + tokens[0].start,
-                tokens[0].end - tokens[0].start);
+        if (value.type == JSMN_STRING) {
+            DataNode *del_node = get_node(ctx->json_str + value.start, value.end - value.start);
             if (del_node != NULL) {
                 del_node->pubsub &= ~((uint16_t)node->detail);
-                return txt_response(TS_STATUS_DELETED);
+#if TS_NODE_INDEX
+                _index_pub_valid = false;
+#endif
+                return txt_response(ctx, TS_STATUS_DELETED);
             }
-            return txt_response(TS_STATUS_NOT_FOUND);
+            return txt_response(ctx, TS_STATUS_NOT_FOUND);
         }
     }
-    return txt_response(TS_STATUS_METHOD_NOT_ALLOWED);
+    return txt_response(ctx, TS_STATUS_METHOD_NOT_ALLOWED);
 }
 
-int ThingSet::txt_exec(const DataNode *node)
+int ThingSet::txt_exec(ThingSetContext *ctx, const DataNode *node)
 {
     int tok = 0;            // current token
     int nodes_found = 0;    // number of child nodes found
 
-    if (tok_count > 0 && tokens[tok].type == JSMN_ARRAY) {
+    if (ctx->tok_count > 0 && json_token(ctx, tok).type == JSMN_ARRAY) {
         tok++;      // go to first element of array
     }
 
     if ((node->access & TS_WRITE_MASK) && (node->type == TS_T_EXEC)) {
         // node is generally executable, but are we authorized?
-        if ((node->access & TS_WRITE_MASK & _auth_flags) == 0) {
-            return txt_response(TS_STATUS_UNAUTHORIZED);
+        if ((node->access & TS_WRITE_MASK & ctx->auth_flags) == 0) {
+            return txt_response(ctx, TS_STATUS_UNAUTHORIZED);
         }
     }
     else {
-        return txt_response(TS_STATUS_FORBIDDEN);
+        return txt_response(ctx, TS_STATUS_FORBIDDEN);
     }
 
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].parent == node->id) {
-            if (tok >= tok_count) {
-                // more child nodes found than parameters were passed
-                return txt_response(TS_STATUS_BAD_REQUEST);
-            }
-            int res = json_deserialize_value(json_str + tokens[tok].start,
-                tokens[tok].end - tokens[tok].start, tokens[tok].type, &data_nodes[i]);
-            if (res == 0) {
-                // deserializing the value was not successful
-                return txt_response(TS_STATUS_UNSUPPORTED_FORMAT);
-            }
-            tok += res;
-            nodes_found++;
+    // parameters are written to the child nodes, so the call must not fail afterwards
+    if (!reserve_callback(ctx, node)) {
+        return txt_response(ctx, TS_STATUS_SERVICE_UNAVAILABLE);
+    }
+
+    int status = TS_STATUS_VALID;
+    for (unsigned int i = next_child(node->id, 0); i < num_nodes;
+        i = next_child(node->id, i + 1))
+    {
+        if (tok >= ctx->tok_count) {
+            // more child nodes found than parameters were passed
+            status = TS_STATUS_BAD_REQUEST;
+            break;
         }
+        jsmntok_t value = json_token(ctx, tok);
+        int res = json_deserialize_value(ctx->json_str + value.start, value.end - value.start,
+            value.type, &data_nodes[i]);
+        if (res == 0) {
+            // deserializing the value was not successful
+            status = TS_STATUS_UNSUPPORTED_FORMAT;
+            break;
+        }
+        tok += res;
+        nodes_found++;
     }
 
-    if (tok_count > tok) {
+    if (status == TS_STATUS_VALID && ctx->tok_count > tok) {
         // more parameters passed than child nodes found
-        return txt_response(TS_STATUS_BAD_REQUEST);
+        status = TS_STATUS_BAD_REQUEST;
     }
 
-    // if we got here, finally create function pointer and call function
-    void (*fun)(void) = reinterpret_cast<void(*)()>(node->data);
-    fun();
+    // if we got here without error, finally call the function
+    run_callback(ctx, node, status == TS_STATUS_VALID);
+
+    return txt_response(ctx, status);
+}
 
-    return txt_response(TS_STATUS_VALID);
+int ThingSet::txt_pub(char *buf, size_t buf_size, const uint16_t pub_ch, PubDelta *delta)
+{
+#if TS_SEQLOCK || TS_DOUBLE_BUFFER
+    for (int i = 0; i < TS_SNAPSHOT_MAX_ATTEMPTS; i++) {
+        ReadState state;
+        read_begin(&state);
+        int len = txt_pub_nodes(buf, buf_size, pub_ch, delta, state.front);
+        bool valid = read_validate(&state);
+        read_end(&state);
+        if (valid) {
+            return len;
+        }
+        else if (delta != NULL) {
+            delta->count = 0;   // checksums may belong to inconsistent values: refresh all
+        }
+    }
+    buf[0] = '\0';
+    return 0;
+#else
+    return txt_pub_nodes(buf, buf_size, pub_ch, delta, NULL);
+#endif
 }
 
-int ThingSet::txt_pub(char *buf, size_t buf_size, const uint16_t pub_ch)
+int ThingSet::txt_pub_nodes(char *buf, size_t buf_size, const uint16_t pub_ch, PubDelta *delta,
+    const uint8_t *front)
 {
     unsigned int len = sprintf(buf, "# {");
+    bool full_refresh = (delta == NULL || delta->count == 0);
+    int nodes_found = 0;
 
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].pubsub & pub_ch) {
-            len += json_serialize_name_value(&buf[len], buf_size - len, &data_nodes[i]);
+    for (unsigned int i = next_pub_node(pub_ch, 0); i < num_nodes;
+        i = next_pub_node(pub_ch, i + 1))
+    {
+        unsigned int start = len;
+        len += json_serialize_name_value(&buf[len], buf_size - len, &data_nodes[i], front);
+        if (delta != NULL && i < delta->num_checksums && len < buf_size - 1) {
+            uint32_t checksum = _fnv1a_hash(&buf[start], len - start);
+            if (!full_refresh && checksum == delta->checksums[i]) {
+                len = start;    // unchanged: discard again
+                continue;
+            }
+            delta->checksums[i] = checksum;
         }
+        nodes_found++;
         if (len >= buf_size - 1) {
+            if (delta != NULL) {
+                delta->count = 0;   // some checksums were already updated: refresh next time
+            }
             return 0;
         }
     }
+
+    if (delta != NULL) {
+        if (delta->count < UINT16_MAX) {
+            delta->count++;
+        }
+        if (delta->refresh_interval > 0 && delta->count >= delta->refresh_interval) {
+            delta->count = 0;
+        }
+        if (nodes_found == 0) {
+            buf[0] = '\0';
+            return 0;
+        }
+    }
+
     buf[len-1] = '}';    // overwrite comma
+    buf[len] = '\0';     // nodes may have been discarded after the last comma in delta mode
 
     return len;
 }
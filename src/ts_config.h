@@ -18,6 +18,159 @@
 #define TS_NUM_JSON_TOKENS 50
 #endif
 
+/*
+ * Parse JSON requests in streaming mode
+ *
+ * Instead of storing all JSON tokens of a request in an array, each token is parsed on demand
+ * while the handlers walk through the payload. RAM usage stays constant independent of the
+ * payload size and TS_NUM_JSON_TOKENS is not used anymore, but processing of requests with
+ * many tokens is slightly slower.
+ */
+#ifndef TS_JSON_STREAMING
+#define TS_JSON_STREAMING 0
+#endif
+
+/*
+ * Maximum depth of the data node tree printed by dump_json (deeper nodes are skipped)
+ */
+#ifndef TS_DUMP_JSON_MAX_DEPTH
+#define TS_DUMP_JSON_MAX_DEPTH 10
+#endif
+
+/*
+ * Size of the buffer used by dump_json to collect the output. Values longer than the buffer
+ * are printed as null.
+ */
+#ifndef TS_DUMP_JSON_BUF_SIZE
+#define TS_DUMP_JSON_BUF_SIZE 128
+#endif
+
+/*
+ * Protect node values with a sequence lock (seqlock)
+ *
+ * Publication messages are serialized again if node values were updated by a PATCH request
+ * or by the application (see ThingSet::begin_update) at the same time, so each message
+ * contains values from a consistent snapshot. Writers are never blocked.
+ */
+#ifndef TS_SEQLOCK
+#define TS_SEQLOCK 0
+#endif
+
+/*
+ * Enable double buffering of node values (see ThingSet::set_double_buffer)
+ *
+ * A producer like a fast control loop writes to a back buffer and swaps the buffers after each
+ * update cycle. Publication messages and read requests are served from the front buffer, so
+ * the producer never waits for the serialization of messages. A third (spare) buffer makes
+ * sure that the producer never writes to a buffer which is still used by a reader.
+ */
+#ifndef TS_DOUBLE_BUFFER
+#define TS_DOUBLE_BUFFER 0
+#endif
+
+/*
+ * Queue callbacks of exec nodes and paths instead of calling them inside ThingSet::process
+ *
+ * The response is sent immediately and the queued functions are called later from a worker
+ * thread or the main loop via ThingSet::run_deferred_callbacks.
+ */
+#ifndef TS_DEFERRED_CALLBACKS
+#define TS_DEFERRED_CALLBACKS 0
+#endif
+
+/*
+ * Maximum number of callbacks waiting for execution if TS_DEFERRED_CALLBACKS is enabled (must
+ * be a power of two)
+ */
+#ifndef TS_CALLBACK_QUEUE_SIZE
+#define TS_CALLBACK_QUEUE_SIZE 8
+#endif
+
+/*
+ * Queue for node values produced in interrupts or other threads (single producer)
+ *
+ * The updates are written to the data nodes by the thread calling ThingSet::apply_updates.
+ */
+#ifndef TS_UPDATE_QUEUE
+#define TS_UPDATE_QUEUE 0
+#endif
+
+/*
+ * Maximum number of node updates waiting in the queue if TS_UPDATE_QUEUE is enabled
+ */
+#ifndef TS_UPDATE_QUEUE_SIZE
+#define TS_UPDATE_QUEUE_SIZE 16
+#endif
+
+/*
+ * Collect statistics of processed requests (counters and latency histograms), see
+ * ThingSet::set_stats
+ */
+#ifndef TS_STATS
+#define TS_STATS 0
+#endif
+
+/*
+ * Number of buckets of the latency histograms (bucket n counts requests which took less than
+ * 2^n ticks of the cycle counter, the last bucket counts all longer requests)
+ */
+#ifndef TS_STATS_HIST_BUCKETS
+#define TS_STATS_HIST_BUCKETS 16
+#endif
+
+/*
+ * Count the accesses of each data node via ThingSet::get_node (see ThingSet::set_node_profile)
+ */
+#ifndef TS_NODE_PROFILING
+#define TS_NODE_PROFILING 0
+#endif
+
+/*
+ * Maximum number of frequently accessed nodes searched by ThingSet::get_node before the data
+ * nodes array (see ThingSet::set_hot_nodes), 0 to disable the lookaside list
+ */
+#ifndef TS_HOT_NODES
+#define TS_HOT_NODES 0
+#endif
+
+/*
+ * Use lookup structures generated by tools/ts_codegen.py to find nodes by ID or name and to
+ * iterate over child nodes and publication channels (see ThingSet::set_index)
+ */
+#ifndef TS_NODE_INDEX
+#define TS_NODE_INDEX 0
+#endif
+
+/*
+ * Maximum number of attempts to get a consistent snapshot of the node values with seqlock or
+ * double buffer enabled before giving up (e.g. because a writer was interrupted by the
+ * publishing thread). Read requests are answered with Service Unavailable in this case.
+ */
+#ifndef TS_SNAPSHOT_MAX_ATTEMPTS
+#define TS_SNAPSHOT_MAX_ATTEMPTS 10
+#endif
+
+/*
+ * Maximum number of publication channels handled by PubScheduler
+ */
+#ifndef TS_PUB_MAX_CHANNELS
+#define TS_PUB_MAX_CHANNELS 8
+#endif
+
+/*
+ * Number of slots and duration of one slot (tick) of the PubScheduler timer wheel
+ *
+ * Channels with intervals longer than TS_PUB_WHEEL_SLOTS * TS_PUB_WHEEL_TICK_MS stay in the
+ * wheel for multiple rounds.
+ */
+#ifndef TS_PUB_WHEEL_SLOTS
+#define TS_PUB_WHEEL_SLOTS 32
+#endif
+
+#ifndef TS_PUB_WHEEL_TICK_MS
+#define TS_PUB_WHEEL_TICK_MS 10
+#endif
+
 /*
  * If verbose status messages are switched on, a response in text-based mode
  * contains not only the status code, but also a message.
@@ -36,4 +189,19 @@
 #define TS_64BIT_TYPES_SUPPORT 0        // default: no support
 #endif
 
+/*
+ * Storage class of data which is only valid for the current thread (e.g. the context of the
+ * callback being executed)
+ *
+ * Defined as empty on platforms without thread-local storage (like bare-metal targets), where
+ * requests must not be processed by multiple threads at the same time.
+ */
+#ifndef TS_THREAD_LOCAL
+#ifdef NATIVE_BUILD
+#define TS_THREAD_LOCAL thread_local
+#else
+#define TS_THREAD_LOCAL
+#endif
+#endif
+
 #endif /* __TS_CONFIG_H_ */
@@ -11,19 +11,21 @@
 #include "test_functions.h"
 #include "tests.h"
 
-#ifdef __WIN32__
-
-// To avoid compilation error of unit tests
-void setUp (void) {}
-void tearDown (void) {}
-
-#endif
-
 uint8_t req_buf[TS_REQ_BUFFER_LEN];
 uint8_t resp_buf[TS_RESP_BUFFER_LEN];
 
 ThingSet ts(data_nodes, sizeof(data_nodes)/sizeof(DataNode));
 
+void setUp (void) {}
+
+void tearDown (void)
+{
+#if TS_DEFERRED_CALLBACKS
+    // call functions queued by the test, so that the queue never runs full
+    ts.run_deferred_callbacks();
+#endif
+}
+
 int main()
 {
     tests_common();
@@ -35,6 +35,8 @@ static int16_t ambient_temp_max_day = 28;
 // pub
 bool pub_serial_enable = false;
 uint16_t pub_serial_interval = 1000;
+bool pub_serial_on_change = false;
+uint16_t pub_serial_refresh = 10;
 
 bool pub_can_enable = true;
 uint16_t pub_can_interval = 100;
@@ -145,7 +147,7 @@ static DataNode data_nodes[] = {
 
     TS_NODE_EXEC(0xE1, "reset", &reset_function, ID_EXEC, TS_ANY_RW),
 
-    TS_NODE_EXEC(0xE2, "auth", &auth_function, 0, TS_ANY_RW),
+    TS_NODE_EXEC_IMMEDIATE(0xE2, "auth", &auth_function, 0, TS_ANY_RW),
     TS_NODE_STRING(0xE3, "Password", auth_password, sizeof(auth_password), 0xE2, TS_ANY_RW, 0),
 
     // PUBLICATION DATA ///////////////////////////////////////////////////////
@@ -157,6 +159,9 @@ static DataNode data_nodes[] = {
     TS_NODE_BOOL(0xF2, "Enable", &pub_serial_enable, 0xF1, TS_ANY_RW, 0),
     TS_NODE_UINT16(0xF3, "Interval_ms", &pub_serial_interval, 0xF1, TS_ANY_RW, 0),
     TS_NODE_PUBSUB(0xF4, "IDs", PUB_SER, 0xF1, TS_ANY_RW, 0),
+    // publish only changed values, but all values every n-th message
+    TS_NODE_BOOL(0xF9, "OnChange", &pub_serial_on_change, 0xF1, TS_ANY_RW, 0),
+    TS_NODE_UINT16(0xFA, "Refresh", &pub_serial_refresh, 0xF1, TS_ANY_RW, 0),
 
     TS_NODE_PATH(0xF5, "can", ID_PUB, NULL),
     TS_NODE_BOOL(0xF6, "Enable", &pub_can_enable, 0xF5, TS_ANY_RW, 0),
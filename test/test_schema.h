@@ -0,0 +1,135 @@
+/*
+ * Generated by tools/ts_codegen.py from test_schema.json, do not edit
+ */
+
+#ifndef TEST_SCHEMA_H
+#define TEST_SCHEMA_H
+
+#include "thingset.h"
+
+#define PUB_REPORT  (1U << 0)
+#define PUB_STATUS  (1U << 1)
+
+static DataNode schema_nodes[] = {
+    TS_NODE_PATH(0x18, "info", 0, NULL),
+    TS_NODE_STRING(0x19, "Manufacturer", schema_manufacturer, 0, 0x18, TS_ANY_R, 0),
+    TS_NODE_UINT32(0x1A, "Timestamp_s", &schema_timestamp, 0x18, TS_ANY_RW, PUB_REPORT),
+
+    TS_NODE_PATH(0x30, "conf", 0, NULL),
+    TS_NODE_FLOAT(0x31, "Bat_V", &schema_bat_max_voltage, 2, 0x30, TS_ANY_RW, 0),
+    TS_NODE_PATH(0x32, "limits", 0x30, NULL),
+    TS_NODE_FLOAT(0x33, "Bat_A", &schema_bat_max_current, 1, 0x32, TS_ANY_RW, 0),
+    TS_NODE_ARRAY(0x34, "Cells", &schema_cells, 0, 0x32, TS_ANY_RW, PUB_STATUS),
+
+    TS_NODE_PATH(0x70, "output", 0, NULL),
+    TS_NODE_FLOAT(0x71, "Bat_V", &schema_bat_voltage, 2, 0x70, TS_ANY_R, PUB_REPORT | PUB_STATUS),
+    TS_NODE_FLOAT(0x72, "Bat_A", &schema_bat_current, 2, 0x70, TS_ANY_R, PUB_REPORT),
+    TS_NODE_INT16(0x73, "Ambient_degC", &schema_ambient_temp, 0x70, TS_ANY_R, PUB_STATUS),
+    TS_NODE_BOOL(0x74, "Error", &schema_error, 0x70, TS_MKR_R, 0),
+
+    TS_NODE_PATH(0xE0, "exec", 0, NULL),
+    TS_NODE_EXEC(0xE1, "reset", &schema_reset, 0xE0, TS_ANY_RW),
+    TS_NODE_EXEC(0xE2, "calibrate", &schema_reset, 0xE0, TS_ANY_RW),
+    TS_NODE_FLOAT(0xE3, "Offset_V", &schema_offset, 3, 0xE2, TS_ANY_RW, 0),
+
+    TS_NODE_PATH(0xF0, "pub", 0, NULL),
+    TS_NODE_PATH(0xF1, "report", 0xF0, NULL),
+    TS_NODE_BOOL(0xF2, "Enable", &schema_report_enable, 0xF1, TS_ANY_RW, 0),
+    TS_NODE_PUBSUB(0xF3, "IDs", PUB_REPORT, 0xF1, TS_ANY_RW, 0),
+    TS_NODE_PATH(0xF5, "status", 0xF0, NULL),
+    TS_NODE_BOOL(0xF6, "Enable", &schema_status_enable, 0xF5, TS_ANY_RW, 0),
+    TS_NODE_PUBSUB(0xF7, "IDs", PUB_STATUS, 0xF5, TS_ANY_RW, 0),
+};
+
+static const uint16_t schema_id_seeds[] = {
+    1, 2, 0, 0, 3, 4, 1, 0, 28, 3, 0, 6,
+};
+
+static const uint16_t schema_id_offsets[] = {
+    0, 3, 5, 5, 5, 7, 10, 12, 12, 16, 19, 20,
+    24,
+};
+
+static const uint16_t schema_id_slots[] = {
+    22, 7, 6, 18, 8, 10, 20, 1, 12, 14, 17, 9,
+    2, 0, 16, 23, 3, 11, 15, 13, 4, 19, 21, 5,
+};
+
+static const uint16_t schema_name_slots[] = {
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0008, 0x0000, 0xFFFF, 0xFFFF, 0x0001, 0x0004, 0x0009, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0x0016, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0003,
+    0xFFFF, 0x000B, 0xFFFF, 0x0012, 0x000D, 0xFFFF, 0xFFFF, 0xFFFF, 0x000E, 0x000C, 0x000F, 0xFFFF,
+    0x0011, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x000A, 0x0002, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0x0013, 0xFFFF, 0x0005, 0xFFFF, 0xFFFF, 0x0007, 0xFFFF, 0x0006, 0x0017,
+    0xFFFF, 0x0010, 0x0014, 0x0015,
+};
+
+static const uint16_t schema_child_offsets[] = {
+    0, 2, 2, 2, 4, 4, 6, 6, 6, 10, 10, 10,
+    10, 10, 12, 12, 13, 13, 15, 17, 17, 17, 19, 19,
+    19, 24,
+};
+
+static const uint16_t schema_children[] = {
+    1, 2, 4, 5, 6, 7, 9, 10, 11, 12, 14, 15,
+    16, 18, 21, 19, 20, 22, 23, 0, 3, 8, 13, 17,
+};
+
+static const uint16_t schema_pub_channels[] = {
+    0x0001, 0x0002,
+};
+
+static const uint16_t schema_pub_offsets[] = {
+    0, 3, 6,
+};
+
+static const uint16_t schema_pub_nodes[] = {
+    2, 9, 10, 7, 9, 11,
+};
+
+static const uint8_t schema_cbor_keys[] = {
+    0x18, 0x18, 0x64, 0x69, 0x6E, 0x66, 0x6F, 0x18, 0x19, 0x6C, 0x4D, 0x61,
+    0x6E, 0x75, 0x66, 0x61, 0x63, 0x74, 0x75, 0x72, 0x65, 0x72, 0x18, 0x1A,
+    0x6B, 0x54, 0x69, 0x6D, 0x65, 0x73, 0x74, 0x61, 0x6D, 0x70, 0x5F, 0x73,
+    0x18, 0x30, 0x64, 0x63, 0x6F, 0x6E, 0x66, 0x18, 0x31, 0x65, 0x42, 0x61,
+    0x74, 0x5F, 0x56, 0x18, 0x32, 0x66, 0x6C, 0x69, 0x6D, 0x69, 0x74, 0x73,
+    0x18, 0x33, 0x65, 0x42, 0x61, 0x74, 0x5F, 0x41, 0x18, 0x34, 0x65, 0x43,
+    0x65, 0x6C, 0x6C, 0x73, 0x18, 0x70, 0x66, 0x6F, 0x75, 0x74, 0x70, 0x75,
+    0x74, 0x18, 0x71, 0x65, 0x42, 0x61, 0x74, 0x5F, 0x56, 0x18, 0x72, 0x65,
+    0x42, 0x61, 0x74, 0x5F, 0x41, 0x18, 0x73, 0x6C, 0x41, 0x6D, 0x62, 0x69,
+    0x65, 0x6E, 0x74, 0x5F, 0x64, 0x65, 0x67, 0x43, 0x18, 0x74, 0x65, 0x45,
+    0x72, 0x72, 0x6F, 0x72, 0x18, 0xE0, 0x64, 0x65, 0x78, 0x65, 0x63, 0x18,
+    0xE1, 0x65, 0x72, 0x65, 0x73, 0x65, 0x74, 0x18, 0xE2, 0x69, 0x63, 0x61,
+    0x6C, 0x69, 0x62, 0x72, 0x61, 0x74, 0x65, 0x18, 0xE3, 0x68, 0x4F, 0x66,
+    0x66, 0x73, 0x65, 0x74, 0x5F, 0x56, 0x18, 0xF0, 0x63, 0x70, 0x75, 0x62,
+    0x18, 0xF1, 0x66, 0x72, 0x65, 0x70, 0x6F, 0x72, 0x74, 0x18, 0xF2, 0x66,
+    0x45, 0x6E, 0x61, 0x62, 0x6C, 0x65, 0x18, 0xF3, 0x63, 0x49, 0x44, 0x73,
+    0x18, 0xF5, 0x66, 0x73, 0x74, 0x61, 0x74, 0x75, 0x73, 0x18, 0xF6, 0x66,
+    0x45, 0x6E, 0x61, 0x62, 0x6C, 0x65, 0x18, 0xF7, 0x63, 0x49, 0x44, 0x73,
+};
+
+static const uint16_t schema_cbor_key_offsets[] = {
+    0, 7, 22, 36, 43, 51, 60, 68, 76, 85, 93, 101,
+    116, 124, 131, 139, 151, 162, 168, 177, 186, 192, 201, 210,
+    216,
+};
+
+static const ThingSetIndex schema_index = {
+    24,                             // num_nodes
+    12,                             // num_id_buckets
+    schema_id_seeds,                // id_seeds
+    schema_id_offsets,              // id_offsets
+    schema_id_slots,                // id_slots
+    0x003F,                         // name_mask
+    schema_name_slots,              // name_slots
+    schema_child_offsets,           // child_offsets
+    schema_children,                // children
+    2,                              // num_pub_channels
+    schema_pub_channels,            // pub_channels
+    schema_pub_offsets,             // pub_offsets
+    schema_pub_nodes,               // pub_nodes
+    schema_cbor_keys,               // cbor_keys
+    schema_cbor_key_offsets,        // cbor_key_offsets
+};
+
+#endif /* TEST_SCHEMA_H */
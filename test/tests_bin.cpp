@@ -325,6 +325,9 @@ void test_bin_exec()
     ts.process(req, sizeof(req), resp, sizeof(resp));
 
     TEST_ASSERT_EQUAL_HEX8(TS_STATUS_VALID, resp[0]);
+#if TS_DEFERRED_CALLBACKS
+    ts.run_deferred_callbacks();
+#endif
     TEST_ASSERT_EQUAL(1, dummy_called_flag);
 }
 
@@ -355,6 +358,114 @@ void test_bin_serialize_long_string()
     TEST_ASSERT_EQUAL_UINT(0x2B, buf[2]);
 }
 
+void test_bin_process_steps()
+{
+    uint8_t get_names_values[] = { TS_GET, 0x18, ID_OUTPUT, 0xA0 };
+    uint8_t fetch_multiple[] = { TS_FETCH, 0x18, ID_CONF, 0x83, 0x19, 0x60, 0x04, 0x19, 0x60,
+        0x07, 0x19, 0x60, 0x05 };
+    uint8_t resp_expected[TS_RESP_BUFFER_LEN];
+    uint8_t resp[TS_RESP_BUFFER_LEN];
+
+    uint8_t *requests[] = { get_names_values, fetch_multiple };
+    size_t requests_len[] = { sizeof(get_names_values), sizeof(fetch_multiple) };
+
+    for (int i = 0; i < 2; i++) {
+        int len_expected = ts.process(requests[i], requests_len[i], resp_expected,
+            sizeof(resp_expected));
+
+        ThingSetContext ctx;
+        int steps = 0;
+        int resp_len;
+        ts.process_start(requests[i], requests_len[i], resp, sizeof(resp), &ctx);
+        do {
+            resp_len = ts.process_step(1, &ctx);
+            steps++;
+        } while (resp_len == TS_PROCESS_PENDING && steps < 100);
+
+        TEST_ASSERT_EQUAL(len_expected, resp_len);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(resp_expected, resp, len_expected);
+        TEST_ASSERT_GREATER_THAN(2, steps);
+    }
+}
+
+void test_bin_cbor_fast_paths()
+{
+    int64_t values[] = { 0, 1, 23, 24, 255, 256, 0x7FFF, 0x8000, 0xFFFF, 0x10000, INT32_MAX,
+        0x80000000LL, 0xFFFFFFFFLL, 0x100000000LL, INT64_MAX };
+    uint8_t ref[10];
+    uint8_t fast[10];
+
+    for (unsigned int i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        for (int sign = 0; sign < 2; sign++) {
+            int64_t value = sign ? -1 - values[i] : values[i];
+            for (size_t max_len = 0; max_len <= 9; max_len++) {
+                int len = cbor_serialize_int(ref, value, max_len);
+                TEST_ASSERT_EQUAL(len, cbor_serialize_int_fast(fast, value, max_len));
+                TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, fast, len);
+                if (sign == 0) {
+                    len = cbor_serialize_uint(ref, value, max_len);
+                    TEST_ASSERT_EQUAL(len, cbor_serialize_uint_fast(fast, value, max_len));
+                    TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, fast, len);
+                }
+            }
+
+            cbor_serialize_int(ref, value, sizeof(ref));
+
+            uint64_t ui64_ref = 0, ui64_fast = 0;
+            TEST_ASSERT_EQUAL(_cbor_uint_data(ref, &ui64_ref),
+                _cbor_uint_data_fast(ref, &ui64_fast));
+            TEST_ASSERT_TRUE(ui64_ref == ui64_fast);
+
+            TEST_ASSERT_EQUAL(cbor_deserialize_uint64(ref, &ui64_ref),
+                cbor_deserialize_uint64_fast(ref, &ui64_fast));
+            TEST_ASSERT_TRUE(ui64_ref == ui64_fast);
+
+            int64_t i64_ref = 0, i64_fast = 0;
+            TEST_ASSERT_EQUAL(cbor_deserialize_int64(ref, &i64_ref),
+                cbor_deserialize_int64_fast(ref, &i64_fast));
+            TEST_ASSERT_TRUE(i64_ref == i64_fast);
+
+            uint32_t ui32_ref = 0, ui32_fast = 0;
+            TEST_ASSERT_EQUAL(cbor_deserialize_uint32(ref, &ui32_ref),
+                cbor_deserialize_uint32_fast(ref, &ui32_fast));
+            TEST_ASSERT_EQUAL_UINT32(ui32_ref, ui32_fast);
+
+            int32_t i32_ref = 0, i32_fast = 0;
+            TEST_ASSERT_EQUAL(cbor_deserialize_int32(ref, &i32_ref),
+                cbor_deserialize_int32_fast(ref, &i32_fast));
+            TEST_ASSERT_EQUAL_INT32(i32_ref, i32_fast);
+
+            uint16_t ui16_ref = 0, ui16_fast = 0;
+            TEST_ASSERT_EQUAL(cbor_deserialize_uint16(ref, &ui16_ref),
+                cbor_deserialize_uint16_fast(ref, &ui16_fast));
+            TEST_ASSERT_EQUAL_UINT16(ui16_ref, ui16_fast);
+
+            int16_t i16_ref = 0, i16_fast = 0;
+            TEST_ASSERT_EQUAL(cbor_deserialize_int16(ref, &i16_ref),
+                cbor_deserialize_int16_fast(ref, &i16_fast));
+            TEST_ASSERT_EQUAL_INT16(i16_ref, i16_fast);
+
+            float f_ref = 0, f_fast = 0;
+            int len = cbor_deserialize_float(ref, &f_ref);
+            TEST_ASSERT_EQUAL(len, cbor_deserialize_float_fast(ref, &f_fast));
+            if (len > 0) {
+                TEST_ASSERT_EQUAL_FLOAT(f_ref, f_fast);
+            }
+        }
+    }
+
+    float floats[] = { 0.0F, -0.0F, 1.5F, -52.8F, 3.4e38F, 1e-40F };
+    for (unsigned int i = 0; i < sizeof(floats) / sizeof(floats[0]); i++) {
+        int len = cbor_serialize_float(ref, floats[i], sizeof(ref));
+        TEST_ASSERT_EQUAL(len, cbor_serialize_float_fast(fast, floats[i], sizeof(fast)));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, fast, len);
+
+        float f_fast;
+        TEST_ASSERT_EQUAL(5, cbor_deserialize_float_fast(ref, &f_fast));
+        TEST_ASSERT_EQUAL_MEMORY(&floats[i], &f_fast, sizeof(float));
+    }
+}
+
 void tests_binary_mode()
 {
     UNITY_BEGIN();
@@ -385,6 +496,8 @@ void tests_binary_mode()
     // general tests
     RUN_TEST(test_bin_num_elem);
     RUN_TEST(test_bin_serialize_long_string);
+    RUN_TEST(test_bin_process_steps);
+    RUN_TEST(test_bin_cbor_fast_paths);
 
     UNITY_END();
 }
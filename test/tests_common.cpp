@@ -8,16 +8,40 @@
 #include "unity.h"
 
 #include "thingset.h"
+#include "pub_scheduler.h"
+#include "thingset_server.h"
+#include "thingset_gateway.h"
+#include "thingset_capture.h"
+#include "thingset_id_hash.h"
+#include "random_tree.h"
+#include "stack_usage.h"
 #include "cbor.h"
 
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#if defined(__linux__) && defined(NATIVE_BUILD)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#endif
+
 extern uint8_t req_buf[];
 extern uint8_t resp_buf[];
 extern ThingSet ts;
 
+extern int32_t i32;
+
+extern bool pub_serial_enable;
+extern uint16_t pub_serial_interval;
+
 int hex2bin(char *const hex, uint8_t *bin, size_t bin_size)
 {
     int len = strlen(hex);
@@ -39,6 +63,10 @@ void _txt_patch(char const *name, char const *value)
     int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
     TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
     TEST_ASSERT_EQUAL_STRING(":84 Changed.", resp_buf);
+
+#if TS_DEFERRED_CALLBACKS
+    ts.run_deferred_callbacks();    // callback of conf path
+#endif
 }
 
 int _txt_fetch(char const *name, char *value_read)
@@ -92,6 +120,10 @@ void _bin_patch(uint16_t id, char *value)
     memcpy(req + 7, value, len);
     ts.process(req, len + 7, resp_buf, TS_RESP_BUFFER_LEN);
     TEST_ASSERT_EQUAL_HEX8(TS_STATUS_CHANGED, resp_buf[0]);
+
+#if TS_DEFERRED_CALLBACKS
+    ts.run_deferred_callbacks();    // callback of conf path
+#endif
 }
 
 void _json2cbor(char const *name, char const *json_value, uint16_t id, const char *const cbor_value_hex)
@@ -308,6 +340,961 @@ void bin_patch_txt_fetch()
     _cbor2json("strbuf", "\"Hello World!\"",  0x6009, "6c 48 65 6c 6c 6f 20 57 6f 72 6c 64 21");
 }
 
+void pub_scheduler_channels()
+{
+    PubScheduler scheduler(&ts);
+    uint32_t wait_ms;
+
+    TEST_ASSERT_EQUAL(2, scheduler.get_num_channels());
+
+    // all enabled channels due at first call
+    pub_serial_enable = true;
+    TEST_ASSERT_EQUAL(PUB_SER | PUB_CAN, scheduler.poll(1000, &wait_ms));
+    TEST_ASSERT_EQUAL(100, wait_ms);
+
+    TEST_ASSERT_EQUAL(0, scheduler.poll(1099, &wait_ms));
+    TEST_ASSERT_EQUAL(1, wait_ms);
+    TEST_ASSERT_EQUAL(PUB_CAN, scheduler.poll(1100, &wait_ms));
+    TEST_ASSERT_EQUAL(100, wait_ms);
+
+    // delayed call does not shift the following due times
+    TEST_ASSERT_EQUAL(PUB_CAN, scheduler.poll(1230, &wait_ms));
+    TEST_ASSERT_EQUAL(70, wait_ms);
+    TEST_ASSERT_EQUAL(PUB_CAN, scheduler.poll(1300, &wait_ms));
+
+    // changed interval is applied immediately
+    pub_serial_interval = 500;
+    TEST_ASSERT_EQUAL(PUB_CAN, scheduler.poll(1400, &wait_ms));
+    TEST_ASSERT_EQUAL(100, wait_ms);
+    TEST_ASSERT_EQUAL(PUB_SER | PUB_CAN, scheduler.poll(1500, &wait_ms));
+
+    // disabled channel is not published, missed publications are skipped
+    pub_serial_enable = false;
+    TEST_ASSERT_EQUAL(PUB_CAN, scheduler.poll(5010, &wait_ms));
+    TEST_ASSERT_EQUAL(100, wait_ms);
+
+    pub_serial_interval = 1000;
+}
+
+#if defined(__linux__) && defined(NATIVE_BUILD)
+
+void server_requests()
+{
+    const char *path = "/tmp/thingset_test.sock";
+    ThingSetServer server(&ts, 2);
+    i32 = 32;
+
+    TEST_ASSERT_EQUAL(0, server.listen_unix(path));
+    std::thread server_thread(&ThingSetServer::run, &server);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    TEST_ASSERT_EQUAL(0, connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+
+    // text mode request terminated by newline (preceded by blank lines)
+    const char txt_req[] = "\n\r\n?conf \"i32\"\n";
+    TEST_ASSERT_EQUAL(strlen(txt_req), write(fd, txt_req, strlen(txt_req)));
+
+    char txt_resp[100];
+    size_t pos = 0;
+    while (pos == 0 || txt_resp[pos - 1] != '\n') {
+        ssize_t len = read(fd, txt_resp + pos, sizeof(txt_resp) - 1 - pos);
+        TEST_ASSERT_GREATER_THAN(0, len);
+        pos += len;
+    }
+    txt_resp[pos] = '\0';
+    TEST_ASSERT_EQUAL_STRING(":85 Content. 32\n", txt_resp);
+
+    // binary mode request with length prefix
+    const uint8_t bin_req[] = { 0x00, 0x06, TS_FETCH, 0x18, ID_CONF, 0x19, 0x60, 0x04 };
+    TEST_ASSERT_EQUAL(sizeof(bin_req), write(fd, bin_req, sizeof(bin_req)));
+
+    uint8_t bin_resp[10];
+    pos = 0;
+    while (pos < 2 || pos < 2 + (size_t)(bin_resp[0] << 8 | bin_resp[1])) {
+        ssize_t len = read(fd, bin_resp + pos, sizeof(bin_resp) - pos);
+        TEST_ASSERT_GREATER_THAN(0, len);
+        pos += len;
+    }
+    const uint8_t bin_resp_expected[] = { 0x00, 0x03, TS_STATUS_CONTENT, 0x18, 0x20 };
+    TEST_ASSERT_EQUAL(sizeof(bin_resp_expected), pos);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(bin_resp_expected, bin_resp, sizeof(bin_resp_expected));
+
+    // blank lines as keep-alive exceeding the maximum request size don't close the connection
+    char blank_lines[TS_SERVER_MAX_REQ_SIZE + 100];
+    memset(blank_lines, '\n', sizeof(blank_lines));
+    TEST_ASSERT_EQUAL(sizeof(blank_lines), write(fd, blank_lines, sizeof(blank_lines)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));   // received separately
+
+    // pipelined requests exceeding the buffer limits are answered after the client reads
+    const int num_reqs = 2 * TS_SERVER_MAX_BUF_SIZE / (sizeof(txt_req) - 4) + 1;
+    std::thread writer([&]() {
+        for (int i = 0; i < num_reqs; i++) {
+            send(fd, txt_req + 3, strlen(txt_req) - 3, MSG_NOSIGNAL);
+        }
+    });
+    int num_resps = 0;
+    while (num_resps < num_reqs) {
+        ssize_t len = read(fd, txt_resp, sizeof(txt_resp));
+        TEST_ASSERT_GREATER_THAN(0, len);
+        for (ssize_t i = 0; i < len; i++) {
+            num_resps += (txt_resp[i] == '\n');
+        }
+    }
+    writer.join();
+    TEST_ASSERT_EQUAL(num_reqs, num_resps);
+    TEST_ASSERT_EQUAL(1, server.get_num_connections());
+
+    close(fd);
+    server.stop();
+    server_thread.join();
+}
+
+static ThingSet *cb_ts;
+static std::atomic<int> cb_state;
+
+static void cb_wait_and_auth()
+{
+    cb_state = 1;
+    while (cb_state != 2) {
+        std::this_thread::yield();
+    }
+    cb_ts->set_authentication(TS_EXP_MASK | TS_USR_MASK);
+    cb_state = 3;
+}
+
+static void cb_auth_maker()
+{
+    cb_state = 2;
+    while (cb_state != 3) {
+        std::this_thread::yield();
+    }
+    cb_ts->set_authentication(TS_MKR_MASK | TS_USR_MASK);
+}
+
+void callback_context_threads()
+{
+    DataNode nodes[] = {
+        TS_NODE_EXEC(0x10, "wait", &cb_wait_and_auth, 0, TS_ANY_RW),
+        TS_NODE_EXEC(0x11, "maker", &cb_auth_maker, 0, TS_ANY_RW),
+    };
+    ThingSet ts_local(nodes, sizeof(nodes) / sizeof(DataNode));
+    cb_ts = &ts_local;
+    cb_state = 0;
+
+    ThingSetContext ctx_wait;
+    ThingSetContext ctx_maker;
+    std::thread wait_thread([&]() {
+        uint8_t req[] = "!wait";
+        uint8_t resp[50];
+        ts_local.process(req, sizeof(req) - 1, resp, sizeof(resp), &ctx_wait);
+    });
+    while (cb_state != 1) {
+        std::this_thread::yield();
+    }
+
+    // both callbacks are running at the same time in different threads
+    uint8_t req[] = "!maker";
+    uint8_t resp[50];
+    ts_local.process(req, sizeof(req) - 1, resp, sizeof(resp), &ctx_maker);
+    wait_thread.join();
+
+    TEST_ASSERT_EQUAL_HEX16(TS_EXP_MASK | TS_USR_MASK, ctx_wait.auth_flags);
+    TEST_ASSERT_EQUAL_HEX16(TS_MKR_MASK | TS_USR_MASK, ctx_maker.auth_flags);
+}
+
+void capture_records()
+{
+    const char *path = "/tmp/thingset_test_capture.bin";
+    ThingSetRecorder recorder(&ts);
+    uint8_t resp[100];
+    i32 = 32;
+
+    TEST_ASSERT_EQUAL(0, recorder.open(path));
+
+    char txt_req[] = "?conf \"i32\"";
+    int txt_len = recorder.process((uint8_t *)txt_req, strlen(txt_req), resp, sizeof(resp));
+    TEST_ASSERT_EQUAL_STRING(":85 Content. 32", (char *)resp);
+
+    uint8_t bin_req[] = { TS_FETCH, 0x18, ID_CONF, 0x19, 0x60, 0x04 };
+    ThingSetContext ctx;
+    int bin_len = recorder.process(bin_req, sizeof(bin_req), resp, sizeof(resp), &ctx, 7);
+    TEST_ASSERT_EQUAL(3, bin_len);
+
+    TEST_ASSERT_EQUAL(2, recorder.get_num_records());
+    recorder.close();
+
+    ThingSetCaptureReader reader;
+    CaptureRecord rec;
+    TEST_ASSERT_EQUAL(0, reader.open(path));
+
+    TEST_ASSERT_TRUE(reader.read(&rec));
+    uint64_t first_timestamp = rec.timestamp_ns;
+    TEST_ASSERT_EQUAL(0, rec.conn_id);
+    TEST_ASSERT_EQUAL(strlen(txt_req), rec.req.size());
+    TEST_ASSERT_EQUAL_MEMORY("?conf \"i32\"", rec.req.data(), rec.req.size());
+    TEST_ASSERT_EQUAL(txt_len, rec.resp.size());
+    TEST_ASSERT_EQUAL_MEMORY(":85 Content. 32", rec.resp.data(), rec.resp.size());
+
+    TEST_ASSERT_TRUE(reader.read(&rec));
+    TEST_ASSERT_TRUE(rec.timestamp_ns >= first_timestamp);
+    TEST_ASSERT_EQUAL(7, rec.conn_id);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(bin_req, rec.req.data(), sizeof(bin_req));
+    const uint8_t bin_resp_expected[] = { TS_STATUS_CONTENT, 0x18, 0x20 };
+    TEST_ASSERT_EQUAL(sizeof(bin_resp_expected), rec.resp.size());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(bin_resp_expected, rec.resp.data(), sizeof(bin_resp_expected));
+
+    TEST_ASSERT_FALSE(reader.read(&rec));
+    reader.close();
+
+    // files without valid header are rejected
+    FILE *f = fopen(path, "wb");
+    fputs("?conf\n", f);
+    fclose(f);
+    TEST_ASSERT_EQUAL(-1, reader.open(path));
+
+    remove(path);
+}
+
+void random_tree()
+{
+    RandomTreeConfig config;
+    config.seed = 42;
+    config.num_nodes = 500;
+    config.max_depth = 4;
+    config.num_pub_channels = 3;
+
+    RandomTree tree(config);
+    RandomTree same(config);
+    config.seed = 43;
+    RandomTree other(config);
+
+    // 500 generated nodes plus path "pub" and 4 nodes per channel
+    TEST_ASSERT_EQUAL(500 + 1 + 3 * 4, tree.nodes.size());
+    TEST_ASSERT_EQUAL(3, tree.pub_channels.size());
+    TEST_ASSERT_EQUAL(500, tree.paths.size() + tree.values.size());
+
+    // trees are reproducible for the same seed
+    bool differs = false;
+    for (size_t i = 0; i < tree.nodes.size(); i++) {
+        TEST_ASSERT_EQUAL(tree.nodes[i].id, same.nodes[i].id);
+        TEST_ASSERT_EQUAL(tree.nodes[i].type, same.nodes[i].type);
+        TEST_ASSERT_EQUAL(tree.nodes[i].parent, same.nodes[i].parent);
+        differs |= tree.nodes[i].type != other.nodes[i].type ||
+            tree.nodes[i].parent != other.nodes[i].parent;
+    }
+    TEST_ASSERT_TRUE(differs);
+
+    // all parents exist and the depth is limited
+    int max_depth = 0;
+    for (size_t i = 0; i < tree.values.size(); i++) {
+        const DataNode *node = tree.ts->get_node(tree.values[i]);
+        int depth = 0;
+        while (node->parent != 0) {
+            node = tree.ts->get_node(node->parent);
+            TEST_ASSERT_NOT_NULL(node);
+            TEST_ASSERT_EQUAL(TS_T_PATH, node->type);
+            depth++;
+        }
+        max_depth = (depth > max_depth) ? depth : max_depth;
+    }
+    TEST_ASSERT_EQUAL(config.max_depth, max_depth);
+
+    // all paths can be read via full path names
+    static uint8_t resp[4096];
+    for (size_t i = 0; i < tree.paths.size(); i++) {
+        std::string req = "?" + tree.path(tree.paths[i]) + "/";
+        tree.ts->process((uint8_t *)&req[0], req.size(), resp, sizeof(resp));
+        TEST_ASSERT_EQUAL_MEMORY(":85", resp, 3);
+    }
+
+    TEST_ASSERT_GREATER_THAN(0, tree.ts->txt_pub((char *)resp, sizeof(resp),
+        tree.pub_channels[0]));
+
+    // small trees contain at least one value node
+    config.num_nodes = 2;
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        config.seed = seed;
+        RandomTree small(config);
+        TEST_ASSERT_EQUAL(1, small.values.size());
+    }
+}
+
+struct GatewayTestDevice {
+    int32_t value;
+    DataNode nodes[2] = {
+        TS_NODE_PATH(ID_CONF, "conf", 0, NULL),
+        TS_NODE_INT32(0x6004, "i32", &value, ID_CONF, TS_ANY_RW, 0),
+    };
+    ThingSet ts{nodes, 2};
+};
+
+void gateway_routing()
+{
+    const int num_devices = 16;
+    static GatewayTestDevice devices[num_devices];
+    ThingSetGateway gateway(4);
+
+    for (int i = 0; i < num_devices; i++) {
+        devices[i].value = i * 10;
+        TEST_ASSERT_EQUAL(i % 4, gateway.add_device(0x10 + i, &devices[i].ts));
+    }
+    TEST_ASSERT_EQUAL(-1, gateway.add_device(0x10, &devices[1].ts));
+    TEST_ASSERT_EQUAL_PTR(&devices[2].ts, gateway.get_device(0x12));
+
+    // requests are rejected instead of blocking if no worker thread is running
+    uint8_t patch_req[] = "=conf {\"i32\":-5}";
+    uint8_t resp[50];
+    TEST_ASSERT_EQUAL(-1, gateway.process(0x13, patch_req, sizeof(patch_req) - 1, resp,
+        sizeof(resp)));
+
+    gateway.start();
+
+    // each client thread accesses all devices
+    std::atomic<int> errors(0);
+    std::vector<std::thread> clients;
+    for (int t = 0; t < 4; t++) {
+        clients.push_back(std::thread([&gateway, &errors]() {
+            uint8_t req[] = "?conf \"i32\"";
+            uint8_t resp[50];
+            char expected[50];
+            for (int n = 0; n < 50; n++) {
+                for (int i = 0; i < num_devices; i++) {
+                    int len = gateway.process(0x10 + i, req, sizeof(req) - 1, resp,
+                        sizeof(resp) - 1);
+                    resp[len > 0 ? len : 0] = '\0';
+                    snprintf(expected, sizeof(expected), ":85 Content. %d", i * 10);
+                    if (strcmp((char *)resp, expected) != 0) {
+                        errors++;
+                    }
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < clients.size(); t++) {
+        clients[t].join();
+    }
+    TEST_ASSERT_EQUAL(0, errors);
+
+    // asynchronous request
+    bool changed = false;
+    TEST_ASSERT_TRUE(gateway.submit(0x13, patch_req, sizeof(patch_req) - 1,
+        [&changed](const uint8_t *resp, int resp_len) {
+            changed = (resp_len > 3 && strncmp((const char *)resp, ":84", 3) == 0);
+        }));
+
+    TEST_ASSERT_EQUAL(-1, gateway.process(0x40, patch_req, sizeof(patch_req) - 1, resp,
+        sizeof(resp)));
+
+    gateway.stop();     // processes remaining requests
+    TEST_ASSERT_TRUE(changed);
+    TEST_ASSERT_EQUAL(-5, devices[3].value);
+    TEST_ASSERT_EQUAL(20, devices[2].value);
+
+    TEST_ASSERT_FALSE(gateway.submit(0x12, patch_req, sizeof(patch_req) - 1, NULL));
+    TEST_ASSERT_EQUAL(-1, gateway.process(0x12, patch_req, sizeof(patch_req) - 1, resp,
+        sizeof(resp)));
+    TEST_ASSERT_EQUAL(20, devices[2].value);
+}
+
+#if TS_DOUBLE_BUFFER
+struct DoubleBufferTestValues {
+    int32_t a;
+    int32_t b;
+};
+
+void double_buffer_readers()
+{
+    // values of one update cycle are always equal
+    static DoubleBufferTestValues front, back, spare;
+    DataNode nodes[] = {
+        TS_NODE_PATH(0x70, "meas", 0, NULL),
+        TS_NODE_INT32(0x71, "a", &front.a, 0x70, TS_ANY_R, 1),
+        TS_NODE_INT32(0x72, "b", &front.b, 0x70, TS_ANY_R, 1),
+    };
+    ThingSet dbts(nodes, sizeof(nodes) / sizeof(DataNode));
+    dbts.set_double_buffer(&front, &back, &spare, sizeof(front));
+
+    std::atomic<bool> done(false);
+    std::thread producer([&dbts, &done]() {
+        for (int32_t n = 1; n <= 20000; n++) {
+            DoubleBufferTestValues *values = (DoubleBufferTestValues *)dbts.get_back_buffer();
+            values->a = n;
+            values->b = n;
+            while (!dbts.swap_buffers()) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+    });
+
+    // publication and requests read at the same time with separately acquired buffers
+    std::atomic<int> errors(0);
+    std::thread publisher([&dbts, &done, &errors]() {
+        char msg[100];
+        int a, b;
+        while (!done) {
+            dbts.txt_pub(msg, sizeof(msg), 1);
+            if (sscanf(msg, "# {\"a\":%d,\"b\":%d}", &a, &b) != 2 || a != b) {
+                errors++;
+            }
+        }
+    });
+
+    uint8_t req[] = "?meas";
+    char resp[100];
+    int a, b;
+    while (!done) {
+        int len = dbts.process(req, sizeof(req) - 1, (uint8_t *)resp, sizeof(resp) - 1);
+        resp[len > 0 ? len : 0] = '\0';
+        if (sscanf(resp, ":85 Content. {\"a\":%d,\"b\":%d}", &a, &b) != 2 || a != b) {
+            errors++;
+        }
+    }
+    producer.join();
+    publisher.join();
+    TEST_ASSERT_EQUAL(0, errors);
+}
+#endif
+
+#if !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+
+/*
+ * Stack budgets of the request paths in bytes (without thread startup overhead), chosen with
+ * some margin above the usage of unoptimized native builds
+ */
+#define STACK_BUDGET_TXT_GET        4400
+#define STACK_BUDGET_TXT_FETCH      3700
+#define STACK_BUDGET_TXT_PATCH      4096
+#define STACK_BUDGET_TXT_EXEC       3000
+#define STACK_BUDGET_BIN_GET        512
+#define STACK_BUDGET_BIN_FETCH      512
+#define STACK_BUDGET_BIN_PATCH      512
+#define STACK_BUDGET_BIN_EXEC       512
+#define STACK_BUDGET_TXT_PUB        3600
+#define STACK_BUDGET_BIN_PUB        384
+#define STACK_BUDGET_DUMP_JSON      3800
+
+/*
+ * RAM budgets of the ThingSet object (without the internal context) and the context
+ */
+#define RAM_BUDGET_THINGSET (64 + TS_DOUBLE_BUFFER * (4 * sizeof(void *) + 24) \
+    + TS_DEFERRED_CALLBACKS * (TS_CALLBACK_QUEUE_SIZE * 2 * sizeof(void *) + 16) \
+    + TS_UPDATE_QUEUE * (TS_UPDATE_QUEUE_SIZE * 8 + 16) \
+    + TS_NODE_PROFILING * sizeof(void *) \
+    + (TS_HOT_NODES > 0) * (TS_HOT_NODES + 1) * sizeof(void *) \
+    + TS_NODE_INDEX * 2 * sizeof(void *))
+
+#define RAM_BUDGET_CONTEXT  (128 \
+    + (1 - TS_JSON_STREAMING) * TS_NUM_JSON_TOKENS * sizeof(jsmntok_t) \
+    + TS_DOUBLE_BUFFER * sizeof(void *))
+
+static void budget_exec()
+{
+}
+
+static void budget_dump_discard(const char *buf, size_t len, void *arg)
+{
+}
+
+static void _check_stack(const char *name, int depth, size_t budget, std::function<void()> fn)
+{
+    size_t used = stack_usage(fn);
+    if (used == 0 || used > budget) {
+        char msg[100];
+        snprintf(msg, sizeof(msg), "%s (depth %d): %zu bytes used, budget %zu", name, depth,
+            used, budget);
+        TEST_FAIL_MESSAGE(msg);
+    }
+}
+
+static void _check_request(const char *name, int depth, size_t budget, ThingSet *ts,
+    const uint8_t *req, size_t req_len, uint8_t expected_status)
+{
+    static uint8_t resp[TS_RESP_BUFFER_LEN];
+    _check_stack(name, depth, budget, [&]() {
+        ts->process((uint8_t *)req, req_len, resp, sizeof(resp));
+    });
+
+    // make sure the request took the intended path and not an error path
+    int status = (resp[0] == ':') ? strtoul((char *)&resp[1], NULL, 16) : resp[0];
+    TEST_ASSERT_EQUAL_HEX8(expected_status, status);
+}
+
+static void _check_txt_request(const char *name, int depth, size_t budget, ThingSet *ts,
+    std::string req, uint8_t expected_status)
+{
+    _check_request(name, depth, budget, ts, (const uint8_t *)req.c_str(), req.size(),
+        expected_status);
+}
+
+void stack_budgets()
+{
+    const int depths[] = { 1, 8 };
+    for (unsigned int i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        // chain of path nodes "p" with value nodes and an exec node at the deepest level
+        int depth = depths[i];
+        float f32 = 1.5F;
+        int32_t i32 = 2;
+        std::vector<DataNode> nodes;
+        for (int d = 0; d < depth; d++) {
+            nodes.push_back(TS_NODE_PATH((node_id_t)(0x100 + d), "p",
+                (node_id_t)(d > 0 ? 0x100 + d - 1 : 0), NULL));
+        }
+        node_id_t parent = 0x100 + depth - 1;
+        nodes.push_back(TS_NODE_FLOAT(0x40, "f", &f32, 2, parent, TS_ANY_RW, PUB_SER));
+        nodes.push_back(TS_NODE_INT32(0x41, "i", &i32, parent, TS_ANY_RW, PUB_SER));
+        nodes.push_back(TS_NODE_EXEC(0x42, "x", &budget_exec, parent, TS_ANY_RW));
+        ThingSet ts(nodes.data(), nodes.size());
+
+        std::string path = "p";
+        for (int d = 1; d < depth; d++) {
+            path += "/p";
+        }
+
+        _check_txt_request("txt GET", depth, STACK_BUDGET_TXT_GET, &ts,
+            "?" + path, TS_STATUS_CONTENT);
+        _check_txt_request("txt FETCH", depth, STACK_BUDGET_TXT_FETCH, &ts,
+            "?" + path + " [\"f\",\"i\"]", TS_STATUS_CONTENT);
+        _check_txt_request("txt PATCH", depth, STACK_BUDGET_TXT_PATCH, &ts,
+            "=" + path + " {\"f\":2.5,\"i\":3}", TS_STATUS_CHANGED);
+        _check_txt_request("txt exec", depth, STACK_BUDGET_TXT_EXEC, &ts,
+            "!" + path + "/x", TS_STATUS_VALID);
+
+        uint8_t id_hi = parent >> 8;
+        uint8_t id_lo = parent;
+        uint8_t bin_get[] = { TS_GET, 0x19, id_hi, id_lo, 0xA0 };
+        _check_request("bin GET", depth, STACK_BUDGET_BIN_GET, &ts, bin_get, sizeof(bin_get),
+            TS_STATUS_CONTENT);
+        uint8_t bin_fetch[] = { TS_FETCH, 0x19, id_hi, id_lo, 0x82, 0x18, 0x40, 0x18, 0x41 };
+        _check_request("bin FETCH", depth, STACK_BUDGET_BIN_FETCH, &ts, bin_fetch,
+            sizeof(bin_fetch), TS_STATUS_CONTENT);
+        uint8_t bin_patch[] = { TS_PATCH, 0x19, id_hi, id_lo, 0xA1, 0x18, 0x41, 0x03 };
+        _check_request("bin PATCH", depth, STACK_BUDGET_BIN_PATCH, &ts, bin_patch,
+            sizeof(bin_patch), TS_STATUS_CHANGED);
+        uint8_t bin_exec[] = { TS_POST, 0x18, 0x42, 0x80 };
+        _check_request("bin exec", depth, STACK_BUDGET_BIN_EXEC, &ts, bin_exec,
+            sizeof(bin_exec), TS_STATUS_VALID);
+
+        static uint8_t msg[TS_RESP_BUFFER_LEN];
+        _check_stack("txt_pub", depth, STACK_BUDGET_TXT_PUB, [&]() {
+            ts.txt_pub((char *)msg, sizeof(msg), PUB_SER);
+        });
+        _check_stack("bin_pub", depth, STACK_BUDGET_BIN_PUB, [&]() {
+            ts.bin_pub(msg, sizeof(msg), PUB_SER);
+        });
+        _check_stack("dump_json", depth, STACK_BUDGET_DUMP_JSON, [&]() {
+            ts.dump_json(budget_dump_discard, NULL);
+        });
+    }
+
+    TEST_ASSERT_LESS_OR_EQUAL(RAM_BUDGET_CONTEXT, sizeof(ThingSetContext));
+    TEST_ASSERT_LESS_OR_EQUAL(RAM_BUDGET_THINGSET, sizeof(ThingSet) - sizeof(ThingSetContext));
+}
+
+#endif /* sanitizers */
+
+#endif
+
+#if TS_STATS
+
+static uint32_t stats_cycles;
+
+static uint32_t stats_cycle_counter()
+{
+    stats_cycles += 100;    // processing of each request takes 100 cycles
+    return stats_cycles;
+}
+
+struct StatsTestDevice {
+    int32_t value = 0;
+    ThingSetStats stats;
+    DataNode nodes[3 + TS_STATS_NUM_NODES] = {
+        TS_NODE_PATH(ID_CONF, "conf", 0, NULL),
+        TS_NODE_INT32(0x6004, "i32", &value, ID_CONF, TS_ANY_RW, 0),
+        TS_NODE_PATH(0x7100, "stats", 0, NULL),
+        TS_STATS_NODES(0x7101, 0x7100, stats, 0),
+    };
+    ThingSet ts{nodes, sizeof(nodes) / sizeof(nodes[0])};
+};
+
+void request_stats()
+{
+    static StatsTestDevice dev;
+    dev.ts.set_stats(&dev.stats, stats_cycle_counter);
+
+    const char *txt_reqs[] = {
+        "?conf",
+        "?conf [\"i32\"]",
+        "=conf {\"i32\":5}",
+        "?conf/unknown",
+        "=conf {\"unknown\":1}",
+        "!conf/i32",
+    };
+    uint8_t resp[400];
+    for (unsigned int i = 0; i < sizeof(txt_reqs) / sizeof(txt_reqs[0]); i++) {
+        dev.ts.process((uint8_t *)txt_reqs[i], strlen(txt_reqs[i]), resp, sizeof(resp));
+    }
+
+    uint8_t bin_fetch[] = { TS_FETCH, 0x18, ID_CONF, 0x19, 0x60, 0x04 };
+    dev.ts.process(bin_fetch, sizeof(bin_fetch), resp, sizeof(resp));
+
+    uint8_t bin_get[] = { TS_GET, 0x18, ID_CONF };
+    TEST_ASSERT_EQUAL(1, dev.ts.process(bin_get, sizeof(bin_get), resp, 4));
+    TEST_ASSERT_EQUAL_HEX8(TS_STATUS_RESPONSE_TOO_LARGE, resp[0]);
+
+    // requests processed in several steps are counted once
+    uint8_t bin_get_names[] = { TS_GET, 0x19, 0x71, 0x00, 0x80 };
+    ThingSetContext ctx;
+    dev.ts.process_start(bin_get_names, sizeof(bin_get_names), resp, sizeof(resp), &ctx);
+    while (dev.ts.process_step(4, &ctx) == TS_PROCESS_PENDING) {}
+
+    TEST_ASSERT_EQUAL(4, dev.stats.requests[TS_STATS_GET]);
+    TEST_ASSERT_EQUAL(2, dev.stats.requests[TS_STATS_FETCH]);
+    TEST_ASSERT_EQUAL(2, dev.stats.requests[TS_STATS_PATCH]);
+    TEST_ASSERT_EQUAL(1, dev.stats.requests[TS_STATS_POST]);
+    TEST_ASSERT_EQUAL(0, dev.stats.requests[TS_STATS_DELETE]);
+    TEST_ASSERT_EQUAL(2, dev.stats.not_found);
+    TEST_ASSERT_EQUAL(1, dev.stats.response_too_large);
+    TEST_ASSERT_EQUAL(1, dev.stats.forbidden);
+    TEST_ASSERT_EQUAL(0, dev.stats.other_errors);
+
+    // 100 cycles per request or step: bucket 7 (64 to 127 cycles) except for the stepwise GET
+    TEST_ASSERT_EQUAL(3, dev.stats.latency[TS_STATS_GET][7]);
+    TEST_ASSERT_EQUAL(2, dev.stats.latency[TS_STATS_FETCH][7]);
+    uint32_t longer = 0;
+    for (int i = 8; i < TS_STATS_HIST_BUCKETS; i++) {
+        longer += dev.stats.latency[TS_STATS_GET][i];
+    }
+    TEST_ASSERT_EQUAL(1, longer);
+
+    // statistics are available as data nodes
+    const char fetch_stats[] = "?stats [\"GET\",\"NotFound\",\"ResponseTooLarge\"]";
+    int len = dev.ts.process((uint8_t *)fetch_stats, strlen(fetch_stats), resp, sizeof(resp));
+    resp[len] = '\0';
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [4,2,1]", (char *)resp);
+
+    dev.ts.set_stats(NULL);
+    dev.ts.process((uint8_t *)fetch_stats, strlen(fetch_stats), resp, sizeof(resp));
+    TEST_ASSERT_EQUAL(3, dev.stats.requests[TS_STATS_FETCH]);
+}
+
+#endif
+
+#if TS_NODE_PROFILING || TS_HOT_NODES > 0
+
+struct LookupTestDevice {
+    int32_t value = 0;
+    float f32 = 0;
+    DataNode nodes[5] = {
+        TS_NODE_PATH(ID_CONF, "conf", 0, NULL),
+        TS_NODE_INT32(0x6004, "i32", &value, ID_CONF, TS_ANY_RW, 0),
+        TS_NODE_PATH(ID_INPUT, "input", 0, NULL),
+        TS_NODE_INT32(0x5004, "i32", &value, ID_INPUT, TS_ANY_RW, 0),
+        TS_NODE_FLOAT(0x5005, "f32", &f32, 2, ID_INPUT, TS_ANY_RW, 0),
+    };
+    ThingSet ts{nodes, sizeof(nodes) / sizeof(nodes[0])};
+};
+
+#endif
+
+#if TS_NODE_PROFILING
+
+void node_profile()
+{
+    LookupTestDevice dev;
+    uint32_t profile[5] = {};
+    dev.ts.set_node_profile(profile);
+
+    uint8_t resp[100];
+    char txt_fetch[] = "?input [\"f32\",\"i32\",\"f32\"]";
+    dev.ts.process((uint8_t *)txt_fetch, strlen(txt_fetch), resp, sizeof(resp));
+
+    uint8_t bin_fetch[] = { TS_FETCH, 0x18, ID_INPUT, 0x19, 0x50, 0x05 };
+    dev.ts.process(bin_fetch, sizeof(bin_fetch), resp, sizeof(resp));
+
+    TEST_ASSERT_EQUAL(0, profile[0]);       // conf
+    TEST_ASSERT_EQUAL(0, profile[1]);       // conf/i32
+    TEST_ASSERT_EQUAL(2, profile[2]);       // input
+    TEST_ASSERT_EQUAL(1, profile[3]);       // input/i32
+    TEST_ASSERT_EQUAL(3, profile[4]);       // input/f32
+
+    dev.ts.set_node_profile(NULL);
+    dev.ts.process(bin_fetch, sizeof(bin_fetch), resp, sizeof(resp));
+    TEST_ASSERT_EQUAL(3, profile[4]);
+}
+
+#endif
+
+#if TS_HOT_NODES > 0
+
+void hot_nodes()
+{
+    LookupTestDevice dev;
+
+    const node_id_t ids[] = { 0x5005, 0x1234, 0x5004 };
+    TEST_ASSERT_EQUAL(2, dev.ts.set_hot_nodes(ids, sizeof(ids) / sizeof(ids[0])));
+
+    // same results as without lookaside list
+    TEST_ASSERT_EQUAL_PTR(&dev.nodes[4], dev.ts.get_node(0x5005));
+    TEST_ASSERT_EQUAL_PTR(&dev.nodes[3], dev.ts.get_node("i32", 3, ID_INPUT));
+    TEST_ASSERT_EQUAL_PTR(&dev.nodes[1], dev.ts.get_node("i32", 3, ID_CONF));
+    TEST_ASSERT_EQUAL_PTR(&dev.nodes[1], dev.ts.get_node("i32", 3));
+    TEST_ASSERT_EQUAL_PTR(&dev.nodes[0], dev.ts.get_node(ID_CONF));
+    TEST_ASSERT_NULL(dev.ts.get_node(0x1234));
+
+    uint8_t resp[100];
+    char txt_fetch[] = "?input [\"f32\",\"i32\"]";
+    dev.ts.process((uint8_t *)txt_fetch, strlen(txt_fetch), resp, sizeof(resp));
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [0.00,0]", (char *)resp);
+
+    TEST_ASSERT_EQUAL(0, dev.ts.set_hot_nodes(NULL, 0));
+    TEST_ASSERT_EQUAL_PTR(&dev.nodes[4], dev.ts.get_node(0x5005));
+}
+
+#endif
+
+#if TS_NODE_INDEX
+
+static char schema_manufacturer[] = "Libre Solar";
+static uint32_t schema_timestamp = 12345678;
+static float schema_bat_max_voltage = 14.4;
+static float schema_bat_max_current = 20;
+static int32_t schema_cell_values[4] = { 3300, 3310, 3290, 3305 };
+static ArrayInfo schema_cells = { schema_cell_values, 4, 4, TS_T_INT32 };
+static float schema_bat_voltage = 13.21;
+static float schema_bat_current = -2.5;
+static int16_t schema_ambient_temp = 22;
+static bool schema_error = false;
+static float schema_offset = 0;
+static bool schema_report_enable = true;
+static bool schema_status_enable = false;
+
+static void schema_reset()
+{
+}
+
+#include "test_schema.h"
+
+#define SCHEMA_NUM_NODES (sizeof(schema_nodes) / sizeof(DataNode))
+
+/*
+ * Processes a request with and without index and compares the responses
+ */
+static void _check_index_response(ThingSet *ts_linear, ThingSet *ts_index, const char *req,
+    size_t req_len)
+{
+    uint8_t req_buf[100];
+    uint8_t resp_linear[300];
+    uint8_t resp_index[300];
+
+    // text mode requests are modified during processing
+    memcpy(req_buf, req, req_len);
+    int len_linear = ts_linear->process(req_buf, req_len, resp_linear, sizeof(resp_linear));
+    memcpy(req_buf, req, req_len);
+    int len_index = ts_index->process(req_buf, req_len, resp_index, sizeof(resp_index));
+
+    TEST_ASSERT_EQUAL(len_linear, len_index);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(resp_linear, resp_index, len_linear);
+}
+
+static void _check_index_pub(ThingSet *ts_linear, ThingSet *ts_index, uint16_t pub_ch)
+{
+    char txt_linear[300];
+    char txt_index[300];
+    TEST_ASSERT_EQUAL(ts_linear->txt_pub(txt_linear, sizeof(txt_linear), pub_ch),
+        ts_index->txt_pub(txt_index, sizeof(txt_index), pub_ch));
+    TEST_ASSERT_EQUAL_STRING(txt_linear, txt_index);
+
+    uint8_t bin_linear[100];
+    uint8_t bin_index[100];
+    int len = ts_linear->bin_pub(bin_linear, sizeof(bin_linear), pub_ch);
+    TEST_ASSERT_EQUAL(len, ts_index->bin_pub(bin_index, sizeof(bin_index), pub_ch));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(bin_linear, bin_index, len);
+
+    int pos_linear = 0;
+    int pos_index = 0;
+    uint32_t id_linear, id_index;
+    uint8_t can_linear[8], can_index[8];
+    do {
+        len = ts_linear->bin_pub_can(pos_linear, pub_ch, 0x12, id_linear, can_linear);
+        TEST_ASSERT_EQUAL(len, ts_index->bin_pub_can(pos_index, pub_ch, 0x12, id_index,
+            can_index));
+        TEST_ASSERT_EQUAL(pos_linear, pos_index);
+        if (len > 0) {
+            TEST_ASSERT_EQUAL_HEX32(id_linear, id_index);
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(can_linear, can_index, len);
+        }
+    } while (len > 0);
+}
+
+void node_index()
+{
+    ThingSet ts_linear(schema_nodes, SCHEMA_NUM_NODES);
+    ThingSet ts_index(schema_nodes, SCHEMA_NUM_NODES);
+    TEST_ASSERT_EQUAL(0, ts_index.set_index(&schema_index));
+
+    ThingSet ts_other(schema_nodes, SCHEMA_NUM_NODES - 1);
+    TEST_ASSERT_EQUAL(-1, ts_other.set_index(&schema_index));
+
+    // same nodes found by ID and by name as with linear search
+    for (size_t i = 0; i < SCHEMA_NUM_NODES; i++) {
+        const DataNode *node = &schema_nodes[i];
+        TEST_ASSERT_EQUAL_PTR(node, ts_index.get_node(node->id));
+        TEST_ASSERT_EQUAL_PTR(node, ts_index.get_node(node->name, strlen(node->name),
+            node->parent));
+        TEST_ASSERT_EQUAL_PTR(ts_linear.get_node(node->name, strlen(node->name)),
+            ts_index.get_node(node->name, strlen(node->name)));
+    }
+    TEST_ASSERT_NULL(ts_index.get_node(0x1234));
+    TEST_ASSERT_NULL(ts_index.get_node("Bat", 3, 0x70));
+    TEST_ASSERT_NULL(ts_index.get_node("Bat_V", 5, 0x32));
+    TEST_ASSERT_NULL(ts_index.get_node("Manufacturer", 12, 0));
+
+    // child nodes and publication channels
+    const char *txt_reqs[] = {
+        "?", "?/", "?conf", "?conf/", "?conf/limits", "?output", "?pub/", "?pub/report",
+        "?pub/status/IDs", "!exec/calibrate [0.125]", "!exec/calibrate [1,2]", "?output/Bat_V",
+    };
+    for (size_t i = 0; i < sizeof(txt_reqs) / sizeof(txt_reqs[0]); i++) {
+        _check_index_response(&ts_linear, &ts_index, txt_reqs[i], strlen(txt_reqs[i]));
+    }
+
+    const uint8_t bin_reqs[][7] = {
+        { TS_GET, 0x00, 0x80 },                         // root names
+        { TS_GET, 0x18, 0x30, 0x80 },                   // conf names
+        { TS_GET, 0x18, 0x32, 0xA0 },                   // conf/limits names and values
+        { TS_GET, 0x18, 0x70, 0xA0 },                   // output names and values
+        { TS_GET, 0x18, 0x70, 0xF7 },                   // output IDs
+        { TS_FETCH, 0x18, 0x70, 0x18, 0x71 },           // output/Bat_V
+        { TS_PATCH, 0x18, 0x70, 0xA1, 0x18, 0x72, 0xF5 },
+        { TS_POST, 0x18, 0xE2, 0x81, 0xF9, 0x3C, 0x00 },    // exec/calibrate [1.0]
+    };
+    const size_t bin_lens[] = { 3, 4, 4, 4, 4, 5, 7, 7 };
+    for (size_t i = 0; i < sizeof(bin_lens) / sizeof(bin_lens[0]); i++) {
+        _check_index_response(&ts_linear, &ts_index, (const char *)bin_reqs[i], bin_lens[i]);
+    }
+
+    _check_index_pub(&ts_linear, &ts_index, PUB_REPORT);
+    _check_index_pub(&ts_linear, &ts_index, PUB_STATUS);
+    _check_index_pub(&ts_linear, &ts_index, PUB_REPORT | PUB_STATUS);
+
+    // publication channels changed at runtime
+    const char *add_node = "+pub/report/IDs \"Ambient_degC\"";
+    _check_index_response(&ts_linear, &ts_index, add_node, strlen(add_node));
+    _check_index_pub(&ts_linear, &ts_index, PUB_REPORT);
+    const char *del_node = "-pub/report/IDs \"Ambient_degC\"";
+    _check_index_response(&ts_linear, &ts_index, del_node, strlen(del_node));
+    _check_index_pub(&ts_linear, &ts_index, PUB_REPORT);
+
+    // linear search again without index
+    TEST_ASSERT_EQUAL(0, ts_index.set_index(NULL));
+    TEST_ASSERT_EQUAL_PTR(&schema_nodes[9], ts_index.get_node(0x71));
+}
+
+/*
+ * IDs of schema_nodes in the same order
+ */
+static constexpr node_id_t schema_ids[] = {
+    0x18, 0x19, 0x1A, 0x30, 0x31, 0x32, 0x33, 0x34, 0x70, 0x71, 0x72, 0x73,
+    0x74, 0xE0, 0xE1, 0xE2, 0xE3, 0xF0, 0xF1, 0xF2, 0xF3, 0xF5, 0xF6, 0xF7,
+};
+
+static constexpr auto schema_id_hash = ts_make_id_hash(schema_ids);
+static constexpr ThingSetIndex schema_id_index = ts_id_index(schema_id_hash);
+
+void id_hash()
+{
+    TEST_ASSERT_EQUAL(SCHEMA_NUM_NODES, sizeof(schema_ids) / sizeof(schema_ids[0]));
+    for (size_t i = 0; i < SCHEMA_NUM_NODES; i++) {
+        TEST_ASSERT_EQUAL_HEX16(schema_nodes[i].id, schema_ids[i]);
+    }
+
+    // same tables as generated by tools/ts_codegen.py
+    TEST_ASSERT_EQUAL(schema_index.num_id_buckets, schema_id_hash.num_buckets);
+    TEST_ASSERT_EQUAL_MEMORY(schema_id_seeds, schema_id_hash.seeds,
+        sizeof(schema_id_hash.seeds));
+    TEST_ASSERT_EQUAL_MEMORY(schema_id_offsets, schema_id_hash.offsets,
+        sizeof(schema_id_hash.offsets));
+    TEST_ASSERT_EQUAL_MEMORY(schema_id_slots, schema_id_hash.slots,
+        sizeof(schema_id_hash.slots));
+
+    ThingSet ts_linear(schema_nodes, SCHEMA_NUM_NODES);
+    ThingSet ts_index(schema_nodes, SCHEMA_NUM_NODES);
+    TEST_ASSERT_EQUAL(0, ts_index.set_index(&schema_id_index));
+
+    for (size_t i = 0; i < SCHEMA_NUM_NODES; i++) {
+        const DataNode *node = &schema_nodes[i];
+        TEST_ASSERT_EQUAL_PTR(node, ts_index.get_node(node->id));
+        TEST_ASSERT_EQUAL_PTR(node, ts_index.get_node(node->name, strlen(node->name),
+            node->parent));
+    }
+    TEST_ASSERT_NULL(ts_index.get_node(0x1234));
+    TEST_ASSERT_NULL(ts_index.get_node(0xF4));
+
+    // child nodes and publication channels found without the optional tables
+    const char *txt_reqs[] = { "?", "?conf/", "?output", "?pub/report/IDs" };
+    for (size_t i = 0; i < sizeof(txt_reqs) / sizeof(txt_reqs[0]); i++) {
+        _check_index_response(&ts_linear, &ts_index, txt_reqs[i], strlen(txt_reqs[i]));
+    }
+    const uint8_t bin_req[] = { TS_GET, 0x18, 0x70, 0xA0 };
+    _check_index_response(&ts_linear, &ts_index, (const char *)bin_req, sizeof(bin_req));
+    _check_index_pub(&ts_linear, &ts_index, PUB_REPORT);
+}
+
+void cbor_keys()
+{
+    // same keys encoded at init as generated by tools/ts_codegen.py
+    ThingSetIndex index = schema_id_index;
+    uint16_t offsets[SCHEMA_NUM_NODES + 1];
+    uint8_t keys[sizeof(schema_cbor_keys)];
+    TEST_ASSERT_EQUAL(sizeof(keys), ts_encode_cbor_keys(&index, schema_nodes, SCHEMA_NUM_NODES,
+        offsets, NULL, 0));
+    TEST_ASSERT_EQUAL(-1, ts_encode_cbor_keys(&index, schema_nodes, SCHEMA_NUM_NODES, offsets,
+        keys, sizeof(keys) - 1));
+    TEST_ASSERT_NULL(index.cbor_keys);
+    TEST_ASSERT_EQUAL(sizeof(keys), ts_encode_cbor_keys(&index, schema_nodes, SCHEMA_NUM_NODES,
+        offsets, keys, sizeof(keys)));
+    TEST_ASSERT_EQUAL_PTR(keys, index.cbor_keys);
+    TEST_ASSERT_EQUAL_PTR(offsets, index.cbor_key_offsets);
+    TEST_ASSERT_EQUAL_MEMORY(schema_cbor_keys, keys, sizeof(keys));
+    TEST_ASSERT_EQUAL_MEMORY(schema_cbor_key_offsets, offsets, sizeof(offsets));
+
+    ThingSet ts_linear(schema_nodes, SCHEMA_NUM_NODES);
+    ThingSet ts_index(schema_nodes, SCHEMA_NUM_NODES);
+    TEST_ASSERT_EQUAL(0, ts_index.set_index(&index));
+
+    // copied keys also cut off at the same position if the response buffer is too small
+    uint8_t bin_reqs[][4] = {
+        { TS_GET, 0x18, 0x30, 0x80 },       // conf names
+        { TS_GET, 0x18, 0x70, 0xA0 },       // output names and values
+        { TS_GET, 0x18, 0x70, 0xF7 },       // output IDs
+    };
+    for (size_t i = 0; i < sizeof(bin_reqs) / sizeof(bin_reqs[0]); i++) {
+        for (size_t size = 1; size <= 60; size++) {
+            uint8_t resp_linear[100];
+            uint8_t resp_index[100];
+            int len = ts_linear.process(bin_reqs[i], sizeof(bin_reqs[i]), resp_linear, size);
+            TEST_ASSERT_EQUAL(len, ts_index.process(bin_reqs[i], sizeof(bin_reqs[i]),
+                resp_index, size));
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(resp_linear, resp_index, len);
+        }
+    }
+
+    for (size_t size = 1; size <= 40; size++) {
+        uint8_t pub_linear[100];
+        uint8_t pub_index[100];
+        int len = ts_linear.bin_pub(pub_linear, size, PUB_REPORT | PUB_STATUS);
+        TEST_ASSERT_EQUAL(len, ts_index.bin_pub(pub_index, size, PUB_REPORT | PUB_STATUS));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(pub_linear, pub_index, len);
+    }
+    _check_index_pub(&ts_linear, &ts_index, PUB_REPORT | PUB_STATUS);
+}
+
+#endif
+
 void tests_common()
 {
     UNITY_BEGIN();
@@ -316,5 +1303,63 @@ void tests_common()
     RUN_TEST(txt_patch_bin_fetch);
     RUN_TEST(bin_patch_txt_fetch);
 
+    // publication scheduler
+    RUN_TEST(pub_scheduler_channels);
+
+#if defined(__linux__) && defined(NATIVE_BUILD)
+    // multi-client server
+    RUN_TEST(server_requests);
+
+#if !TS_DEFERRED_CALLBACKS
+    // callback context of concurrent requests
+    RUN_TEST(callback_context_threads);
+#endif
+
+    // capture of request traffic
+    RUN_TEST(capture_records);
+
+    // generated node trees for load tests
+    RUN_TEST(random_tree);
+
+    // gateway for multiple devices
+    RUN_TEST(gateway_routing);
+
+#if TS_DOUBLE_BUFFER
+    // concurrent readers of double-buffered values
+    RUN_TEST(double_buffer_readers);
+#endif
+
+#if !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+    // stack and RAM usage
+    RUN_TEST(stack_budgets);
+#endif
+#endif
+
+#if TS_STATS
+    // request statistics
+    RUN_TEST(request_stats);
+#endif
+
+#if TS_NODE_PROFILING
+    // node access profile
+    RUN_TEST(node_profile);
+#endif
+
+#if TS_HOT_NODES > 0
+    // lookaside list of frequently accessed nodes
+    RUN_TEST(hot_nodes);
+#endif
+
+#if TS_NODE_INDEX
+    // lookup structures generated from a schema
+    RUN_TEST(node_index);
+
+    // perfect hash of node IDs built at compile time
+    RUN_TEST(id_hash);
+
+    // pre-encoded CBOR keys
+    RUN_TEST(cbor_keys);
+#endif
+
     UNITY_END();
 }
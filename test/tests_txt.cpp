@@ -12,6 +12,11 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+
+#ifdef NATIVE_BUILD
+#include <thread>
+#endif
 
 extern uint8_t req_buf[];
 extern uint8_t resp_buf[];
@@ -22,6 +27,7 @@ extern int32_t i32;
 extern ArrayInfo int32_array;
 extern ArrayInfo float32_array;
 extern bool b;
+extern char strbuf[];
 
 extern bool pub_serial_enable;
 extern ArrayInfo pub_serial_array;
@@ -42,6 +48,15 @@ void test_txt_get_output_names_values()
     TEST_ASSERT_EQUAL_STRING(":85 Content. {\"Bat_V\":14.10,\"Bat_A\":5.13,\"Ambient_degC\":22}", resp_buf);
 }
 
+void test_txt_get_not_null_terminated()
+{
+    // data after the end of the request must be ignored
+    snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?output/ [\"Bat_V\"]");
+    int resp_len = ts.process(req_buf, strlen("?output"), resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. {\"Bat_V\":14.10,\"Bat_A\":5.13,\"Ambient_degC\":22}", resp_buf);
+}
+
 void test_txt_fetch_array()
 {
     f32 = 52.80;
@@ -125,6 +140,136 @@ void test_txt_patch_unknown_node()
     TEST_ASSERT_EQUAL_STRING(":A4 Not Found.", resp_buf);
 }
 
+void test_txt_patch_fetch_escaped_string()
+{
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN,
+        "=conf {\"strbuf\":\"Say \\\"Hi\\\"\\n\\tC:\\\\ \\u00e4\\/\\u0001\"}");
+    int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":84 Changed.", resp_buf);
+    TEST_ASSERT_EQUAL_STRING("Say \"Hi\"\n\tC:\\ \xC3\xA4/\x01", strbuf);
+
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?conf \"strbuf\"");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(
+        ":85 Content. \"Say \\\"Hi\\\"\\n\\tC:\\\\ \xC3\xA4/\\u0001\"", resp_buf);
+}
+
+void test_txt_patch_long_string()
+{
+    char value[200];
+    memset(value, 'x', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "=conf {\"strbuf\":\"%s\"}",
+        value);
+    int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":84 Changed.", resp_buf);
+    TEST_ASSERT_EQUAL_STRING(value, strbuf);
+
+    // invalid escape sequence (already rejected by the JSON parser)
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "=conf {\"strbuf\":\"\\u12\"}");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":A0 Bad Request.", resp_buf);
+
+    // valid JSON, but rejected when unescaping: NUL character, unpaired surrogates
+    const char *invalid[] = { "\\u0000", "ab\\u0000cd", "\\ud800x", "\\ud800\\u0041",
+        "\\udc00" };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "=conf {\"strbuf\":\"%s\"}",
+            invalid[i]);
+        resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+        TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+        TEST_ASSERT_EQUAL_STRING(":AF Unsupported Content-Format.", resp_buf);
+        TEST_ASSERT_EQUAL_STRING(value, strbuf);
+    }
+}
+
+void test_txt_patch_int32_array()
+{
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN,
+        "=conf {\"arrayi32\":[-1,7,100000],\"arrayfloat\":[1.5,-2.25,3]}");
+    int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":84 Changed.", resp_buf);
+    TEST_ASSERT_EQUAL(3, int32_array.num_elements);
+    TEST_ASSERT_EQUAL(-1, ((int32_t *)int32_array.ptr)[0]);
+    TEST_ASSERT_EQUAL(100000, ((int32_t *)int32_array.ptr)[2]);
+    TEST_ASSERT_EQUAL(3, float32_array.num_elements);
+    TEST_ASSERT_EQUAL_FLOAT(-2.25, ((float *)float32_array.ptr)[1]);
+
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?conf [\"arrayi32\",\"arrayfloat\"]");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [[-1,7,100000],[1.50,-2.25,3.00]]", resp_buf);
+
+    // nothing is written if one of the elements is invalid
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN,
+        "=conf {\"arrayi32\":[4,2,8,4],\"arrayfloat\":[1.5,\"abc\"]}");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":AF Unsupported Content-Format.", resp_buf);
+    TEST_ASSERT_EQUAL(3, int32_array.num_elements);
+
+    // array node with single value
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "=conf {\"arrayi32\":4}");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":AF Unsupported Content-Format.", resp_buf);
+
+    // restore original content
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN,
+        "=conf {\"arrayi32\":[4,2,8,4],\"arrayfloat\":[2.27,3.44]}");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_STRING(":84 Changed.", resp_buf);
+    TEST_ASSERT_EQUAL(4, int32_array.num_elements);
+}
+
+void test_txt_patch_array_too_long()
+{
+    // more elements than the node can store
+    uint16_t max_elements = int32_array.max_elements;
+    int32_array.max_elements = 8;
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN,
+        "=conf {\"arrayi32\":[1,2,3,4,5,6,7,8,9]}");
+    int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":AD Request Entity Too Large.", resp_buf);
+    TEST_ASSERT_EQUAL(4, int32_array.num_elements);
+    TEST_ASSERT_EQUAL(4, ((int32_t *)int32_array.ptr)[0]);
+
+    // exactly the maximum number of elements
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN,
+        "=conf {\"arrayi32\":[1,2,3,4,5,6,7,8]}");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_STRING(":84 Changed.", resp_buf);
+    TEST_ASSERT_EQUAL(8, int32_array.num_elements);
+    int32_array.max_elements = max_elements;
+
+#if !TS_JSON_STREAMING
+    // more elements than JSON tokens available
+    size_t pos = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "=conf {\"arrayi32\":[");
+    for (int i = 0; i < TS_NUM_JSON_TOKENS; i++) {
+        pos += snprintf((char *)req_buf + pos, TS_REQ_BUFFER_LEN - pos, "1,");
+    }
+    pos += snprintf((char *)req_buf + pos - 1, TS_REQ_BUFFER_LEN - pos, "]}") - 1;
+
+    resp_len = ts.process(req_buf, pos, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":AD Request Entity Too Large.", resp_buf);
+    TEST_ASSERT_EQUAL(8, int32_array.num_elements);
+#endif
+
+    // restore original content
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "=conf {\"arrayi32\":[4,2,8,4]}");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_STRING(":84 Changed.", resp_buf);
+    TEST_ASSERT_EQUAL(4, int32_array.num_elements);
+}
+
 bool conf_callback_called;
 
 void conf_callback(void)        // implement function as defined in test_data.h
@@ -140,6 +285,9 @@ void test_txt_conf_callback()
     int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
     TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
     TEST_ASSERT_EQUAL_STRING(":84 Changed.", resp_buf);
+#if TS_DEFERRED_CALLBACKS
+    ts.run_deferred_callbacks();
+#endif
     TEST_ASSERT_EQUAL(1, conf_callback_called);
 }
 
@@ -158,9 +306,78 @@ void test_txt_exec()
     int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
     TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
     TEST_ASSERT_EQUAL_STRING(":83 Valid.", resp_buf);
+#if TS_DEFERRED_CALLBACKS
+    ts.run_deferred_callbacks();
+#endif
     TEST_ASSERT_EQUAL(1, dummy_called_flag);
 }
 
+#if TS_DEFERRED_CALLBACKS
+static int32_t exec_param;
+static int32_t exec_param_received;
+
+static void exec_with_param()
+{
+    exec_param_received = exec_param;
+}
+
+void test_txt_exec_deferred()
+{
+    ts.run_deferred_callbacks();    // calls queued by previous tests
+    dummy_called_flag = 0;
+
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "!exec/dummy");
+    int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":83 Valid.", resp_buf);
+    TEST_ASSERT_EQUAL(0, dummy_called_flag);
+
+    TEST_ASSERT_EQUAL(1, ts.run_deferred_callbacks());
+    TEST_ASSERT_EQUAL(1, dummy_called_flag);
+    TEST_ASSERT_EQUAL(0, ts.run_deferred_callbacks());
+
+    // fill the queue
+    for (int i = 0; i < TS_CALLBACK_QUEUE_SIZE; i++) {
+        ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+        TEST_ASSERT_EQUAL_STRING(":83 Valid.", resp_buf);
+    }
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":C3 Service Unavailable.", resp_buf);
+
+    // values are not changed if the callback can't be queued
+    int32_t i32_before = i32;
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "=conf {\"i32\":%d}", i32 + 1);
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":C3 Service Unavailable.", resp_buf);
+    TEST_ASSERT_EQUAL(i32_before, i32);
+
+    TEST_ASSERT_EQUAL(TS_CALLBACK_QUEUE_SIZE, ts.run_deferred_callbacks());
+
+    // failed requests release the reserved slot without queueing the call
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "!exec/dummy [1]");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":A0 Bad Request.", resp_buf);
+    TEST_ASSERT_EQUAL(0, ts.run_deferred_callbacks());
+
+    // functions with parameters are called immediately, as other requests could change them
+    DataNode exec_nodes[] = {
+        TS_NODE_EXEC(0x10, "set", &exec_with_param, 0, TS_ANY_RW),
+        TS_NODE_INT32(0x11, "Value", &exec_param, 0x10, TS_ANY_RW, 0),
+    };
+    ThingSet ts_exec(exec_nodes, sizeof(exec_nodes) / sizeof(DataNode));
+    exec_param_received = 0;
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "!set [5]");
+    resp_len = ts_exec.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":83 Valid.", resp_buf);
+    TEST_ASSERT_EQUAL(5, exec_param_received);
+    TEST_ASSERT_EQUAL(0, ts_exec.run_deferred_callbacks());
+}
+#endif
+
 void test_txt_pub_msg()
 {
     int resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER);
@@ -170,6 +387,191 @@ void test_txt_pub_msg()
         resp_buf);
 }
 
+void test_txt_pub_delta()
+{
+    uint32_t checksums[100];
+    PubDelta delta = { checksums, sizeof(checksums)/sizeof(uint32_t), 3, 0 };
+
+    // first message contains all nodes
+    int resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER, &delta);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(
+        "# {\"Timestamp_s\":12345678,\"Bat_V\":14.10,\"Bat_A\":5.13,\"Ambient_degC\":22}",
+        resp_buf);
+
+    // nothing changed
+    resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER, &delta);
+    TEST_ASSERT_EQUAL(0, resp_len);
+
+    // only changed value
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "=info {\"Timestamp_s\":12345679}");
+    ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER, &delta);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING("# {\"Timestamp_s\":12345679}", resp_buf);
+
+    // full refresh every 3rd message
+    resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER, &delta);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(
+        "# {\"Timestamp_s\":12345679,\"Bat_V\":14.10,\"Bat_A\":5.13,\"Ambient_degC\":22}",
+        resp_buf);
+
+    // restore original value
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "=info {\"Timestamp_s\":12345678}");
+    ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+}
+
+#if TS_SEQLOCK
+void test_txt_pub_seqlock()
+{
+    // no consistent snapshot available during an update
+    ts.begin_update();
+    int resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER);
+    TEST_ASSERT_EQUAL(0, resp_len);
+
+    // read requests are rejected instead of returning inconsistent values
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?conf [\"f32\"]");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":C3 Service Unavailable.", resp_buf);
+
+    // overlapping updates of different writers: consistent only after both finished
+    ts.begin_update();
+    resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER);
+    TEST_ASSERT_EQUAL(0, resp_len);
+    ts.end_update();
+    resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER);
+    TEST_ASSERT_EQUAL(0, resp_len);
+    ts.end_update();
+
+    resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(
+        "# {\"Timestamp_s\":12345678,\"Bat_V\":14.10,\"Bat_A\":5.13,\"Ambient_degC\":22}",
+        resp_buf);
+}
+#endif
+
+#if TS_DOUBLE_BUFFER
+void test_txt_fetch_double_buffer()
+{
+    float f32_back;
+    float f32_spare;
+    f32 = 52.80;
+    ts.set_double_buffer(&f32, &f32_back, &f32_spare, sizeof(f32));
+
+    // values in back buffer not yet visible
+    float *back = (float *)ts.get_back_buffer();
+    TEST_ASSERT_EQUAL_PTR(&f32_back, back);
+    *back = 12.3;
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?conf [\"f32\"]");
+    int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [52.80]", resp_buf);
+
+    TEST_ASSERT_TRUE(ts.swap_buffers());
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [12.30]", resp_buf);
+
+    // new back buffer is the spare buffer, initialized with the current values
+    back = (float *)ts.get_back_buffer();
+    TEST_ASSERT_EQUAL_PTR(&f32_spare, back);
+    TEST_ASSERT_EQUAL_FLOAT(12.3, f32_spare);
+    TEST_ASSERT_EQUAL_FLOAT(52.8, f32);
+
+    // buffers are rotated with each swap
+    *back = 45.6;
+    TEST_ASSERT_TRUE(ts.swap_buffers());
+    TEST_ASSERT_EQUAL_PTR(&f32, ts.get_back_buffer());
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [45.60]", resp_buf);
+
+    ts.set_double_buffer(NULL, NULL, NULL, 0);
+    f32 = 52.80;
+}
+#endif
+
+#if TS_UPDATE_QUEUE
+void test_txt_update_queue()
+{
+    float f32_prev = f32;
+    int32_t i32_prev = i32;
+    bool b_prev = b;
+    uint16_t *ui16 = (uint16_t *)ts.get_node(0x6005)->data;
+    uint16_t ui16_prev = *ui16;
+
+    TEST_ASSERT_TRUE(ts.queue_update_f32(0x6007, 12.5));
+    TEST_ASSERT_TRUE(ts.queue_update_f32(0x6004, -3.7));     // converted to int32
+    TEST_ASSERT_TRUE(ts.queue_update_u32(0x6005, 1000));
+    TEST_ASSERT_TRUE(ts.queue_update_bool(0x6008, true));
+    TEST_ASSERT_TRUE(ts.queue_update_i32(0x7777, 1));        // unknown node
+
+    // values are only written when applied
+    TEST_ASSERT_EQUAL_FLOAT(f32_prev, f32);
+    TEST_ASSERT_EQUAL(4, ts.apply_updates());
+    TEST_ASSERT_EQUAL(0, ts.apply_updates());
+
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN,
+        "?conf [\"f32\",\"i32\",\"ui16\",\"bool\"]");
+    int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [12.50,-3,1000,true]", resp_buf);
+
+    // values outside the range of the node are saturated, NaN is dropped for integer nodes
+    TEST_ASSERT_TRUE(ts.queue_update_i32(0x6005, -5));
+    TEST_ASSERT_EQUAL(1, ts.apply_updates());
+    TEST_ASSERT_EQUAL(0, *ui16);
+    TEST_ASSERT_TRUE(ts.queue_update_u32(0x6005, 70000));
+    TEST_ASSERT_TRUE(ts.queue_update_f32(0x6004, 1e20));
+    TEST_ASSERT_EQUAL(2, ts.apply_updates());
+    TEST_ASSERT_EQUAL(UINT16_MAX, *ui16);
+    TEST_ASSERT_EQUAL(INT32_MAX, i32);
+    TEST_ASSERT_TRUE(ts.queue_update_f32(0x6004, -1e20));
+    TEST_ASSERT_TRUE(ts.queue_update_f32(0x6004, NAN));
+    TEST_ASSERT_EQUAL(1, ts.apply_updates());
+    TEST_ASSERT_EQUAL(INT32_MIN, i32);
+
+    // full queue
+    for (int i = 0; i < TS_UPDATE_QUEUE_SIZE; i++) {
+        TEST_ASSERT_TRUE(ts.queue_update_i32(0x6004, i));
+    }
+    TEST_ASSERT_FALSE(ts.queue_update_i32(0x6004, 100));
+    TEST_ASSERT_EQUAL(TS_UPDATE_QUEUE_SIZE, ts.apply_updates());
+    TEST_ASSERT_EQUAL(TS_UPDATE_QUEUE_SIZE - 1, i32);
+
+#ifdef NATIVE_BUILD
+    // producer running in parallel (similar to an ISR)
+    const int32_t num_updates = 100000;
+    std::thread producer([num_updates]() {
+        for (int32_t i = 1; i <= num_updates; i++) {
+            while (!ts.queue_update_i32(0x6004, i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    int32_t last = 0;
+    bool monotonic = true;
+    while (last < num_updates) {
+        ts.apply_updates();
+        if (i32 < last) {
+            monotonic = false;
+        }
+        last = i32;
+    }
+    producer.join();
+    TEST_ASSERT_TRUE(monotonic);
+#endif
+
+    f32 = f32_prev;
+    i32 = i32_prev;
+    b = b_prev;
+    *ui16 = ui16_prev;
+}
+#endif
+
 void test_txt_pub_list_channels()
 {
     size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?pub/");
@@ -305,6 +707,38 @@ void test_txt_auth_reset()
     TEST_ASSERT_EQUAL_STRING(":A1 Unauthorized.", resp_buf);
 }
 
+void test_txt_auth_sessions()
+{
+    ThingSetContext shell_ctx;
+    ThingSetContext can_ctx;
+
+    // authorize as expert user in one session
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "!auth \"expert123\"");
+    int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN, &shell_ctx);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":83 Valid.", resp_buf);
+
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "=conf {\"secret_expert\" : 10}");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN, &shell_ctx);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":84 Changed.", resp_buf);
+
+    // other sessions are not affected
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN, &can_ctx);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":A1 Unauthorized.", resp_buf);
+
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":A1 Unauthorized.", resp_buf);
+
+    // explicit change of authentication level for a session
+    ts.set_authentication(TS_USR_MASK, &shell_ctx);
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN, &shell_ctx);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":A1 Unauthorized.", resp_buf);
+}
+
 void test_txt_wrong_command()
 {
     size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "!abcd \"f32\"");
@@ -313,6 +747,39 @@ void test_txt_wrong_command()
     TEST_ASSERT_EQUAL_STRING(":A4 Not Found.", resp_buf);
 }
 
+#ifdef NATIVE_BUILD
+static void process_with_context(const char *req, const char *expected, bool *success)
+{
+    ThingSetContext ctx;
+    uint8_t req_tmp[100];
+    uint8_t resp_tmp[100];
+
+    size_t req_len = snprintf((char *)req_tmp, sizeof(req_tmp), "%s", req);
+    *success = true;
+    for (int i = 0; i < 1000; i++) {
+        ts.process(req_tmp, req_len, resp_tmp, sizeof(resp_tmp), &ctx);
+        if (strcmp((char *)resp_tmp, expected) != 0) {
+            *success = false;
+        }
+    }
+}
+
+void test_txt_process_parallel_contexts()
+{
+    bool success1 = false;
+    bool success2 = false;
+
+    std::thread t1(process_with_context, "?output/",
+        ":85 Content. [\"Bat_V\",\"Bat_A\",\"Ambient_degC\"]", &success1);
+    std::thread t2(process_with_context, "?conf \"f32_rounded\"", ":85 Content. 53", &success2);
+    t1.join();
+    t2.join();
+
+    TEST_ASSERT_TRUE(success1);
+    TEST_ASSERT_TRUE(success2);
+}
+#endif
+
 void test_txt_get_endpoint()
 {
     const DataNode *node;
@@ -326,6 +793,183 @@ void test_txt_get_endpoint()
     TEST_ASSERT_EQUAL(node->id, ID_CONF);
 }
 
+void test_txt_jsmn_next()
+{
+    const char json[] = "{\"f32\":52.8,\"arr\":[1,\"a]\",[2]],\"b\":true}";
+    jsmntok_t tokens[20];
+    jsmn_parser parser;
+
+    jsmn_init(&parser);
+    int tok_count = jsmn_parse(&parser, json, strlen(json), tokens, 20);
+    TEST_ASSERT_EQUAL(11, tok_count);
+
+    // pull parser must return the same tokens in the same order
+    jsmn_init(&parser);
+    for (int i = 0; i < tok_count; i++) {
+        jsmntok_t tok;
+        TEST_ASSERT_EQUAL(1, jsmn_next(&parser, json, strlen(json), &tok));
+        TEST_ASSERT_EQUAL(tokens[i].type, tok.type);
+        TEST_ASSERT_EQUAL(tokens[i].start, tok.start);
+        TEST_ASSERT_EQUAL(tokens[i].end, tok.end);
+        if (tok.type == JSMN_OBJECT || tok.type == JSMN_ARRAY) {
+            TEST_ASSERT_EQUAL(tokens[i].size, tok.size);
+        }
+    }
+    jsmntok_t tok;
+    TEST_ASSERT_EQUAL(0, jsmn_next(&parser, json, strlen(json), &tok));
+}
+
+static void dump_json_to_buf(const char *buf, size_t len, void *arg)
+{
+    char *str = (char *)arg;
+    strncat(str, buf, len);
+}
+
+void test_txt_dump_json()
+{
+    char str[200] = "";
+    ts.dump_json(dump_json_to_buf, str, ID_OUTPUT);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\n"
+        "    \"Bat_V\":14.10,\n"
+        "    \"Bat_A\":5.13,\n"
+        "    \"Ambient_degC\":22\n"
+        "}\n", str);
+
+    str[0] = '\0';
+    ts.dump_json(dump_json_to_buf, str, 0x100);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\n"
+        "    \"hourly\": {\n"
+        "    },\n"
+        "    \"daily\": {\n"
+        "    }\n"
+        "}\n", str);
+}
+
+/*
+ * Values ending close to the end of the dump_json buffer must be moved to the next chunk
+ * without writing past the buffer
+ */
+void test_txt_dump_json_buffer_limit()
+{
+    static char str_value[TS_DUMP_JSON_BUF_SIZE];
+    static int32_t values[] = { 1, 2, -1234567, -1234567890 };
+    static ArrayInfo array = { values, 4, 4, TS_T_INT32 };
+    static DataNode nodes[] = {
+        TS_NODE_STRING(0x01, "s", str_value, sizeof(str_value), 0, TS_ANY_RW, 0),
+        TS_NODE_ARRAY(0x02, "a", &array, 0, 0, TS_ANY_RW, 0),
+        TS_NODE_PUBSUB(0x03, "IDs", 1, 0, TS_ANY_RW, 0),
+        TS_NODE_STRING(0x04, "Manufacturer_Name", str_value, sizeof(str_value), 0,
+            TS_ANY_RW, 1),
+        TS_NODE_STRING(0x05, "Serial_Number_Str", str_value, sizeof(str_value), 0,
+            TS_ANY_RW, 1),
+    };
+    ThingSet ts_limit(nodes, sizeof(nodes) / sizeof(DataNode));
+
+    // shift the end of the values over all positions of the buffer
+    for (size_t len = 0; len < TS_DUMP_JSON_BUF_SIZE - 20; len++) {
+        memset(str_value, 'x', len);
+        str_value[len] = '\0';
+
+        char str[600] = "";
+        char expected[600];
+        ts_limit.dump_json(dump_json_to_buf, str);
+        snprintf(expected, sizeof(expected),
+            "{\n"
+            "    \"s\":\"%s\",\n"
+            "    \"a\":[1,2,-1234567,-1234567890],\n"
+            "    \"IDs\":[\"Manufacturer_Name\",\"Serial_Number_Str\"],\n"
+            "    \"Manufacturer_Name\":\"%s\",\n"
+            "    \"Serial_Number_Str\":\"%s\"\n"
+            "}\n", str_value, str_value, str_value);
+        TEST_ASSERT_EQUAL_STRING(expected, str);
+    }
+
+    // values longer than the buffer are printed as null
+    memset(str_value, 'x', sizeof(str_value) - 1);
+    str_value[sizeof(str_value) - 1] = '\0';
+    char str[800] = "";
+    ts_limit.dump_json(dump_json_to_buf, str, 0);
+    TEST_ASSERT_EQUAL_STRING_LEN("{\n    \"s\":null,\n", str, 16);
+}
+
+void test_txt_process_steps()
+{
+    const char *requests[] = {
+        "?/",
+        "?output",
+        "?output/",
+        "?conf [\"i32\",\"f32\",\"ui16\"]",
+        "?conf \"i32\"",
+        "?conf [\"i32\",\"unknown\"]",
+    };
+    char resp_expected[TS_RESP_BUFFER_LEN];
+
+    for (unsigned int i = 0; i < sizeof(requests) / sizeof(requests[0]); i++) {
+        size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "%s", requests[i]);
+        int len_expected = ts.process(req_buf, req_len, (uint8_t *)resp_expected,
+            sizeof(resp_expected));
+
+        for (int max_nodes = 1; max_nodes <= 2; max_nodes++) {
+            ThingSetContext ctx;
+            int steps = 0;
+            int resp_len;
+            ts.process_start(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN, &ctx);
+            do {
+                resp_len = ts.process_step(max_nodes, &ctx);
+                steps++;
+            } while (resp_len == TS_PROCESS_PENDING && steps < 100);
+
+            TEST_ASSERT_EQUAL(len_expected, resp_len);
+            TEST_ASSERT_EQUAL_STRING(resp_expected, resp_buf);
+            if (i < 2 && max_nodes == 1) {
+                // one step per node (at least 3 child nodes)
+                TEST_ASSERT_GREATER_THAN(2, steps);
+            }
+        }
+    }
+}
+
+#if TS_SEQLOCK
+void test_txt_process_steps_seqlock()
+{
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?output/");
+    char resp_expected[TS_RESP_BUFFER_LEN];
+    int len_expected = ts.process(req_buf, req_len, (uint8_t *)resp_expected,
+        sizeof(resp_expected));
+
+    // update between steps: each step reads a consistent snapshot
+    ThingSetContext ctx;
+    ts.process_start(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN, &ctx);
+    TEST_ASSERT_EQUAL(TS_PROCESS_PENDING, ts.process_step(1, &ctx));
+    ts.begin_update();
+    ts.end_update();
+    int resp_len;
+    do {
+        resp_len = ts.process_step(1, &ctx);
+    } while (resp_len == TS_PROCESS_PENDING);
+    TEST_ASSERT_EQUAL(len_expected, resp_len);
+    TEST_ASSERT_EQUAL_STRING(resp_expected, resp_buf);
+
+    // writer in progress during a step: partial response is discarded
+    ts.process_start(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN, &ctx);
+    TEST_ASSERT_EQUAL(TS_PROCESS_PENDING, ts.process_step(1, &ctx));
+    ts.begin_update();
+    resp_len = ts.process_step(1, &ctx);
+    ts.end_update();
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":C3 Service Unavailable.", resp_buf);
+
+    // request is finished, so a new one can be started with the same context
+    ts.process_start(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN, &ctx);
+    do {
+        resp_len = ts.process_step(2, &ctx);
+    } while (resp_len == TS_PROCESS_PENDING);
+    TEST_ASSERT_EQUAL_STRING(resp_expected, resp_buf);
+}
+#endif
+
 void tests_text_mode()
 {
     UNITY_BEGIN();
@@ -333,6 +977,7 @@ void tests_text_mode()
     // GET request
     RUN_TEST(test_txt_get_output_names);
     RUN_TEST(test_txt_get_output_names_values);
+    RUN_TEST(test_txt_get_not_null_terminated);
 
     // FETCH request
     RUN_TEST(test_txt_fetch_array);
@@ -346,13 +991,30 @@ void tests_text_mode()
     RUN_TEST(test_txt_patch_readonly);
     RUN_TEST(test_txt_patch_wrong_path);
     RUN_TEST(test_txt_patch_unknown_node);
+    RUN_TEST(test_txt_patch_fetch_escaped_string);
+    RUN_TEST(test_txt_patch_long_string);
+    RUN_TEST(test_txt_patch_int32_array);
+    RUN_TEST(test_txt_patch_array_too_long);
     RUN_TEST(test_txt_conf_callback);
 
     // POST request
     RUN_TEST(test_txt_exec);
+#if TS_DEFERRED_CALLBACKS
+    RUN_TEST(test_txt_exec_deferred);
+#endif
 
     // pub/sub messages
     RUN_TEST(test_txt_pub_msg);
+    RUN_TEST(test_txt_pub_delta);
+#if TS_SEQLOCK
+    RUN_TEST(test_txt_pub_seqlock);
+#endif
+#if TS_DOUBLE_BUFFER
+    RUN_TEST(test_txt_fetch_double_buffer);
+#endif
+#if TS_UPDATE_QUEUE
+    RUN_TEST(test_txt_update_queue);
+#endif
     RUN_TEST(test_txt_pub_list_channels);
     RUN_TEST(test_txt_pub_enable);
     RUN_TEST(test_txt_pub_delete_append_node);
@@ -363,10 +1025,21 @@ void tests_text_mode()
     RUN_TEST(test_txt_auth_long_password);
     RUN_TEST(test_txt_auth_failure);
     RUN_TEST(test_txt_auth_reset);
+    RUN_TEST(test_txt_auth_sessions);
 
     // general tests
     RUN_TEST(test_txt_wrong_command);
     RUN_TEST(test_txt_get_endpoint);
+    RUN_TEST(test_txt_jsmn_next);
+    RUN_TEST(test_txt_dump_json);
+    RUN_TEST(test_txt_dump_json_buffer_limit);
+    RUN_TEST(test_txt_process_steps);
+#if TS_SEQLOCK
+    RUN_TEST(test_txt_process_steps_seqlock);
+#endif
+#ifdef NATIVE_BUILD
+    RUN_TEST(test_txt_process_parallel_contexts);
+#endif
 
     UNITY_END();
 }
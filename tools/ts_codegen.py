@@ -0,0 +1,440 @@
+#!/usr/bin/env python3
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Copyright (c) 2020 Martin Jäger / Libre Solar
+#
+
+"""
+Generates the data nodes array and the lookup structures (ThingSetIndex) from a schema
+
+Usage: ts_codegen.py schema.json [-o output.h] [-p prefix]
+
+The schema is a JSON (or YAML, if PyYAML is installed) file describing the node tree:
+
+    {
+        "channels": { "PUB_SER": 0, "PUB_CAN": 1 },
+        "nodes": [
+            { "id": "0x70", "name": "output", "type": "path", "children": [
+                { "id": "0x71", "name": "Bat_V", "type": "float", "var": "battery_voltage",
+                  "digits": 2, "access": "TS_ANY_R", "pubsub": ["PUB_SER", "PUB_CAN"] }
+            ]}
+        ]
+    }
+
+Channels are given as bit numbers and defined as macros in the generated file.
+
+Supported node attributes:
+
+    id          Node ID (integer or string with hex number)
+    name        Node name
+    type        bool, uint64, int64, uint32, int32, uint16, int16, float, string, array, exec,
+                pubsub or path
+    var         Variable of value nodes (ArrayInfo for arrays, char buffer for strings)
+    digits      Decimal digits of float and array nodes (default: 0)
+    size        Buffer size of string nodes (default: sizeof(var))
+    function    Function called by exec nodes
+    callback    Callback of path nodes (default: NULL)
+    channel     Publication channel of pubsub nodes
+    access      Access flags (default: TS_ANY_R, TS_ANY_RW for exec and pubsub nodes)
+    pubsub      List of channels the node is published in
+    children    Child nodes of path and exec nodes (parameters of exec nodes)
+    comment     Comment added above the node
+
+The generated file defines <prefix>_nodes and <prefix>_index and should be included by only
+one source file, same as test/test_data.h.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+TS_INDEX_EMPTY = 0xFFFF
+
+VALUE_MACROS = {
+    'bool': 'TS_NODE_BOOL',
+    'uint64': 'TS_NODE_UINT64',
+    'int64': 'TS_NODE_INT64',
+    'uint32': 'TS_NODE_UINT32',
+    'int32': 'TS_NODE_INT32',
+    'uint16': 'TS_NODE_UINT16',
+    'int16': 'TS_NODE_INT16',
+}
+
+NODE_TYPES = set(VALUE_MACROS) | {'float', 'string', 'array', 'exec', 'pubsub', 'path'}
+
+
+class SchemaError(Exception):
+    pass
+
+
+def id_hash(node_id, seed):
+    """Same as ts_id_hash in thingset.h"""
+    h = (node_id ^ (seed * 0x9E3779B9)) & 0xFFFFFFFF
+    h ^= h >> 16
+    h = (h * 0x85EBCA6B) & 0xFFFFFFFF
+    h ^= h >> 13
+    h = (h * 0xC2B2AE35) & 0xFFFFFFFF
+    h ^= h >> 16
+    return h
+
+
+def id_hash_range(h, n):
+    """Same as ts_id_hash_range in thingset.h"""
+    return ((h >> 16) * n) >> 16
+
+
+def name_hash(parent, name):
+    """Same as ts_name_hash in thingset.h"""
+    h = 2166136261 ^ parent
+    for c in name.encode('utf-8'):
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def load_schema(path):
+    with open(path, encoding='utf-8') as f:
+        if path.endswith(('.yaml', '.yml')):
+            try:
+                import yaml
+            except ImportError:
+                raise SchemaError('PyYAML is required for YAML schemas')
+            return yaml.safe_load(f)
+        return json.load(f)
+
+
+def parse_id(value):
+    if isinstance(value, str):
+        value = int(value, 0)
+    if not isinstance(value, int) or value <= 0 or value > 0xFFFF:
+        raise SchemaError('invalid node ID %r' % value)
+    return value
+
+
+class Node:
+    def __init__(self, desc, parent, channels):
+        self.desc = desc
+        self.id = parse_id(desc.get('id'))
+        self.name = desc.get('name')
+        self.type = desc.get('type')
+        self.parent = parent
+        if not self.name:
+            raise SchemaError('node 0x%X has no name' % self.id)
+        if self.type not in NODE_TYPES:
+            raise SchemaError('unknown type %r of node %s' % (self.type, self.name))
+        if 'children' in desc and self.type not in ('path', 'exec'):
+            raise SchemaError('node %s of type %s can\'t have children' % (self.name, self.type))
+
+        self.channels = desc.get('pubsub', [])
+        for ch in self.channels:
+            if ch not in channels:
+                raise SchemaError('unknown channel %s of node %s' % (ch, self.name))
+        self.pubsub = 0
+        for ch in self.channels:
+            self.pubsub |= 1 << channels[ch]
+
+        if self.type == 'pubsub' and desc.get('channel') not in channels:
+            raise SchemaError('unknown channel %r of node %s' % (desc.get('channel'), self.name))
+
+    def attr(self, key):
+        if key not in self.desc:
+            raise SchemaError('node %s has no attribute %s' % (self.name, key))
+        return self.desc[key]
+
+    def macro(self):
+        """Node definition with the TS_NODE_* macros of thingset.h"""
+        d = self.desc
+        name = '"%s"' % self.name
+        parent = '0x%X' % self.parent if self.parent else '0'
+        default_access = 'TS_ANY_RW' if self.type in ('exec', 'pubsub') else 'TS_ANY_R'
+        access = d.get('access', default_access)
+        pubsub = ' | '.join(self.channels) if self.channels else '0'
+        args = ['0x%X' % self.id, name]
+
+        if self.type in VALUE_MACROS:
+            macro = VALUE_MACROS[self.type]
+            args += ['&' + self.attr('var'), parent, access, pubsub]
+        elif self.type == 'float':
+            macro = 'TS_NODE_FLOAT'
+            args += ['&' + self.attr('var'), str(d.get('digits', 0)), parent, access, pubsub]
+        elif self.type == 'string':
+            macro = 'TS_NODE_STRING'
+            var = self.attr('var')
+            args += [var, str(d.get('size', 'sizeof(%s)' % var)), parent, access, pubsub]
+        elif self.type == 'array':
+            macro = 'TS_NODE_ARRAY'
+            args += ['&' + self.attr('var'), str(d.get('digits', 0)), parent, access, pubsub]
+        elif self.type == 'exec':
+            macro = 'TS_NODE_EXEC'
+            args += ['&' + self.attr('function'), parent, access]
+        elif self.type == 'pubsub':
+            macro = 'TS_NODE_PUBSUB'
+            args += [d['channel'], parent, access, pubsub]
+        else:
+            macro = 'TS_NODE_PATH'
+            callback = d.get('callback')
+            args += [parent, '&' + callback if callback else 'NULL']
+
+        return '%s(%s)' % (macro, ', '.join(args))
+
+
+def flatten(descs, parent, channels, nodes):
+    """Nodes in depth-first order, i.e. each path is followed by its child nodes"""
+    for desc in descs:
+        node = Node(desc, parent, channels)
+        nodes.append(node)
+        flatten(desc.get('children', []), node.id, channels, nodes)
+    return nodes
+
+
+def check_nodes(nodes):
+    ids = set()
+    names = set()
+    for node in nodes:
+        if node.id in ids:
+            raise SchemaError('duplicate node ID 0x%X' % node.id)
+        ids.add(node.id)
+        if (node.parent, node.name) in names:
+            raise SchemaError('duplicate name %s below parent 0x%X' % (node.name, node.parent))
+        names.add((node.parent, node.name))
+    if len(nodes) == 0 or len(nodes) >= TS_INDEX_EMPTY // 2:
+        raise SchemaError('number of nodes must be between 1 and %d' % (TS_INDEX_EMPTY // 2))
+
+
+def find_seed(ids):
+    """Smallest seed which maps the IDs of a bucket to different slots of the bucket"""
+    if len(ids) <= 1:
+        return 0
+    for seed in range(1, 0x10000):
+        if len(set(id_hash_range(id_hash(i, seed), len(ids)) for i in ids)) == len(ids):
+            return seed
+    return None
+
+
+def id_table(nodes):
+    """
+    Minimal perfect hash of the node IDs
+
+    Each bucket of the first-level hash owns as many slots as IDs are mapped to it, and a seed
+    is searched which maps its IDs to different slots. The same tables are built at compile time
+    by ts_make_id_hash in thingset_id_hash.h (one bucket per two IDs).
+    """
+    n = len(nodes)
+    num_buckets = (n + 1) // 2
+    while True:
+        buckets = [[] for _ in range(num_buckets)]
+        for pos, node in enumerate(nodes):
+            buckets[id_hash_range(id_hash(node.id, 0), num_buckets)].append(pos)
+
+        seeds = [find_seed([nodes[pos].id for pos in bucket]) for bucket in buckets]
+        if None not in seeds:
+            break
+        if num_buckets == n:
+            raise SchemaError('no perfect hash found for the node IDs')
+        num_buckets = min(n, num_buckets * 2)   # retry with smaller buckets
+
+    offsets = [0]
+    slots = [TS_INDEX_EMPTY] * n
+    for bucket, seed in zip(buckets, seeds):
+        for pos in bucket:
+            slots[offsets[-1] + id_hash_range(id_hash(nodes[pos].id, seed), len(bucket))] = pos
+        offsets.append(offsets[-1] + len(bucket))
+    return seeds, offsets, slots
+
+
+def name_table(nodes):
+    """Open addressing hash table with linear probing (at most half of the slots are used)"""
+    size = 2
+    while size < 2 * len(nodes):
+        size *= 2
+    slots = [TS_INDEX_EMPTY] * size
+    for pos, node in enumerate(nodes):
+        slot = name_hash(node.parent, node.name) & (size - 1)
+        while slots[slot] != TS_INDEX_EMPTY:
+            slot = (slot + 1) & (size - 1)
+        slots[slot] = pos
+    return size - 1, slots
+
+
+def child_lists(nodes):
+    """Child node positions of each node followed by the children of the root node"""
+    by_parent = {}
+    for pos, node in enumerate(nodes):
+        by_parent.setdefault(node.parent, []).append(pos)
+    offsets = []
+    children = []
+    for parent in [node.id for node in nodes] + [0]:
+        offsets.append(len(children))
+        children += by_parent.get(parent, [])
+    offsets.append(len(children))
+    return offsets, children
+
+
+def pub_lists(nodes, channels):
+    bitfields = []
+    offsets = []
+    pub_nodes = []
+    for name, bit in sorted(channels.items(), key=lambda ch: ch[1]):
+        bitfields.append(1 << bit)
+        offsets.append(len(pub_nodes))
+        pub_nodes += [pos for pos, node in enumerate(nodes) if node.pubsub & (1 << bit)]
+    offsets.append(len(pub_nodes))
+    return bitfields, offsets, pub_nodes
+
+
+def cbor_keys(nodes):
+    """
+    CBOR encoded ID (uint) and name (text string) of each node, so that they don't have to be
+    encoded for each request (same encoding as cbor_serialize_uint and cbor_serialize_string)
+    """
+    keys = []
+    offsets = []
+    for node in nodes:
+        offsets.append(len(keys))
+        if node.id < 24:
+            keys += [node.id]
+        elif node.id <= 0xFF:
+            keys += [0x18, node.id]
+        else:
+            keys += [0x19, node.id >> 8, node.id & 0xFF]
+        name = list(node.name.encode('utf-8'))
+        if len(name) < 24:
+            keys += [0x60 | len(name)]
+        elif len(name) < 0xFF:
+            keys += [0x78, len(name)]
+        else:
+            keys += [0x79, len(name) >> 8, len(name) & 0xFF]
+        keys += name
+    offsets.append(len(keys))
+    if len(keys) > 0xFFFF:
+        return [], []       # offsets are limited to 16 bits, keys are encoded for each request
+    return keys, offsets
+
+
+def wrap(line, width=100):
+    """Wraps a line at the last argument fitting into the width"""
+    lines = []
+    while len(line) > width and line.rfind(', ', 0, width) > 0:
+        pos = line.rfind(', ', 0, width)
+        lines.append(line[:pos + 1])
+        line = '        ' + line[pos + 2:].lstrip()
+    lines.append(line)
+    return '\n'.join(lines) + '\n'
+
+
+def c_array(name, values, fmt='%d', ctype='uint16_t'):
+    if not values:
+        return ''
+    lines = []
+    for i in range(0, len(values), 12):
+        lines.append('    ' + ', '.join(fmt % v for v in values[i:i + 12]) + ',')
+    return 'static const %s %s[] = {\n%s\n};\n\n' % (ctype, name, '\n'.join(lines))
+
+
+def generate(schema, prefix, source, guard):
+    channels = schema.get('channels', {})
+    for name, bit in channels.items():
+        if not isinstance(bit, int) or bit < 0 or bit > 15:
+            raise SchemaError('invalid bit %r of channel %s' % (bit, name))
+
+    nodes = flatten(schema.get('nodes', []), 0, channels, [])
+    check_nodes(nodes)
+
+    id_seeds, id_offsets, id_slots = id_table(nodes)
+    name_mask, name_slots = name_table(nodes)
+    child_offsets, children = child_lists(nodes)
+    pub_channels, pub_offsets, pub_nodes = pub_lists(nodes, channels)
+    keys, key_offsets = cbor_keys(nodes)
+    if not keys:
+        print('warning: CBOR keys exceed 64 KiB and are not generated', file=sys.stderr)
+
+    out = []
+    out.append('/*\n * Generated by tools/ts_codegen.py from %s, do not edit\n */\n\n' % source)
+    out.append('#ifndef %s\n#define %s\n\n#include "thingset.h"\n\n' % (guard, guard))
+
+    for name, bit in sorted(channels.items(), key=lambda ch: ch[1]):
+        out.append('#define %-12s(1U << %d)\n' % (name, bit))
+    if channels:
+        out.append('\n')
+
+    out.append('static DataNode %s_nodes[] = {\n' % prefix)
+    for node in nodes:
+        if node.parent == 0 and node is not nodes[0]:
+            out.append('\n')
+        if 'comment' in node.desc:
+            out.append('    // %s\n' % node.desc['comment'])
+        out.append(wrap('    %s,' % node.macro()))
+    out.append('};\n\n')
+
+    out.append(c_array('%s_id_seeds' % prefix, id_seeds))
+    out.append(c_array('%s_id_offsets' % prefix, id_offsets))
+    out.append(c_array('%s_id_slots' % prefix, id_slots))
+    out.append(c_array('%s_name_slots' % prefix, name_slots, '0x%04X'))
+    out.append(c_array('%s_child_offsets' % prefix, child_offsets))
+    out.append(c_array('%s_children' % prefix, children))
+    out.append(c_array('%s_pub_channels' % prefix, pub_channels, '0x%04X'))
+    out.append(c_array('%s_pub_offsets' % prefix, pub_offsets))
+    out.append(c_array('%s_pub_nodes' % prefix, pub_nodes))
+    out.append(c_array('%s_cbor_keys' % prefix, keys, '0x%02X', 'uint8_t'))
+    out.append(c_array('%s_cbor_key_offsets' % prefix, key_offsets))
+
+    def ref(name, values):
+        return '%s_%s' % (prefix, name) if values else 'NULL'
+
+    out.append('static const ThingSetIndex %s_index = {\n' % prefix)
+    fields = [
+        (str(len(nodes)), 'num_nodes'),
+        (str(len(id_seeds)), 'num_id_buckets'),
+        (ref('id_seeds', id_seeds), 'id_seeds'),
+        (ref('id_offsets', id_offsets), 'id_offsets'),
+        (ref('id_slots', id_slots), 'id_slots'),
+        ('0x%04X' % name_mask, 'name_mask'),
+        (ref('name_slots', name_slots), 'name_slots'),
+        (ref('child_offsets', child_offsets), 'child_offsets'),
+        (ref('children', children), 'children'),
+        (str(len(pub_channels)), 'num_pub_channels'),
+        (ref('pub_channels', pub_channels), 'pub_channels'),
+        (ref('pub_offsets', pub_offsets), 'pub_offsets'),
+        (ref('pub_nodes', pub_nodes), 'pub_nodes'),
+        (ref('cbor_keys', keys), 'cbor_keys'),
+        (ref('cbor_key_offsets', key_offsets), 'cbor_key_offsets'),
+    ]
+    for value, name in fields:
+        out.append('    %-32s// %s\n' % (value + ',', name))
+    out.append('};\n\n#endif /* %s */\n' % guard)
+
+    return ''.join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate ThingSet data nodes from a schema')
+    parser.add_argument('schema', help='JSON or YAML schema file')
+    parser.add_argument('-o', '--output', help='output header file (default: stdout)')
+    parser.add_argument('-p', '--prefix', default='data',
+                        help='prefix of the generated symbols (default: data)')
+    args = parser.parse_args()
+
+    if args.output:
+        base = os.path.basename(args.output)
+    else:
+        base = args.prefix + '.h'
+    guard = ''.join(c if c.isalnum() else '_' for c in base).upper()
+
+    try:
+        code = generate(load_schema(args.schema), args.prefix, os.path.basename(args.schema),
+                        guard)
+    except (SchemaError, ValueError) as e:
+        print('%s: error: %s' % (args.schema, e), file=sys.stderr)
+        return 1
+
+    if args.output:
+        with open(args.output, 'w', encoding='utf-8') as f:
+            f.write(code)
+    else:
+        sys.stdout.write(code)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())